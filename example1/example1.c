@@ -55,6 +55,11 @@ static void statue_tick(World* world, Actor* a, double deltaTime)
 	if (glfwGetKey(w, 'C')) dr.z -= 120 * dt;
 	//if (glfwGetKey(w, 'Z')) ds = +1 * dt;
 	//if (glfwGetKey(w, 'C')) ds = -1 * dt;
+	// the material needs the texture name from the mesh, so wait for the async load
+	StaticMesh* mesh = actor_get_mesh(a);
+	if (mesh && !a->material.shader && resource_ready(&mesh->res))
+		a->material = world_load_material_async(world, "shaders/simple", mesh->model->tex_name);
+
 	a->pos   = vec3_add(a->pos, dp);
 	a->rot   = vec3_add(a->rot, dr);
 	a->scale = vec3_addf(a->scale, ds);
@@ -64,12 +69,8 @@ static void statue_tick(World* world, Actor* a, double deltaTime)
 
 static Actor* set_actor_mesh(World* world, Actor* actor, const char* meshName)
 {
-	actor_clear(actor);
-	if (actor_mesh(actor, world_load_mesh(world, meshName)))
-	{
-		actor->material = world_load_material(world, 
-			"shaders/simple", actor->mesh->model->tex_name);
-	}
+	actor_clear(actor); // material is reloaded by statue_tick once the mesh is ready
+	actor_mesh(actor, world_load_mesh_async(world, meshName));
 	return actor;
 }
 
@@ -109,6 +110,7 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 			case GLFW_KEY_3: model = "ARC_170.bmd";        break;
 		}
 		if (model) set_actor_mesh(world, statue, model);
+		if (key == GLFW_KEY_P) world_dump_stats(world, stdout, mods & GLFW_MOD_SHIFT);
 	}
 }
 void btn_callback(GLFWwindow* window, int button, int action, int mods)
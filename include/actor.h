@@ -18,7 +18,8 @@ typedef struct Actor // definition of a 3D actor in our scenes
 	vec3 rot;   // euler XYZ rotation
 	vec3 scale; // XYZ scale
 
-	StaticMesh*  mesh;      // STRONG REF: 3D mesh
+	ResHandle    mesh;      // STRONG REF: handle to StaticMesh
+	int          lod;       // mesh LOD drawn last frame, see mesh_select_lod()
 	Material     material;  // STRONG REF: material (color, shader, texture)
 
 	ActorTick tick; // custom TICK function
@@ -46,11 +47,18 @@ bool actor_mesh(Actor* a, StaticMesh* mesh);
 // takes ownership of the provided material
 bool actor_material(Actor* a, Material* mat);
 
+// resolves the mesh handle, NULL if no mesh is set
+StaticMesh* actor_get_mesh(const Actor* a);
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // gets the affine transformation matrix of this actor
 void actor_affine_matrix(mat4* out, const Actor* a);
 
+// gets the world space bounds of this actor's mesh, transformed by actor_affine_matrix()
+// @return FALSE if the actor has no mesh or it's still loading
+bool actor_world_bounds(bounds3d* out, const Actor* a);
+
 // draws this model in the specified viewprojection
 // and in the context of an already bound shader
 void actor_draw(Actor* a, const mat4* viewProjection);
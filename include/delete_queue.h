@@ -0,0 +1,48 @@
+#pragma once
+/**
+ * End-of-frame GPU object destruction queue.
+ * Resource free funcs queue their GL objects here instead of deleting them mid-frame,
+ * dq_flush() then deletes each object type with a single glDelete* call.
+ * CPU memory the GPU may still read is freed only after a fence confirms it's done.
+ */
+#include <stdbool.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Frees CPU memory, ex: free or SOIL_free_image_data */
+typedef void (*DeleteQueue_FreeFunc)(void* ptr);
+
+/**
+ * @brief Starts queueing deletions. Before init and after shutdown,
+ *        objects are deleted immediately, which is what tools without a frame loop want.
+ */
+void dq_init(void);
+
+/** @brief Deletes everything still queued, waits for the GPU and stops queueing */
+void dq_shutdown(void);
+
+/** @brief Queues a buffer object for deletion, 0 is ignored. Safe to call from any thread */
+void dq_delete_buffer(unsigned buffer);
+/** @brief Queues a texture object for deletion, 0 is ignored */
+void dq_delete_texture(unsigned texture);
+/** @brief Queues a vertex array object for deletion, 0 is ignored */
+void dq_delete_vertex_array(unsigned vao);
+/** @brief Queues a shader program for deletion, 0 is ignored */
+void dq_delete_program(unsigned program);
+
+/**
+ * @brief Frees CPU memory once the GPU has finished all commands issued up to the next dq_flush()
+ * @param ptr Memory to free, NULL is ignored
+ * @param freeFunc Function that frees ptr
+ */
+void dq_free(void* ptr, DeleteQueue_FreeFunc freeFunc);
+
+/**
+ * @brief Issues the batched glDelete* calls, fences this frame's CPU frees and runs
+ *        the CPU frees of earlier frames whose fences have signaled. Never blocks.
+ *        Must be called on the GL thread, once per frame after swapping buffers.
+ * @return Number of GL objects deleted
+ */
+int dq_flush(void);
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,59 @@
+#pragma once
+/**
+ * Imports Wavefront OBJ and glTF 2.0 (.gltf, .glb) meshes straight into BMD_VERSION models.
+ * OBJ text is split into line aligned chunks that are parsed in parallel on a taskpool,
+ * then identical vertices are welded in parallel: every triangle corner is hashed, the
+ * corners are bucketed into shards by hash and each shard is deduplicated by its own task
+ * with an open addressing table. Vertices keep the order of their first use, so the output
+ * is the same whatever the number of threads. Run bmdopt on the result for the GPU order.
+ */
+#include <stdbool.h>
+#include "mesh.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct import_options
+{
+	int   numThreads; // worker threads, 0 uses one per CPU core
+	float weld;       // positions closer than this are welded, 0 only welds identical vertices
+} import_options;
+
+/** Timings and counters of a single import */
+typedef struct import_stats
+{
+	double parseTime;     // seconds reading the file into vertex streams and triangle corners
+	double weldTime;      // seconds welding and deduplicating the vertices
+	double buildTime;     // seconds generating missing normals and building the BMD model
+	int    numThreads;    // worker threads used
+	int    numCorners;    // triangle corners read from the file, 3 per triangle
+	int    numVerts;      // vertices left after welding
+	int    numDegenerate; // triangles dropped because welding collapsed them
+} import_stats;
+
+/**
+ * @brief Imports an OBJ or glTF model, picking the importer by the file extension.
+ *        OBJ models take their texture from the map_Kd of their first material,
+ *        glTF models from the base color texture of their first primitive.
+ * @param opt   Import options, NULL for the defaults
+ * @param stats Receives timings and counters if not NULL
+ * @return malloc'd BMD_VERSION model, or NULL if the file couldn't be read or parsed
+ */
+BMDModel* import_model(const char* path, const import_options* opt, int* outSize, import_stats* stats);
+
+/**
+ * @brief Imports OBJ text, faces are fan triangulated and UVs are flipped to a top left origin
+ * @param path Path of the model, its file name becomes the model name and the .mtl
+ *             library is loaded relative to it
+ */
+BMDModel* import_obj(const char* text, int size, const char* path,
+                     const import_options* opt, int* outSize, import_stats* stats);
+
+/**
+ * @brief Imports the triangle primitives of a glTF JSON or GLB model, with their node
+ *        transforms applied. Only float positions and normals are read, sparse accessors aren't.
+ * @param path Path of the model, external buffers are loaded relative to it
+ */
+BMDModel* import_gltf(const void* data, int size, const char* path,
+                      const import_options* opt, int* outSize, import_stats* stats);
+
+////////////////////////////////////////////////////////////////////////////////
@@ -9,21 +9,46 @@ typedef struct Texture
 {
 	Resource res;
 	unsigned glTexture; // STRONG REF: OpenGL texture handle
-	void*    data;      // STRONG REF: loaded image data (NULL by default, opt to retain)
+	int      width;     // image width in pixels
+	int      height;    // image height in pixels
+	int      levels;    // mip levels in the immutable texture storage, 1 if not mipmapped
+	void*    data;      // STRONG REF: decoded RGBA image data, only held until GL upload
+	void*    mips;      // STRONG REF: CPU generated levels 1+ (malloc), only held until GL upload
 } Texture;
 
 typedef struct TexManager { ResManager rm; } TexManager;
 
-// inititalizes generic resource manager as a texture manager
-TexManager* tex_manager_create(int maxCount);
+// inititalizes generic resource manager as a texture manager, growing by slabSize items
+TexManager* tex_manager_create(int slabSize);
+
+// how the mip levels of loaded textures are generated
+typedef enum TexMipmaps
+{
+	TEX_MIPS_NONE,   // level 0 only, minified with GL_LINEAR
+	TEX_MIPS_GPU,    // glGenerateMipmap on the GL thread after the upload
+	TEX_MIPS_BOX,    // 2x2 box filter on the loader thread, see mipmap.h
+	TEX_MIPS_KAISER, // Kaiser filter on the loader thread, sharper than box (default)
+} TexMipmaps;
+
+typedef struct TexSettings
+{
+	TexMipmaps mipmaps;    // default is TEX_MIPS_KAISER
+	float      anisotropy; // max anisotropic filtering samples, 1 disables it, default is 8
+} TexSettings;
+
+// changes the settings of textures loaded afterwards, ex: before loading the world, from any thread
+// anisotropy is clamped to what the GPU supports when the texture is uploaded
+void tex_settings_set(const TexSettings* settings);
+// gets the current texture settings
+void tex_settings_get(TexSettings* out);
 
 ////////////////////////////////////////////////////////////////////////////////
 
 typedef struct Material
 {
-	vec4     color;   // default is RGBA(1, 1, 1, 1)
-	Shader*  shader;  // STRONG REF: shader associated with this material
-	Texture* texture; // STRONG REF: texture reference (does not own this texture!)
+	vec4      color;   // default is RGBA(1, 1, 1, 1)
+	ResHandle shader;  // STRONG REF: handle to the Shader of this material
+	ResHandle texture; // STRONG REF: handle to the Texture (does not own this texture!)
 } Material;
 
 // creates a new material by taking ownership (!) of the SHADER and TEXTURE
@@ -36,6 +61,11 @@ void material_destroy(Material* m);
 // moves material from source to destination, swapping the values
 void material_move(Material* dst, Material* src);
 
+// resolves the shader handle, NULL if not set
+Shader* material_shader(const Material* m);
+// resolves the texture handle, NULL if not set
+Texture* material_texture(const Material* m);
+
 ////////////////////////////////////////////////////////////////////////////////
 
 
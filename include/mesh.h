@@ -1,10 +1,27 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h> // offsetof
 #include "vertex_array.h"
 #include "resource.h"
+#include "vfs.h"
+#include "meshopt.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#define BMD_MAGIC    "BMD2"
+#define BMD_VERSION  3
+#define BMD_MAX_LODS 8
+
+typedef struct BMDLod // BMD v2+ LOD table entry, all LODs share the vertex data
+{
+	int   first_index; // first index of this LOD in the index data
+	int   num_indices; // number of triangle list indices
+	float error;       // simplification error relative to the bounds radius, 0 for LOD0
+	int   num_meshlets; // BMD v3+: meshlet table entries of this LOD, 0 in older models
+} BMDLod;
+
+typedef meshopt_meshlet BMDMeshlet; // BMD v3+ meshlet table entry, first_index is absolute
+
 typedef struct BMDModel // definition of our BMDModel format
 {
 	char name[32];		// model name
@@ -13,13 +30,87 @@ typedef struct BMDModel // definition of our BMDModel format
 	int	num_indices;	// number of indices
 	int off_verts;		// offset to vertices
 	int off_indices;	// offset to indices
-	// Vertex Data [num_verts    * sizeof(vertex_t)] follows
-	// Index Data  [num_indices  * sizeof(index_t) ] follows
+	// v1: Vertex Data [num_verts    * sizeof(vertex_t)] follows
+	// v1: Index Data  [num_indices  * sizeof(index_t) ] follows
+
+	// BMD v2+ only, check bmd_version() before reading these:
+	char magic[4];      // BMD_MAGIC
+	int  version;       // BMD_VERSION
+	int  index_size;    // 2 if num_verts <= 65536, otherwise 4
+	int  num_lods;      // LOD table entries after the header, 0 if the model has no LODs
+	vec3 bounds_min;    // position bounds, quantized positions are relative to these
+	vec3 bounds_max;
+
+	// BMD v3+ only, older models compute it on load, see bmd_bounds():
+	vec3  sphere_center; // bounding sphere of the positions, the bounds center
+	float sphere_radius;
+	// v2+: LOD table   [num_lods    * sizeof(BMDLod)   ] follows, LOD0 first
+	// v3+: Meshlets    [sum of LOD num_meshlets * sizeof(BMDMeshlet)] follows, in LOD order
+	// v2+: Vertex Data [num_verts   * sizeof(qvertex_t)] follows, normals are octahedral encoded
+	//      and bound as a 2 component a_Normal, no shader reads normals yet: one that does must
+	//      oct_decode() them for v2+ and use them as is for v1, whose a_Normal has 3 components
+	// v2+: Index Data  [num_indices * index_size       ] follows, all LODs back to back
 } BMDModel;
 
+// size of the BMD v1 and v2 headers, later fields are only present in later versions
+#define BMD_V1_HEADER_SIZE ((int)offsetof(BMDModel, magic))
+#define BMD_V2_HEADER_SIZE ((int)offsetof(BMDModel, sphere_center))
+
 // BMDModel functions
-vertex_t* model_vertices(BMDModel* model);
-index_t*  model_indices(BMDModel* model);
+int        bmd_version(const BMDModel* model);     // 1, 2 or BMD_VERSION
+int        bmd_header_size(const BMDModel* model); // header bytes of the model's version
+vertex_t*  model_vertices(BMDModel* model);    // BMD v1 only
+qvertex_t* model_qvertices(BMDModel* model);   // BMD v2+ only
+index_t*   model_indices(BMDModel* model);     // 32-bit indices, v1 or v2+ with index_size 4
+unsigned short* model_indices16(BMDModel* model); // v2+ with index_size 2
+int        bmd_lods(const BMDModel* model, BMDLod* out); // fills out[BMD_MAX_LODS], @return >= 1
+const BMDMeshlet* bmd_meshlets(const BMDModel* model, int* count); // all LODs, NULL if none
+bounds3d   bmd_bounds(const BMDModel* model);  // from the v3 header, computed for older models
+
+/**
+ * @brief Validates the header offsets and counts against the file size
+ * @return FALSE if the model is truncated or corrupt
+ */
+bool bmd_validate(const BMDModel* model, int size);
+
+/**
+ * @brief Converts a BMD v1 or v2 model into BMD_VERSION. v1 vertices are compressed:
+ *        positions quantized to 16 bits inside the mesh bounds, half float UVs, octahedral
+ *        normals and 16-bit indices if num_verts <= 65536, this halves vertex memory and
+ *        fetch bandwidth. v3 stores the bounding sphere, so loading doesn't scan vertices.
+ * @param outSize Receives the size of the converted model in bytes
+ * @return malloc'd model, or NULL if the model is invalid or already BMD_VERSION
+ */
+BMDModel* bmd_convert(const BMDModel* model, int size, int* outSize);
+
+/**
+ * @brief Optimizes a BMD model of any version in place for the GPU: Tipsify triangle order for
+ *        the vertex cache, clusters sorted against overdraw, then vertices remapped into
+ *        first-use order for fetch locality. Rendering results are unchanged.
+ * @param before,after Optional, receive the vertex cache statistics of the index buffer
+ * @return FALSE if the model is corrupt or references vertices out of range
+ */
+bool bmd_optimize(BMDModel* model, int size, meshopt_stats* before, meshopt_stats* after);
+
+/**
+ * @brief Generates a LOD chain for a BMD_VERSION model with meshopt_simplify(). Every LOD keeps
+ *        about ratio of the previous LOD's triangles and indexes the vertex data of LOD0.
+ *        The chain ends early once a mesh can't be simplified further. Meshlets are dropped,
+ *        rebuild them with bmd_build_meshlets() after bmd_optimize().
+ * @param numLods Wanted number of LODs including LOD0, at most BMD_MAX_LODS
+ * @param outSize Receives the size of the new model in bytes
+ * @return malloc'd model with a LOD table, or NULL if the model isn't a valid BMD_VERSION model
+ */
+BMDModel* bmd_generate_lods(const BMDModel* model, int size, int numLods, float ratio, int* outSize);
+
+/**
+ * @brief Groups the triangles of every LOD of a BMD_VERSION model into meshlets with
+ *        meshopt_build_meshlets(), so draws can skip clusters that are off screen or facing
+ *        away. Run bmd_optimize() afterwards, it then reorders triangles inside each meshlet.
+ * @param outSize Receives the size of the new model in bytes
+ * @return malloc'd model with a meshlet table, or NULL if the model isn't a valid BMD_VERSION model
+ */
+BMDModel* bmd_build_meshlets(const BMDModel* model, int size, int* outSize);
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -28,13 +119,52 @@ typedef struct StaticMesh
 {
 	Resource       res;   // resource base class
 	int            size;  // BMD model size in bytes
-	BMDModel*      model; // STRONG REF: model data reference
-	vertex_array*  array; // STRONG REF: GPU vertex array object
+	vfs_file       file;  // STRONG REF: model file, a read-only packed view or a mapped loose file
+	BMDModel*      model; // model data inside file, or a heap copy of just the header if the
+	                      // manager is gpuOnly: vertex and index data are then only on the GPU
+	geometry_pool* pool;  // shared buffers of the mesh's vertex layout, NULL until uploaded
+	gp_range       range; // the mesh's vertices and indices inside pool
+	int            numLods;            // >= 1, LOD0 is the full model
+	BMDLod         lods[BMD_MAX_LODS]; // index ranges of every LOD, relative to range
+	bounds3d       bounds;             // model space bounds, see bmd_bounds()
+	BMDMeshlet*    meshlets;           // heap copy of the meshlet table, NULL if the model has none
+	int            numMeshlets;        // all LODs, lods[i].num_meshlets each
 } StaticMesh;
 
 typedef struct MeshManager { ResManager rm; } MeshManager;
 
-// initializes a resource manager for StaticMesh objects
-MeshManager* mesh_manager_create(int maxCount);
+// initializes a resource manager for StaticMesh objects, growing by slabSize items
+// set rm.gpuOnly to release the model file once it's uploaded, see StaticMesh::model
+MeshManager* mesh_manager_create(int slabSize);
+
+// @return TRUE if the vertex and index data of the mesh are available on the CPU
+bool mesh_has_cpu_data(const StaticMesh* sm);
+
+// @brief Gets the matrix that maps quantized BMD v2+ positions back to model space,
+//        apply it before the model matrix. v2+ normals stay encoded, see BMDModel.
+// @return FALSE for BMD v1 meshes, whose positions are used as is
+bool mesh_dequantize_matrix(const StaticMesh* sm, mat4* out);
+
+// largest LOD error allowed on screen, as a fraction of the viewport height (~1px at 1080p)
+#define MESH_LOD_TOLERANCE  0.001f
+// LODs switch coarser below TOLERANCE*(1-HYSTERESIS) and finer above TOLERANCE*(1+HYSTERESIS),
+// so a mesh hovering around a switch distance doesn't flicker between two LODs
+#define MESH_LOD_HYSTERESIS 0.25f
+
+// @return Projected radius of the mesh bounds as a fraction of the viewport height,
+//         or FLT_MAX if the camera is inside the bounds
+float mesh_projected_size(const StaticMesh* sm, const mat4* model, const mat4* viewProjection);
+
+// @brief Picks the coarsest LOD whose error stays below MESH_LOD_TOLERANCE on screen
+// @param screenSize Projected size from mesh_projected_size()
+// @param current    LOD drawn last frame, for hysteresis
+// @return LOD index into sm->lods
+int mesh_select_lod(const StaticMesh* sm, float screenSize, int current);
+
+// @brief Draws the meshlets of a LOD that are inside the frustum and facing the camera,
+//        merging consecutive visible meshlets into one range of a multi-draw
+// @param mvp viewProjection * model, without the dequantize matrix: meshlets are in model space
+// @return Number of meshlets drawn, the LOD must have meshlets
+int mesh_draw_meshlets(const StaticMesh* sm, int lod, const mat4* mvp);
 
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+/**
+ * Offline triangle mesh optimization passes, all CPU only:
+ *   1. meshopt_vertex_cache: Tipsify triangle order for the post-transform vertex cache
+ *   2. meshopt_overdraw:     reorders Tipsify clusters so outward facing ones draw first
+ *   3. meshopt_vertex_fetch: remaps vertices into first-use order for fetch locality
+ * Run them in this order, each pass keeps most of the previous pass's gains.
+ * meshopt_simplify generates LOD index buffers, run it before the passes above.
+ * meshopt_build_meshlets regroups triangles into culling clusters, then run the passes on each one.
+ */
+#include <stdbool.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** Post-transform vertex cache size used by the passes and the analysis, in vertices */
+#define MESHOPT_CACHE_SIZE 16
+
+/** Vertex cache efficiency of an index buffer, see meshopt_analyze() */
+typedef struct meshopt_stats
+{
+	float acmr; // average cache miss ratio: transformed vertices per triangle, 0.5 best, 3 worst
+	float atvr; // average transform to vertex ratio: transformed / referenced vertices, 1 best
+} meshopt_stats;
+
+/**
+ * @brief Simulates a FIFO post-transform vertex cache of MESHOPT_CACHE_SIZE entries
+ * @param indices    Triangle list indices
+ * @param numVerts   Number of vertices referenced by indices
+ */
+meshopt_stats meshopt_analyze(const unsigned* indices, int numIndices, int numVerts);
+
+/**
+ * @brief Reorders triangles for the vertex cache with Tipsify [Sander et al. 2007]
+ * @param clusters   Optional [numIndices/3 + 1] receives the first triangle of each cluster,
+ *                   clusters start wherever Tipsify hit a dead end, for meshopt_overdraw()
+ * @return Number of clusters
+ */
+int meshopt_vertex_cache(unsigned* dst, const unsigned* indices, int numIndices, int numVerts,
+                         int* clusters);
+
+/**
+ * @brief Reorders the vertex cache optimized clusters of a triangle list to reduce overdraw.
+ *        Clusters are split where the cache is warm enough that a restart costs at most
+ *        threshold times the ACMR, then sorted so clusters facing away from the mesh
+ *        center draw first and occlude the rest, independent of the view direction.
+ * @param positions  Vertex positions, 3 floats at the start of every stride bytes
+ * @param clusters   Clusters from meshopt_vertex_cache(), may be modified
+ * @param threshold  Allowed ACMR increase, ex: 1.05
+ */
+void meshopt_overdraw(unsigned* dst, const unsigned* indices, int numIndices,
+                      const float* positions, int numVerts, int stride,
+                      int* clusters, int numClusters, float threshold);
+
+/**
+ * @brief Builds a vertex remap table in first-use order of the indices, and remaps the indices
+ * @param remap      [numVerts] receives the new index of every old vertex,
+ *                   unreferenced vertices are moved to the end in their original order
+ * @return Number of referenced vertices
+ */
+int meshopt_vertex_fetch(unsigned* remap, unsigned* indices, int numIndices, int numVerts);
+
+/** @brief Reorders vertices of stride bytes with a remap table from meshopt_vertex_fetch() */
+void meshopt_remap_vertices(void* dst, const void* vertices, int numVerts, int stride,
+                            const unsigned* remap);
+
+/**
+ * @brief Simplifies a triangle list with quadric error edge collapses [Garland & Heckbert 1997].
+ *        Vertices collapse into existing vertices, so all LODs can share one vertex buffer.
+ *        Vertices with equal positions are welded, open borders are preserved.
+ * @param positions     Vertex positions, 3 floats at the start of every stride bytes
+ * @param attributes    Optional, attrCount floats at the start of every attrStride bytes, ex: UV
+ *                      and normal. Picks the vertex a seam collapses into, NULL ignores seams
+ * @param targetIndices Stops once at most this many indices remain, or nothing can collapse
+ * @param error         Optional, receives the largest collapse distance relative to the
+ *                      radius of the mesh bounds, ex: 0.01 is 1% of the radius
+ * @return Number of indices written to dst, at most numIndices
+ */
+int meshopt_simplify(unsigned* dst, const unsigned* indices, int numIndices,
+                     const float* positions, int numVerts, int stride,
+                     const float* attributes, int attrStride, int attrCount,
+                     int targetIndices, float* error);
+
+////////////////////////////////////////////////////////////////////////////////
+//// Meshlets: small clusters of triangles that are culled on the CPU as a whole
+
+#define MESHOPT_MESHLET_VERTS 64  // max unique vertices per meshlet
+#define MESHOPT_MESHLET_TRIS  124 // max triangles per meshlet
+
+/** A contiguous index range with bounds for frustum and backface culling, in model space */
+typedef struct meshopt_meshlet
+{
+	int   first_index; // first index of the meshlet
+	int   num_indices; // number of triangle list indices
+	float center[3];   // bounding sphere
+	float radius;
+	float cone_axis[3]; // average triangle normal
+	float cone_cutoff;  // sin of the normal cone angle, > 1 if the meshlet can't be backface culled
+} meshopt_meshlet;
+
+/** Culling volume in the model space of a model-view-projection matrix */
+typedef struct meshopt_frustum
+{
+	float planes[6][4]; // left, right, bottom, top, near, far: dot(xyz, p) + w >= 0 is inside
+	float eye[3];       // center of projection
+	bool  perspective;  // FALSE for orthographic projections, which skip backface culling
+} meshopt_frustum;
+
+/**
+ * @brief Groups a triangle list into meshlets of at most MESHOPT_MESHLET_VERTS vertices and
+ *        MESHOPT_MESHLET_TRIS triangles. Meshlets grow greedily over adjacent triangles,
+ *        preferring those that add the fewest vertices and face the same way, and fill up to
+ *        the limits even if that widens their cone. They are sorted outward facing first like
+ *        meshopt_overdraw(). Triangle order inside a meshlet isn't cache optimized.
+ * @param meshlets  [numIndices/3] receives the meshlets, first_index is relative to dst
+ * @param dst       [numIndices] receives the triangles grouped by meshlet, can't be indices
+ * @param positions Vertex positions, 3 floats at the start of every stride bytes
+ * @return Number of meshlets, 0 if out of memory
+ */
+int meshopt_build_meshlets(meshopt_meshlet* meshlets, unsigned* dst, const unsigned* indices, int numIndices,
+                           const float* positions, int numVerts, int stride);
+
+/**
+ * @brief Extracts the frustum planes and the eye position from a model-view-projection matrix
+ * @param mvp Column major OpenGL matrix, ex: mat4::m of viewProjection * model
+ */
+void meshopt_frustum_from_matrix(meshopt_frustum* f, const float mvp[16]);
+
+/** @return FALSE if the meshlet is outside the frustum or all its triangles face away from the eye */
+bool meshopt_meshlet_visible(const meshopt_meshlet* m, const meshopt_frustum* f);
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,42 @@
+#pragma once
+/**
+ * CPU mipmap generation for RGBA8 images, with scalar and SSE2 implementations.
+ * Each level is a 2:1 downsample of the previous one, filtered with either a 2x2 box
+ * or a separable 8 tap Kaiser windowed sinc, which keeps distant textures sharper.
+ * Filtering is done on the stored values, like glGenerateMipmap does for GL_RGBA8.
+ * Odd sizes drop their last row or column, the smallest level is 1x1.
+ */
+#include <stdbool.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef enum mip_filter
+{
+	MIP_BOX,    // 2x2 average, fastest
+	MIP_KAISER, // 8x8 Kaiser windowed sinc (alpha 4), sharper, edges are clamped
+} mip_filter;
+
+/** @return Number of levels in the full chain of a width x height image, down to 1x1 */
+int mip_levels(int width, int height);
+
+/** @return Size of a level along one axis, ex: mip_size(width, 2) */
+int mip_size(int size, int level);
+
+/** @return Bytes of RGBA8 levels 1 to levels-1, level 0 excluded */
+int mip_chain_bytes(int width, int height, int levels);
+
+/**
+ * @brief Downsamples one RGBA8 level into the next one
+ * @param dst  Receives mip_size(width, 1) x mip_size(height, 1) RGBA8 pixels
+ * @param simd FALSE forces the scalar implementation, ex: to compare them in benchmarks
+ */
+void mip_downsample(void* dst, const void* src, int width, int height, mip_filter filter, bool simd);
+
+/**
+ * @brief Generates levels 1 to levels-1 of an RGBA8 image with the SIMD implementation
+ * @param levels Levels in the chain including level 0, ex: mip_levels(width, height)
+ * @return malloc'd levels stored back to back, or NULL if levels < 2
+ */
+void* mip_generate(const void* rgba, int width, int height, int levels, mip_filter filter);
+
+////////////////////////////////////////////////////////////////////////////////
@@ -1,38 +1,120 @@
 #pragma once
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include "thread.h"
+#include "vector.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/** Loading state of a managed resource */
+typedef enum ResState
+{
+	RES_PENDING, // queued for async loading, not usable yet
+	RES_READY,   // fully loaded and usable
+	RES_FAILED,  // loading failed, unindexed once unreferenced so the next load retries
+} ResState;
+
 /** A generic managed resource, contains a reference count and resource path ID */
 typedef struct Resource
 {
-	int      refcount;      // @warning: not threadsafe (!!)
+	atomic_int refcount;    // atomic refcount; 0 means cached, -1 means free slot
+	atomic_int state;       // ResState, published by the loading thread
 	struct ResManager* mgr; // reference to manager
 	int      hlen;          // length of path string
 	int      fphlen;        // length of path filepart string
-	//uint64_t KEY;         // 64-bit path hash
+	uint64_t hash;          // 64-bit path hash
 	uint64_t fphash;        // 64-bit filepart hash
-	char*    path;          // path for debugging
+	const char* path;       // interned normalized path, owned by the manager
+	int      slot;          // slot index inside the manager
+	int      link;          // free: next free slot or -1, alive: position in ResManager::alive
+	unsigned generation;    // bumped every time the slot is freed, never 0
+	int      cpuBytes;      // CPU memory held by the loaded resource, set by Read/LoadFunc
+	int      gpuBytes;      // GPU memory held by the loaded resource, set by LoadFunc
+	atomic_uint lastUsed;   // manager use clock when the last reference was released
+	atomic_uint lastFrame;  // frame the resource was last loaded or resolved in
+	float    loadTime;      // seconds spent in Read/LoadFunc
+	uint64_t contentHash;   // xxhash64 of the file contents, if the manager dedupes
+	int      contentSize;   // size of the hashed file, -1 if not hashed
+	struct Resource* alias; // resource whose payload this one shares, see ResManager::dedupe
 } Resource;
 
+/**
+ * 64-bit generational resource handle: [manager:8][generation:32][slot:24]
+ * Resolving is O(1) and stale handles (freed or reused slots) resolve to NULL, until the slot
+ * has been reused 2^32-1 times and its generation wraps back to the handle's.
+ * Handle 0 is never valid.
+ */
+typedef uint64_t ResHandle;
+
+#define RES_HANDLE_SLOT_BITS 24
+#define RES_HANDLE_GEN_BITS  32
+#define RES_HANDLE_MGR_BITS  8
+#define RES_MAX_MANAGERS     (1 << RES_HANDLE_MGR_BITS)
+#define RES_MAX_SLOTS        (1 << RES_HANDLE_SLOT_BITS)
+
+/** Load time histogram buckets: [0] < 1ms, [i] < 2^i ms, [RES_LOAD_BUCKETS-1] everything slower */
+#define RES_LOAD_BUCKETS 12
+
+/** Reads and decodes a resource on a worker thread, must not call OpenGL */
+typedef bool (*ResMgr_ReadFunc)(Resource* res, const char* fullPath);
+/** Finalizes a resource on the GL thread, or fully loads it if there is no ReadFunc */
 typedef bool (*ResMgr_LoadFunc)(Resource* res, const char* fullPath);
+/** Frees a loaded resource, also called if LoadFunc fails after a successful ReadFunc */
 typedef void (*ResMgr_FreeFunc)(Resource* res);
 
-/** Generic file resource manager for managing assets we do not wish to load multiple times */ 
+/**
+ * Generic file resource manager for managing assets we do not wish to load multiple times
+ * @note resource_free(), res_manager_clean_unused() and cache hits of resource_load() are safe
+ *       to call from any thread, and hits are lock-free. Misses and pending hits run LoadFunc
+ *       or the pump on the caller, so resource_load() is otherwise GL thread only.
+ *       Destroying must not overlap with any of them.
+ */ 
 typedef struct ResManager
 {
-	int count;    // number of alive/loaded items
-	int sizeOf;   // sizeof a single item
-	int maxCount; // maximum number of elements we can allocate
+	int count;     // number of alive/loaded items
+	int sizeOf;    // sizeof a single item
+	int capacity;  // number of item slots currently allocated (numSlabs * slabSize)
+	int slabShift; // log2 of slab size, each slab holds [1 << slabShift] items
+	int numSlabs;  // number of allocated slabs
+	int id;        // manager id encoded in resource handles
 
+	_Atomic(struct ResSlabs*) slabs; // slab directory, slabs are never moved once allocated
+	uint64_t* keys;  // [capacity] path hash per slot, 0 means free
+	int* alive;      // [count] dense slot indices of all alive items, in no particular order
+	int freeHead;    // first slot of the intrusive free list, -1 if full
+
+	_Atomic(struct ResIndex*) index; // lock-free open-addressing hash index
+	struct ResIndex* retired;        // replaced indices, freed once no readers remain
+	atomic_int readers;              // number of lock-free lookups in flight
+	_Atomic(struct ResPathTable*) paths; // interned raw relative path -> key and normalized path
+	struct ResContents* contents;    // content hash -> ready payload owner, only if dedupe
+	mutex lock;                      // guards slot allocation, loading and cleanup
+
+	ResMgr_ReadFunc read; // optional worker thread read func
 	ResMgr_LoadFunc load; // resource load func
 	ResMgr_FreeFunc free; // resource free func
 
-	char name[32]; // a small unique name identifier for the resource manager
+	struct taskpool* pool; // worker pool for resource_load_async(), NULL loads synchronously
+	pvector finalize;      // vector<ResLoadJob*> reads waiting for res_manager_pump()
+	atomic_int inflight;   // number of async reads still running on the pool
 
-	// array of [uint64 * maxCount] hash keys
-	// array of [sizeOf * maxCount] items follow
+	bool   dedupe;           // hash files before reading, identical files share one resident payload
+	bool   gpuOnly;          // LoadFunc drops CPU copies after uploading, keeping only small metadata
+	size_t budget;           // max CPU+GPU bytes before unused items are evicted, 0 evicts all unused
+	atomic_size_t cpuBytes;  // CPU bytes of all ready resources
+	atomic_size_t gpuBytes;  // GPU bytes of all ready resources
+	atomic_uint   useClock;  // ticks every time a resource becomes unused, orders LRU eviction
+	atomic_int    hits;      // loads that found the resource already loaded or pending
+	atomic_int    misses;    // loads that had to create the resource
+	atomic_int    evictions; // unused resources freed by res_manager_clean_unused()
+	atomic_int    loads;     // resources that finished loading successfully
+	atomic_int    failures;  // resources that failed to load
+	atomic_int    dedupes;   // loads aliased to an already resident resource with identical contents
+	atomic_int    loadHistogram[RES_LOAD_BUCKETS]; // successful loads by load time, see RES_LOAD_BUCKETS
+
+	char name[32]; // a small unique name identifier for the resource manager
 } ResManager;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -40,12 +122,59 @@ typedef struct ResManager
 /**
  * @brief Loads a resource, if it's already loaded, simply increments refcount
  * @note  If resource does not exist, NULL is returned
+ * @note  Misses load on the calling thread and hitting a pending load finishes it there,
+ *        so only hits of ready resources may be loaded off the GL thread
  * @param mgr Resourmanager context
  * @param relativePath Relative path to resource file
  */ 
 Resource* resource_load(ResManager* rm, const char* relativePath);
 #define iresource_load(resmgr, path) resource_load(&resmgr->rm, path)
 
+/**
+ * @brief Starts loading a resource on the manager's worker pool and returns immediately
+ * @note  The resource is RES_PENDING until res_manager_pump() finalizes it on the GL thread.
+ *        A failed load still returns a resource, check resource_state() before using it.
+ * @param mgr Resourmanager context
+ * @param relativePath Relative path to resource file
+ */
+Resource* resource_load_async(ResManager* rm, const char* relativePath);
+#define iresource_load_async(resmgr, path) resource_load_async(&resmgr->rm, path)
+
+/** @return Current loading state of the resource */
+ResState resource_state(const Resource* res);
+
+/** @return TRUE if the resource is fully loaded and usable */
+bool resource_ready(const Resource* res);
+
+/** @return Generational handle to the resource, or 0 if res is NULL */
+ResHandle resource_handle(const Resource* res);
+
+/**
+ * @brief Resolves a handle in O(1) without touching its refcount
+ * @return The resource, or NULL if the handle is 0 or stale (asserts in debug)
+ */
+Resource* resource_resolve(ResHandle handle);
+#define iresource_resolve(type, handle) ((type*)resource_resolve(handle))
+
+/** @brief Resolves the handle and decrements its refcount, see resource_free() */
+void resource_free_handle(ResHandle handle);
+
+/**
+ * @brief Reloads a ready or failed resource in place from its path, keeping its slot, handle and refcount
+ * @note  Runs Read and LoadFunc into a scratch copy, so the old data is kept if reloading fails.
+ *        A failed resource that reloads successfully becomes RES_READY.
+ *        Aliases of the resource keep the old contents. Must be called on the GL thread.
+ * @return TRUE if the resource was reloaded
+ */
+bool resource_reload(Resource* res);
+
+/**
+ * @brief Reloads the resource loaded from the given normalized path, if there is one
+ * @param fullPath Normalized full path, ex: "data/statue_mage.bmd"
+ * @return TRUE if a resource was reloaded
+ */
+bool res_manager_reload_path(ResManager* rm, const char* fullPath);
+
 /** @brief Decrements refcount, but does not free any resources! use resmgr_clean_unused() */
 void resource_free(Resource* res);
 #define iresource_free(resource) resource_free(&resource->res)
@@ -53,25 +182,90 @@ void resource_free(Resource* res);
 /**
  * @brief Dynamically creates a new Resource Manager
  * @note (!) Items must extend struct Resource (!)
+ * @note The pool grows one slab at a time, so Resource pointers stay valid
  * 
- * @param maxCount Maximum number of elements this manager can pool
+ * @param slabSize Number of items per slab, rounded up to a power of 2
  * @param sizeOf Size of each resource item. SizeOf must be > sizeof(Resource) (!!)
- * @param loadFunc Function to use when initializing a resource
+ * @param readFunc Optional function to read a resource on a worker thread
+ * @param loadFunc Function to use when initializing a resource on the GL thread
  * @param freeFunc Function to use when destroying a resource
  */
-ResManager* res_manager_create(const char* name, int maxCount, int sizeOf, 
-	ResMgr_LoadFunc loadFunc, ResMgr_FreeFunc freeFunc);
+ResManager* res_manager_create(const char* name, int slabSize, int sizeOf, 
+	ResMgr_ReadFunc readFunc, ResMgr_LoadFunc loadFunc, ResMgr_FreeFunc freeFunc);
 
 /** @brief Destroys the resource manager and all its items*/
 void res_manager_destroy(ResManager* rm);
 #define ires_manager_destroy(resmgr) res_manager_destroy(&resmgr->rm)
 
-/** @brief Returns pointer to the first resource element */
+/** @brief Returns pointer to the first resource element of the first slab */
 Resource* res_manager_data(ResManager* rm);
 
-/** @brief Frees any unused (refcount == 0) resources */ 
-void res_manager_clean_unused(ResManager* rm);
+/**
+ * @brief Evicts unused (refcount == 0) resources in least recently used order
+ *        until the manager's CPU+GPU bytes fit in rm->budget. A budget of 0 frees
+ *        every unused resource. Also frees index tables retired by growth.
+ *        Cheap to call every frame while under budget.
+ * @return Number of evicted resources
+ */ 
+int res_manager_clean_unused(ResManager* rm);
 
 /** @brief Destroys all items, regardless of their refcounts */
 void res_manager_destroy_all_items(ResManager* rm);
+
+/** Snapshot of a manager's counters, see res_manager_stats() */
+typedef struct ResManagerStats
+{
+	char   name[32];
+	int    count;     // number of alive items, including cached ones
+	int    capacity;  // number of allocated slots
+	int    loads;     // successful loads
+	int    failures;  // failed loads
+	int    hits;      // loads served from the cache
+	int    misses;    // loads that created a new resource
+	int    evictions; // unused resources freed by res_manager_clean_unused()
+	int    dedupes;   // loads aliased to a resident resource with identical contents
+	size_t dedupedBytes; // CPU+GPU bytes alive aliases would have loaded again
+	size_t cpuBytes;  // CPU bytes of all ready resources
+	size_t gpuBytes;  // GPU bytes of all ready resources
+	size_t budget;    // eviction budget in bytes, 0 evicts all unused
+	int    loadHistogram[RES_LOAD_BUCKETS]; // successful loads by load time
+} ResManagerStats;
+
+/** Snapshot of a single resource, see res_manager_resource_stats() */
+typedef struct ResStats
+{
+	const char* path;      // interned path, valid while the manager lives
+	ResState    state;
+	int         refcount;  // 0 if only cached
+	int         cpuBytes;
+	int         gpuBytes;
+	unsigned    lastFrame; // frame the resource was last loaded or resolved in
+	float       loadTime;  // seconds spent in Read/LoadFunc
+	const char* aliasOf;   // path of the resource sharing its payload, or NULL
+} ResStats;
+
+/** @brief Advances the frame counter used for Resource::lastFrame, call once per frame */
+void resource_next_frame(void);
+
+/** @return Current frame counter */
+unsigned resource_frame(void);
+
+/** @brief Fills a snapshot of the manager's counters */
+void res_manager_stats(ResManager* rm, ResManagerStats* out);
+
+/**
+ * @brief Fills up to maxStats snapshots of alive resources, sorted by CPU+GPU bytes descending
+ * @return Number of resources written
+ */
+int res_manager_resource_stats(ResManager* rm, ResStats* out, int maxStats);
+
+/** @brief Dumps manager and per-resource stats as a text table, or as a JSON object */
+void res_manager_dump(ResManager* rm, FILE* out, bool json);
+
+/**
+ * @brief Finalizes async loads that finished reading. Must be called on the GL thread.
+ * @param timeBudget Seconds to spend, at least one pending load is finalized per call
+ * @return Number of resources finalized
+ */
+int res_manager_pump(ResManager* rm, double timeBudget);
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -55,8 +55,8 @@ typedef struct Shader
 
 typedef struct ShaderManager { ResManager rm; } ShaderManager;
 
-// initializes a resource manager for Shader objects
-ShaderManager* shader_manager_create(int maxCount);
+// initializes a resource manager for Shader objects, growing by slabSize items
+ShaderManager* shader_manager_create(int slabSize);
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -69,6 +69,9 @@ bool shader_reload(Shader* s);
 
 /**
  * Checks vertex/fragment shader sources and does a shader_reload() if necessary.
+ * @note Managed shaders are reloaded without polling by world_reload_changed() on the GL thread,
+ *       the file watcher thread only queues the changed paths
+ * @note Polls both files with stat() on every call
  * @return TRUE if a successful shader_reload() was performed.
  * @note If shader_reload() fails, this function will return FALSE
  */
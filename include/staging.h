@@ -0,0 +1,41 @@
+#pragma once
+/**
+ * Streaming GPU buffer uploads through a persistently mapped staging ring.
+ * Uploads are split into STAGING_CHUNK_SIZE chunks: the CPU copies a chunk into the ring,
+ * which also faults in the pages of a mapped source file, while the GPU copies earlier
+ * chunks into their destination buffers with glCopyBufferSubData. A fence per chunk guards
+ * ring reuse, so staging memory stays at STAGING_RING_SIZE however large the upload is.
+ * Without ARB_buffer_storage (GL 4.4) the chunks go through glBufferSubData instead.
+ */
+#include <stdbool.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define STAGING_CHUNK_SIZE (256 * 1024) // bytes copied per glCopyBufferSubData
+#define STAGING_NUM_CHUNKS 8            // chunks in flight before the CPU waits for the GPU
+#define STAGING_RING_SIZE  (STAGING_CHUNK_SIZE * STAGING_NUM_CHUNKS)
+
+/** Upload counters since startup, see staging_stats_get() */
+typedef struct staging_stats
+{
+	long long bytes;  // bytes uploaded
+	int       chunks; // chunks copied through the ring
+	int       stalls; // chunks that had to wait for the GPU to free their ring slot
+	bool      mapped; // TRUE if the persistently mapped ring is used
+} staging_stats;
+
+/**
+ * @brief Copies size bytes of data into buffer at offset, streaming it through the ring.
+ *        The ring is created by the first upload. Must be called on the GL thread.
+ * @param buffer Destination buffer object, already allocated with at least offset+size bytes
+ * @param data   Source data, ex: a memory mapped BMD file, it's no longer read once this returns
+ */
+void staging_upload(unsigned buffer, int offset, const void* data, int size);
+
+/** @brief Fills the upload counters */
+void staging_stats_get(staging_stats* out);
+
+/** @brief Waits for pending copies and deletes the ring. Must be called on the GL thread */
+void staging_shutdown(void);
+
+////////////////////////////////////////////////////////////////////////////////
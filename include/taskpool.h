@@ -0,0 +1,48 @@
+#pragma once
+#include <stdbool.h>
+#include "thread.h"
+#include "vector.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef void (*TaskFunc)(void* arg);
+
+// a single queued task
+typedef struct task
+{
+	TaskFunc func; // function to run on a worker thread
+	void*    arg;  // argument passed to func
+} task;
+
+// fixed pool of worker threads consuming a FIFO task queue
+typedef struct taskpool
+{
+	mutex   lock;       // guards the task queue
+	condvar wake;       // signaled when tasks are queued or the pool quits
+	condvar idle;       // signaled when the queue is drained and no task is running
+	vector  queue;      // vector<task> pending tasks, consumed from head
+	int     head;       // index of the next task to run
+	int     active;     // tasks currently running on workers
+	bool    quit;       // workers exit once the queue is drained
+	int     numThreads; // number of worker threads
+	thread* threads;    // [numThreads] worker threads
+} taskpool;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Creates a new pool of worker threads
+ * @param numThreads Number of worker threads, at least 1
+ */
+taskpool* taskpool_create(int numThreads);
+
+/** @brief Runs all remaining queued tasks, joins the worker threads and frees the pool */
+void taskpool_destroy(taskpool* p);
+
+/** @brief Queues func(arg) to run on the next free worker thread */
+void taskpool_run(taskpool* p, TaskFunc func, void* arg);
+
+/** @brief Blocks until every queued task has finished, ex: between parallel passes */
+void taskpool_wait(taskpool* p);
+
+////////////////////////////////////////////////////////////////////////////////
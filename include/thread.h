@@ -0,0 +1,79 @@
+#pragma once
+/**
+ * Minimal portable threading primitives: Win32 SRW locks or POSIX threads
+ */
+#include <stdbool.h>
+#ifndef _WIN32
+	#include <pthread.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Non-recursive mutex, must not be locked twice from the same thread */
+typedef struct mutex
+{
+#ifdef _WIN32
+	void* handle; // SRWLOCK
+#else
+	pthread_mutex_t handle;
+#endif
+} mutex;
+
+/** @brief Initializes a new unlocked mutex */
+void mutex_init(mutex* m);
+/** @brief Destroys the mutex, it must not be locked */
+void mutex_destroy(mutex* m);
+/** @brief Blocks until the mutex is acquired */
+void mutex_lock(mutex* m);
+/** @brief Releases a mutex acquired by mutex_lock */
+void mutex_unlock(mutex* m);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** @brief Condition variable, always used together with a mutex */
+typedef struct condvar
+{
+#ifdef _WIN32
+	void* handle; // CONDITION_VARIABLE
+#else
+	pthread_cond_t handle;
+#endif
+} condvar;
+
+/** @brief Initializes a new condition variable */
+void condvar_init(condvar* c);
+/** @brief Destroys the condition variable, no threads may be waiting on it */
+void condvar_destroy(condvar* c);
+/** @brief Atomically unlocks the mutex and waits for a signal, relocks before returning */
+void condvar_wait(condvar* c, mutex* m);
+/** @brief Wakes up one waiting thread */
+void condvar_signal(condvar* c);
+/** @brief Wakes up all waiting threads */
+void condvar_broadcast(condvar* c);
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef void (*ThreadFunc)(void* arg);
+
+/** @brief OS thread handle */
+typedef struct thread
+{
+#ifdef _WIN32
+	void* handle; // HANDLE
+#else
+	pthread_t handle;
+#endif
+} thread;
+
+/**
+ * @brief Starts a new thread running func(arg)
+ * @return TRUE if the thread was started
+ */
+bool thread_start(thread* t, ThreadFunc func, void* arg);
+/** @brief Waits until the thread has finished */
+void thread_join(thread* t);
+
+/** @return Number of logical CPU cores, at least 1 */
+int thread_cpu_count(void);
+
+////////////////////////////////////////////////////////////////////////////////
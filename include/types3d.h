@@ -101,6 +101,25 @@ typedef struct vertex_t
 	};
 } vertex_t; // 3D vertex consisting of POS3D,TEX2D,NORM3D
 
+typedef struct qvertex_t
+{
+	unsigned short x, y, z, w; // position quantized to [0,65535] inside the mesh bounds, w = 0
+	unsigned short u, v;       // half float UV coordinates
+	short nx, ny;              // octahedral encoded normal, normalized to [-1,1]
+} qvertex_t; // 16-byte compressed vertex of BMD v2 models, see BMDModel
+
+// @return float converted to a IEEE 754 half float, rounding to nearest even
+unsigned short half_from_float(float f);
+
+// @return IEEE 754 half float converted to float
+float half_to_float(unsigned short h);
+
+// @return unit vector n encoded into the [-1,1] octahedral square
+vec2 oct_encode(vec3 n);
+
+// @return unit vector decoded from the [-1,1] octahedral square
+vec3 oct_decode(vec2 e);
+
 ////////////////////////////////////////////////////////////////////////////////
 // A 4x4 matrix for affine transformations
 
@@ -174,4 +193,27 @@ mat4* mat4_from_rotation(mat4* out, vec3 rotation);
 // creates a scaled matrix from XYZ scale
 mat4* mat4_from_scale(mat4* out, vec3 scale);
 
-////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+////////////////////////////////////////////////////////////////////////////////
+// Bounding volumes of a point set: an AABB and a bounding sphere around its center
+
+typedef struct bounds3d
+{
+	vec3  min, max; // axis aligned bounding box
+	vec3  center;   // bounding sphere center, the AABB center
+	float radius;   // bounding sphere radius
+} bounds3d;
+
+// computes the bounds of count XYZ float points spaced stride bytes apart, ex: &verts[0].pos
+// uses SSE min/max reductions where available
+bounds3d bounds_from_points(const float* points, int count, int stride);
+
+// same as bounds_from_points() for 16-bit XYZ points quantized into the [min,max] box,
+// ex: BMD v2 qvertex_t positions; the AABB is taken as is, only the sphere is computed
+bounds3d bounds_from_qpoints(const unsigned short* points, int count, int stride, vec3 min, vec3 max);
+
+// transforms bounds by an affine matrix, ex: actor_affine_matrix(); the AABB stays tight
+// around the transformed box [Arvo 1990], the radius grows by the largest scale, which is
+// exact for matrices made of translation, rotation and scale but not for shears
+bounds3d bounds_transform(const bounds3d* b, const mat4* affine);
+
+////////////////////////////////////////////////////////////////////////////////
@@ -27,7 +27,15 @@ int fsize(FILE* f);
 unsigned long long fnv64(const void* data, size_t length);
 
 /**
- * Normalizes a relative path string
+ * @return 64-bit xxHash64 of data. Four independent lanes per 32-byte stripe,
+ *         so it runs near memory bandwidth; use it for bulk data instead of fnv64.
+ */
+unsigned long long xxhash64(const void* data, size_t length, unsigned long long seed);
+
+/**
+ * Normalizes a relative path string in memory, using '/' as the separator
+ * Only absolute paths or '..' escaping the working directory consult the cwd,
+ * which is queried once and cached.
  * DST buffer must have room for at least PATH_MAX bytes
  * ex before: ./data/models/../something.ext
  * ex after:  data/models/something.ext
@@ -47,6 +55,9 @@ char* normalized_datapath(char* dst, const char* relativePath);
  */
 const char* filepart(const char* str, int len);
 
+/** @return Current timer value in seconds */
+double timer_now(void);
+
 /**
  * Combines frame_vsync(dt) and timer_elapsed() to wait
  * until desiredFPS has been synced.
@@ -1,12 +1,32 @@
 #pragma once
 #include "shader.h"
+#include "vector.h"
+#include "thread.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// component type of a vertex attribute
+typedef enum VertexType
+{
+	VT_FLOAT,   // 32-bit float, the default
+	VT_HALF,    // 16-bit half float
+	VT_UNORM16, // unsigned short, normalized to a [0,1] float
+	VT_SNORM16, // short, normalized to a [-1,1] float
+	VT_UNORM8,  // unsigned byte, normalized to a [0,1] float
+	VT_SNORM8,  // byte, normalized to a [-1,1] float
+	VT_UINT8,   // unsigned byte, read as an integer (uint/uvec) attribute
+	VT_UINT16,  // unsigned short, read as an integer attribute
+	VT_INT16,   // short, read as an integer (int/ivec) attribute
+	VT_UINT32,  // unsigned int, read as an integer attribute
+	VT_INT32,   // int, read as an integer attribute
+	VT_MaxTypes,
+} VertexType;
+
 // describes a single element in a vertex (visualized by .natvis)
 typedef struct vertex_descr_elem {
 	unsigned char attr; // ShaderAttr vertex attribute slot identifier (a_Position, etc.)
-	unsigned char size; // Number of elements per attribute (1-4 floats or ints)
+	unsigned char size; // Number of components per attribute (1-4)
+	unsigned char type; // VertexType of each component, VT_FLOAT if left 0
 } vertex_descr_elem;
 
 // vertex layout descriptor (visualized by .natvis)
@@ -24,6 +44,7 @@ typedef struct vertex_array
 	unsigned indexBuf;     // element buffer object (if exists)
 	unsigned vertexCount;  // number of vertices
 	unsigned indexCount;   // num element buffer indices (if ebo exists)
+	unsigned indexType;    // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT element type (if ebo exists)
 	vertex_descr descr;    // vertex layout descriptor
 } vertex_array;
 
@@ -46,7 +67,7 @@ vertex_descr vd_create(int sizeOf, ShaderAttr attr0, int size0, ...);
  * @param numVerts   Number of vertices, each sizeOf bytes
 
  * @example struct Vertex3UV { vec3 pos; vec2 tex; };
- * @example vertex_descr vd = { sizeof(Vertex3UV), a_Position,3, a_Coord,2 };
+ * @example vertex_descr vd = { sizeof(Vertex3UV), {{a_Position,3}, {a_Coord,2}} };
  * @example va_new_array(verts, nverts, vd);
  * 
  */
@@ -54,13 +75,16 @@ vertex_array* va_new_array(const void* vertices, int numVerts, vertex_descr vd);
 
 /**
  * Creates a new VBO to store a vertex element array
+ * @note  Data is streamed in chunks through the staging ring, see staging.h, so a memory
+ *        mapped model file is read while the GPU copies the chunks before it
  * @param vertices   Pointer to vertex data
  * @param numVerts   Number of vertices, each sizeOf bytes
- * @param indices    Pointer to index data
+ * @param indices    Pointer to index data, narrowed to a 16-bit index buffer if numVerts <= 65536,
+ *                   which halves its size, see indexType
  * @param numIndices Number of indices
  *
  * @example struct Vertex3UV { vec3 pos; vec2 tex; };
- * @example vertex_descr vd = { sizeof(Vertex3UV), a_Position,3, a_Coord,2 };
+ * @example vertex_descr vd = { sizeof(Vertex3UV), {{a_Position,3}, {a_Coord,2}} };
  * @example va_new_indexed_array(verts, nverts, indices, nindices, vd);
  * 
  */
@@ -68,6 +92,9 @@ vertex_array* va_new_indexed_array(const void* vertices, int numVerts,
                                    const index_t* indices, int numIndices, 
                                    vertex_descr vd);
 
+/** @return Bytes per index of an indexType, 2 for GL_UNSIGNED_SHORT, otherwise 4 */
+int va_index_size(unsigned indexType);
+
 
 
 /** @brief Destroys vertex array object and buffers */
@@ -76,4 +103,69 @@ void va_destroy(vertex_array* va);
 /** @brief Draws this vertex array object. */
 void va_draw(vertex_array* va);
 
+////////////////////////////////////////////////////////////////////////////////
+//// Geometry pool: static meshes sub-allocated from shared buffers behind one VAO per vertex
+//// layout, so drawing different meshes doesn't rebind a VAO or allocate a buffer per mesh
+
+// free range of a geometry pool buffer
+typedef struct gp_block
+{
+	int offset; // vertices in the vertex buffer, bytes in the index buffer
+	int size;
+} gp_block;
+
+// shared vertex and index buffers of one vertex layout, see gp_shared()
+typedef struct geometry_pool
+{
+	vertex_array va;          // shared VAO and buffers, vertexCount is the vertex capacity
+	                          // and indexCount the index buffer capacity in bytes
+	vector       freeVerts;   // vector<gp_block> free vertex ranges sorted by offset
+	vector       freeIndices; // vector<gp_block> free index ranges sorted by offset, 4-byte aligned
+	int          usedVerts;   // allocated vertices
+	int          usedIndices; // allocated index bytes
+	mutex        lock;        // guards the free lists, meshes may be freed on any thread
+} geometry_pool;
+
+// a mesh inside a geometry_pool
+typedef struct gp_range
+{
+	int      baseVertex; // first vertex, glDrawElementsBaseVertex adds it to every index
+	int      numVerts;   // number of vertices
+	int      firstIndex; // first index, in units of indexType
+	int      numIndices; // number of indices
+	unsigned indexType;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+} gp_range;
+
+/**
+ * @brief Gets the process wide pool for a vertex layout, creating it on first use
+ * @note  Must be called on the GL thread, pools live until gp_shutdown()
+ */
+geometry_pool* gp_shared(vertex_descr vd);
+
+/**
+ * @brief Sub-allocates a mesh in the pool and streams its data in, see staging.h.
+ *        The buffers double in size when the free lists have no fitting range.
+ * @param indexSize 2 for unsigned short indices, 4 for index_t, relative to the mesh's vertices.
+ *                  index_t indices of meshes with <= 65536 vertices are stored as 16-bit
+ * @return FALSE if the pool can't grow
+ */
+bool gp_alloc(geometry_pool* gp, gp_range* out, const void* vertices, int numVerts,
+              const void* indices, int numIndices, int indexSize);
+
+/** @brief Returns the mesh's ranges to the free lists, merging them with their neighbours.
+ *         Doesn't call OpenGL, safe to call from any thread */
+void gp_free(geometry_pool* gp, const gp_range* r);
+
+/**
+ * @brief Draws count indices of a mesh starting at first, ex: one mesh LOD.
+ *        The pool's VAO stays bound, consecutive draws from one pool skip the bind.
+ */
+void gp_draw_range(geometry_pool* gp, const gp_range* r, int first, int count);
+
+/** @brief Draws n index ranges of a mesh in one glMultiDrawElementsBaseVertex call */
+void gp_draw_multi(geometry_pool* gp, const gp_range* r, const int* first, const int* count, int n);
+
+/** @brief Destroys all shared pools, after every mesh in them was freed */
+void gp_shutdown(void);
+
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
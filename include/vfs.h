@@ -0,0 +1,89 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Pack file layout, all offsets are from the start of the pack:
+ *   vfs_pack_header
+ *   file data, each file aligned to VFS_PACK_ALIGN bytes
+ *   vfs_pack_entry[numEntries] sorted by (hash, name)
+ *   name strings, 0-terminated
+ */
+#define VFS_PACK_MAGIC   "GPAK"
+#define VFS_PACK_VERSION 1
+#define VFS_PACK_ALIGN   16
+
+typedef struct vfs_pack_header
+{
+	char     magic[4];   // VFS_PACK_MAGIC
+	uint32_t version;    // VFS_PACK_VERSION
+	uint32_t numEntries; // number of files in the pack
+	uint32_t tocOffset;  // offset of the sorted vfs_pack_entry table
+} vfs_pack_header;
+
+typedef struct vfs_pack_entry
+{
+	uint64_t hash;       // fnv64 of the normalized file path, ex: "data/statue_mage.bmd"
+	uint32_t offset;     // offset of the file data
+	uint32_t size;       // size of the file data in bytes
+	uint32_t nameOffset; // offset of the 0-terminated file path
+	uint32_t nameLen;    // length of the file path
+} vfs_pack_entry;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** A read-only view of a file, either inside the mounted pack or read from a loose file */
+typedef struct vfs_file
+{
+	const void* data;     // file contents, a zero-copy view if the file is packed
+	int         size;     // size of the file in bytes
+	time_t      modified; // last modified time of the file, or of the pack
+	bool        owned;    // TRUE if data was read from a loose file and must be freed
+	bool        mapped;   // TRUE if data is a private mapping of a loose file and must be unmapped
+} vfs_file;
+
+/**
+ * @brief Memory maps a pack file, which is then searched before any loose files
+ * @note  Must not overlap with any vfs_open() calls, mount before loading anything
+ * @return FALSE if the pack doesn't exist or is invalid, loose files are still served
+ */
+bool vfs_mount(const char* packPath);
+
+/** @brief Unmaps the pack, any views into it become invalid */
+void vfs_unmount(void);
+
+/** @return TRUE if a pack is currently mounted */
+bool vfs_mounted(void);
+
+/**
+ * @brief Opens a file from the mounted pack, falling back to loose files
+ * @note  Safe to call from any thread
+ * @param path Normalized file path, ex: "data/statue_mage.bmd"
+ * @return FALSE if the file doesn't exist in the pack or on disk
+ */
+bool vfs_open(vfs_file* f, const char* path);
+
+/**
+ * @brief Like vfs_open(), but memory maps loose files instead of reading them,
+ *        so large files are never copied and their pages are shared with the OS cache
+ * @note  A loose file must not be truncated while it's mapped, rewrite it through a rename
+ */
+bool vfs_map(vfs_file* f, const char* path);
+
+/** @brief Releases the file view, frees or unmaps loose file data */
+void vfs_close(vfs_file* f);
+
+/**
+ * @brief Hashes the file contents with xxhash64, packed files are hashed in place and
+ *        loose files through vfs_map(), so their pages stay in the OS cache for the read
+ * @return FALSE if the file doesn't exist in the pack or on disk
+ */
+bool vfs_hash(const char* path, uint64_t* hash, int* size);
+
+/** @return Last modified time of the file, 0 if it doesn't exist. Packed files never stat */
+time_t vfs_modified(const char* path);
+
+////////////////////////////////////////////////////////////////////////////////
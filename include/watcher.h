@@ -0,0 +1,48 @@
+#pragma once
+/**
+ * Recursive directory watcher running on a background thread.
+ * Uses inotify on Linux and ReadDirectoryChangesW on Windows.
+ */
+#include <stdbool.h>
+#include "thread.h"
+#include "vector.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// queue of changed file paths, filled by the watcher thread
+typedef struct file_watcher
+{
+	mutex   lock;    // guards changed
+	pvector changed; // vector<char*> normalized paths of modified files, without duplicates
+	thread  worker;  // background thread waiting for change events
+	char    dir[260]; // watched directory
+#ifdef _WIN32
+	void*   handle;  // directory HANDLE, opened for overlapped reads
+	void*   quit;    // event that wakes the worker up on destroy
+#else
+	int     fd;      // inotify descriptor
+	int     wake[2]; // pipe that wakes the worker up on destroy
+	pvector dirs;    // vector<char*> watched directory path per inotify watch descriptor
+#endif
+} file_watcher;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Starts watching a directory and all its subdirectories for modified files
+ * @param dir Relative directory path, ex: "data"
+ * @return NULL if watching is not supported or the directory doesn't exist
+ */
+file_watcher* watcher_create(const char* dir);
+
+/** @brief Stops the watcher thread and frees the watcher */
+void watcher_destroy(file_watcher* w);
+
+/**
+ * @brief Pops the next modified file path. Never blocks.
+ * @param path Receives the normalized path, ex: "data/shaders/simple.vert"
+ * @return FALSE if there are no more changes
+ */
+bool watcher_poll(file_watcher* w, char* path, int maxLen);
+
+////////////////////////////////////////////////////////////////////////////////
@@ -2,6 +2,7 @@
 #include <GL/glfw3.h>
 #include "actor.h"
 #include "vector.h"
+#include "taskpool.h"
 
 typedef struct Camera // camera inherits from Actor, does not have any model
 {
@@ -29,6 +30,16 @@ typedef struct World
 	ShaderManager* shaderMgr;  // shader resource pool
 	MeshManager*   meshMgr;    // mesh resource pool
 	TexManager*    textureMgr; // texture resource pool
+	taskpool*      loader;     // worker threads for async resource reads
+	double         loadBudget; // seconds per frame spent finalizing async loads
+	struct file_watcher* watcher; // changed files under data/, NULL if running from a pack
+	size_t         meshBudget;    // bytes of unused meshes kept cached, see ResManager::budget
+	size_t         textureBudget; // bytes of unused textures kept cached
+	const char*    manifestPath;    // startup preload manifest, NULL disables recording and prefetching
+	double         manifestSeconds; // loads during the first seconds of play are recorded
+	double         recordUntil;     // timer_now() when recording stops, 0 if not recording
+	pvector        manifest;        // vector<char*> "kind path" lines recorded this run
+	pvector        preloaded;       // vector<Resource*> prefetched resources, released after begin_play
 
 	Camera* camera;            // current camera actor
 	Camera  defaultCamera;     // default camera actor
@@ -50,3 +61,30 @@ StaticMesh* world_load_mesh(World* world,    const char* modelPath);
 Texture*    world_load_texture(World* world, const char* texturePath);
 Material    world_load_material(World* world, const char* shaderPath, const char* texturePath);
 
+// async variants return a RES_PENDING resource right away, see resource_load_async()
+StaticMesh* world_load_mesh_async(World* world,    const char* modelPath);
+Texture*    world_load_texture_async(World* world, const char* texturePath);
+Material    world_load_material_async(World* world, const char* shaderPath, const char* texturePath);
+
+// finalizes finished async loads on the GL thread, called by world_main_loop every frame
+void world_pump_loads(World* world, double timeBudget);
+
+// evicts least recently used meshes and textures that exceed their budgets, called every frame
+void world_clean_unused(World* world);
+
+// reloads resources whose files changed on disk in place, called by world_main_loop every frame
+// @return Number of reloaded resources
+int world_reload_changed(World* world);
+
+// prefetches every resource listed in world->manifestPath in parallel and waits until they're
+// ready, called by world_main_loop before begin_play so its loads become cache hits
+// @return Number of prefetched resources
+int world_prefetch_manifest(World* world);
+
+// writes the loads recorded since begin_play to world->manifestPath and stops recording,
+// called by world_main_loop once world->manifestSeconds have passed
+bool world_save_manifest(World* world);
+
+// dumps resource manager and staging upload stats of the world, as text or one JSON object each
+void world_dump_stats(World* world, FILE* out, bool json);
+
@@ -31,18 +31,19 @@ void actor_clear(Actor* a)
 }
 void actor_clear_mesh(Actor * a)
 {
-	if (a->mesh) resource_free(&a->mesh->res), a->mesh = 0;
+	if (a->mesh) resource_free_handle(a->mesh), a->mesh = 0;
 }
 void actor_clear_material(Actor* a)
 {
-	if (a->material.texture) 
+	if (a->material.shader || a->material.texture) 
 		material_destroy(&a->material);
 }
 
 bool actor_mesh(Actor* a, StaticMesh* mesh)
 {
 	actor_clear_mesh(a);
-	return (a->mesh = mesh) != NULL;
+	a->mesh = mesh ? resource_handle(&mesh->res) : 0;
+	return mesh != NULL;
 }
 
 bool actor_material(Actor* a, Material* mat)
@@ -52,6 +53,11 @@ bool actor_material(Actor* a, Material* mat)
 	return a->material.shader && a->material.texture;
 }
 
+StaticMesh* actor_get_mesh(const Actor* a)
+{
+	return iresource_resolve(StaticMesh, a->mesh);
+}
+
 void actor_affine_matrix(mat4* out, const Actor* a)
 {
 	mat4_from_position(out, a->pos);
@@ -61,29 +67,53 @@ void actor_affine_matrix(mat4* out, const Actor* a)
 	mat4_mul(out, &rot);
 }
 
+bool actor_world_bounds(bounds3d* out, const Actor* a)
+{
+	StaticMesh* mesh = actor_get_mesh(a);
+	if (!mesh || !resource_ready(&mesh->res))
+		return false;
+	mat4 model;
+	actor_affine_matrix(&model, a);
+	*out = bounds_transform(&mesh->bounds, &model);
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void actor_draw(Actor* a, const mat4* viewProjection)
 {
-	Shader*  shader  = a->material.shader;
-	Texture* texture = a->material.texture;
+	Shader*     shader  = material_shader(&a->material);
+	Texture*    texture = material_texture(&a->material);
+	StaticMesh* mesh    = actor_get_mesh(a);
 
-	if (!shader || !a->mesh || !a->mesh->array) {
+	if (mesh && !resource_ready(&mesh->res))
+		return; // still loading asynchronously
+	if (!shader || !mesh) {
 		LOG("actor_draw() error: attempted to draw without a shader or mesh\n");
 		return;
 	}
 
 	shader_bind(shader); // bind, but don't explicitly unbind
 	{
-		mat4 model;
+		mat4 model, dequantize, mvp = *viewProjection;
 		actor_affine_matrix(&model, a);
+		a->lod = mesh->numLods > 1
+			? mesh_select_lod(mesh, mesh_projected_size(mesh, &model, viewProjection), a->lod) : 0;
+		mat4_mul(&mvp, &model); // meshlets are culled in model space, before dequantizing
+		if (mesh_dequantize_matrix(mesh, &dequantize)) // BMD v2+ positions are [0,1] inside the bounds
+			mat4_mul(&model, &dequantize);
 		shader_bind_mat_mvp(shader, viewProjection, &model);
-		shader_bind_tex_diffuse(shader, texture->glTexture);
+		shader_bind_tex_diffuse(shader, 
+			texture && resource_ready(&texture->res) ? texture->glTexture : 0);
 
 		//shader_bind_attributes(shader);
 
-		// draw vertex_array bound to our mesh
-		va_draw(a->mesh->array);
+		// draw the selected LOD from the mesh's geometry pool, only its visible meshlets
+		const BMDLod* lod = &mesh->lods[a->lod];
+		if (lod->num_meshlets)
+			mesh_draw_meshlets(mesh, a->lod, &mvp);
+		else
+			gp_draw_range(mesh->pool, &mesh->range, lod->first_index, lod->num_indices);
 
 		//shader_unbind_attributes(shader);
 	}
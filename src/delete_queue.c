@@ -0,0 +1,141 @@
+#include "delete_queue.h"
+#include <GL/glew.h>
+#include <stdlib.h>
+#include <string.h> // memmove
+#include "thread.h"
+#include "vector.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct dq_pending_free
+{
+	GLsync fence; // fence issued after the frame the free was queued in, NULL until flushed
+	DeleteQueue_FreeFunc func;
+	void* ptr;
+} dq_pending_free;
+
+enum { DQ_BUFFERS, DQ_TEXTURES, DQ_ARRAYS, DQ_PROGRAMS, DQ_NUM_TYPES };
+
+static struct
+{
+	bool   enabled;
+	mutex  lock;                // guards everything below, free funcs may run on any thread
+	vector names[DQ_NUM_TYPES]; // vector<GLuint> queued GL object names per object type
+	vector frees;               // vector<dq_pending_free> oldest first, fences signal in order
+	int    fenced;              // frees[0..fenced) already have a fence
+} dq;
+
+static void delete_names(int type, int count, const GLuint* names)
+{
+	if (!count) return;
+	switch (type) {
+		case DQ_BUFFERS:  glDeleteBuffers(count, names);      break;
+		case DQ_TEXTURES: glDeleteTextures(count, names);     break;
+		case DQ_ARRAYS:   glDeleteVertexArrays(count, names); break;
+		case DQ_PROGRAMS: // there is no multi-object glDeleteProgram
+			for (int i = 0; i < count; ++i) glDeleteProgram(names[i]);
+			break;
+	}
+}
+
+static void queue_name(int type, GLuint name)
+{
+	if (!name) return;
+	if (!dq.enabled) { // not queueing, delete right away
+		delete_names(type, 1, &name);
+		return;
+	}
+	mutex_lock(&dq.lock);
+	vector_append(&dq.names[type], &name);
+	mutex_unlock(&dq.lock);
+}
+
+void dq_delete_buffer(unsigned buffer)       { queue_name(DQ_BUFFERS,  buffer);  }
+void dq_delete_texture(unsigned texture)     { queue_name(DQ_TEXTURES, texture); }
+void dq_delete_vertex_array(unsigned vao)    { queue_name(DQ_ARRAYS,   vao);     }
+void dq_delete_program(unsigned program)     { queue_name(DQ_PROGRAMS, program); }
+
+void dq_free(void* ptr, DeleteQueue_FreeFunc freeFunc)
+{
+	if (!ptr) return;
+	if (!dq.enabled) {
+		freeFunc(ptr);
+		return;
+	}
+	dq_pending_free f = { NULL, freeFunc, ptr };
+	mutex_lock(&dq.lock);
+	vector_append(&dq.frees, &f);
+	mutex_unlock(&dq.lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void dq_init(void)
+{
+	if (dq.enabled) return;
+	mutex_init(&dq.lock);
+	for (int i = 0; i < DQ_NUM_TYPES; ++i)
+		vector_create(&dq.names[i], sizeof(GLuint));
+	vector_create(&dq.frees, sizeof(dq_pending_free));
+	dq.fenced  = 0;
+	dq.enabled = true;
+}
+
+// runs the CPU frees whose fence has signaled, or all of them if waitAll
+static void run_signaled_frees(bool waitAll)
+{
+	dq_pending_free* f = vector_data(&dq.frees, dq_pending_free);
+	int done = 0;
+	while (done < dq.fenced) {
+		GLsync fence = f[done].fence;
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, waitAll ? GL_TIMEOUT_IGNORED : 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED && !waitAll)
+			break; // later fences can't have signaled either
+		glDeleteSync(fence);
+		for (; done < dq.fenced && f[done].fence == fence; ++done)
+			f[done].func(f[done].ptr);
+	}
+	if (done) { // compact, the few remaining entries are recent frames
+		memmove(f, f + done, (dq.frees.size - done) * sizeof(dq_pending_free));
+		dq.frees.size -= done;
+		dq.fenced     -= done;
+	}
+}
+
+int dq_flush(void)
+{
+	if (!dq.enabled) return 0;
+	int deleted = 0;
+	mutex_lock(&dq.lock);
+	for (int i = 0; i < DQ_NUM_TYPES; ++i) {
+		delete_names(i, dq.names[i].size, vector_data(&dq.names[i], GLuint));
+		deleted += dq.names[i].size;
+		vector_clear(&dq.names[i]);
+	}
+	if (dq.fenced < dq.frees.size) { // one fence covers everything queued this frame
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		dq_pending_free* f = vector_data(&dq.frees, dq_pending_free);
+		for (; dq.fenced < dq.frees.size; ++dq.fenced)
+			f[dq.fenced].fence = fence;
+	}
+	run_signaled_frees(false);
+	mutex_unlock(&dq.lock);
+	return deleted;
+}
+
+void dq_shutdown(void)
+{
+	if (!dq.enabled) return;
+	dq_flush();
+	mutex_lock(&dq.lock);
+	run_signaled_frees(true);
+	dq.enabled = false;
+	mutex_unlock(&dq.lock);
+
+	for (int i = 0; i < DQ_NUM_TYPES; ++i)
+		vector_destroy(&dq.names[i]);
+	vector_destroy(&dq.frees);
+	mutex_destroy(&dq.lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
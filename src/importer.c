@@ -0,0 +1,1365 @@
+#include "importer.h"
+#include <stdlib.h> // malloc
+#include <limits.h> // INT_MIN
+#include <string.h> // memcpy, memchr
+#include <math.h>   // floorf, sqrtf
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h> // QueryPerformanceCounter
+#else
+	#include <time.h>    // clock_gettime
+#endif
+#include "taskpool.h"
+#include "util.h"
+#include "vfs.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define OBJ_CHUNK_SIZE  (1 << 20) // smallest OBJ text chunk parsed by one task
+#define OBJ_MISSING     INT_MIN   // face corner without a uv or normal index
+#define OBJ_RELATIVE    (1 << 30) // bias of negative (relative) face indices, see obj_index()
+#define WELD_SHARD_BITS 6         // 64 shards, deduplicated in parallel
+#define WELD_RANGE_SIZE 16384     // smallest range of corners hashed by one task
+
+// timer that works without a GL context, the importer also runs in command line tools
+static double seconds(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart / freq.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+// queues func for every item and waits until all of them have finished
+static void run_all(taskpool* pool, TaskFunc func, void* items, int count, int sizeOf)
+{
+	for (int i = 0; i < count; ++i)
+		taskpool_run(pool, func, (char*)items + i * sizeOf);
+	taskpool_wait(pool);
+}
+
+static char* copy_name(char* dst, const char* src, int len) // dst[32]
+{
+	if (len > 31) len = 31;
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+	return dst;
+}
+
+// model name from a path, ex: "data/models/statue_mage.obj" ==> "statue_mage"
+static void name_from_path(char* dst, const char* path) // dst[32]
+{
+	const char* file = filepart(path, (int)strlen(path));
+	const char* ext  = strrchr(file, '.');
+	copy_name(dst, file, ext ? (int)(ext - file) : (int)strlen(file));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// vertex streams and triangle corners of a model, before welding
+typedef struct import_mesh
+{
+	float* positions; int numPositions; // xyz
+	float* uvs;       int numUvs;       // uv
+	float* normals;   int numNormals;   // xyz
+	int*   corners;   int numCorners;   // position, uv, normal index per corner, uv and normal -1 if missing
+	char   name[32];
+	char   texture[32];
+} import_mesh;
+
+static void import_mesh_free(import_mesh* m)
+{
+	free(m->positions);
+	free(m->uvs);
+	free(m->normals);
+	free(m->corners);
+}
+
+// growable streams, faster than vector_append() for millions of floats
+typedef struct fbuf { float* data; int size, capacity; } fbuf;
+typedef struct ibuf { int*   data; int size, capacity; } ibuf;
+
+static void* buf_reserve(void* data, int* capacity, int needed, int sizeOf)
+{
+	int cap = *capacity ? *capacity : 1024;
+	while (cap < needed) cap *= 2;
+	*capacity = cap;
+	return realloc(data, (size_t)cap * sizeOf);
+}
+static inline float* fbuf_push(fbuf* b, int n)
+{
+	if (b->size + n > b->capacity)
+		b->data = buf_reserve(b->data, &b->capacity, b->size + n, sizeof(float));
+	float* p = b->data + b->size;
+	b->size += n;
+	return p;
+}
+static inline int* ibuf_push(ibuf* b, int n)
+{
+	if (b->size + n > b->capacity)
+		b->data = buf_reserve(b->data, &b->capacity, b->size + n, sizeof(int));
+	int* p = b->data + b->size;
+	b->size += n;
+	return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const double POW10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline bool is_digit(char c) { return (unsigned)(c - '0') < 10; }
+static inline bool is_blank(char c) { return c == ' ' || c == '\t'; }
+
+/**
+ * Parses a decimal float without strtof()'s locale and errno overhead. Up to 19 significant
+ * digits are gathered into an integer, which is scaled by an exact power of ten, so the usual
+ * mantissas of exporters (up to 15 digits) give the correctly rounded double before float
+ * rounding [Clinger 1990]. Huge exponents fall back to pow().
+ * @return End of the number, s if there was none and *out is set to 0
+ */
+static const char* parse_float(const char* s, const char* end, float* out)
+{
+	const char* p = s;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+
+	unsigned long long mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool any = false;
+	for (; p < end && is_digit(*p); ++p, any = true) {
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits += mantissa != 0; }
+		else ++exponent; // dropped integer digits still scale the value
+	}
+	if (p < end && *p == '.') {
+		for (++p; p < end && is_digit(*p); ++p, any = true) {
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); digits += mantissa != 0; --exponent; }
+		}
+	}
+	if (!any) {
+		*out = 0.0f;
+		return s;
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* e = p + 1;
+		bool negExp = false;
+		if (e < end && (*e == '-' || *e == '+'))
+			negExp = *e++ == '-';
+		if (e < end && is_digit(*e)) {
+			int x = 0;
+			for (; e < end && is_digit(*e); ++e)
+				if (x < 100000) x = x * 10 + (*e - '0');
+			exponent += negExp ? -x : x;
+			p = e;
+		}
+	}
+
+	double v = (double)mantissa;
+	if (mantissa && exponent) {
+		if      (exponent < 0 && exponent >= -22) v /= POW10[-exponent];
+		else if (exponent > 0 && exponent <=  22) v *= POW10[exponent];
+		else v *= pow(10.0, exponent);
+	}
+	*out = (float)(negative ? -v : v);
+	return p;
+}
+
+// parses up to n blank separated floats, missing ones are 0
+static const char* parse_floats(const char* s, const char* end, float* out, int n)
+{
+	for (int i = 0; i < n; ++i) {
+		while (s < end && is_blank(*s)) ++s;
+		s = parse_float(s, end, &out[i]);
+	}
+	return s;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// a line aligned part of the OBJ text, parsed by one task
+typedef struct obj_chunk
+{
+	const char*  begin;
+	const char*  end;
+	fbuf positions, uvs, normals;
+	ibuf corners;        // 3 indices per corner, see obj_index()
+	const char*  usemtl; // first material used in this chunk, or NULL
+	const char*  mtllib; // first material library of this chunk, or NULL
+	int basePosition, baseUv, baseNormal, baseCorner; // offsets into the merged mesh
+	import_mesh* mesh;
+	bool         invalid; // an index was 0 or out of range
+} obj_chunk;
+
+/**
+ * Parses a face index. Absolute indices are stored zero based; relative (negative) ones
+ * can't be resolved until the vertex counts of earlier chunks are known, so they're stored
+ * as chunk local indices biased by -OBJ_RELATIVE, which keeps them negative.
+ */
+static const char* obj_index(obj_chunk* c, const char* s, const char* end, int localCount, int* out)
+{
+	bool negative = s < end && *s == '-';
+	const char* p = s + negative;
+	int v = 0;
+	if (p >= end || !is_digit(*p)) {
+		*out = OBJ_MISSING;
+		return s;
+	}
+	for (; p < end && is_digit(*p); ++p)
+		if (v < OBJ_RELATIVE) v = v * 10 + (*p - '0');
+	if (v == 0 || v >= OBJ_RELATIVE) c->invalid = true;
+	*out = negative ? localCount - v - OBJ_RELATIVE : v - 1;
+	return p;
+}
+
+// reads the corners of a face and fan triangulates it
+static const char* obj_face(obj_chunk* c, const char* s, const char* end)
+{
+	int first[3], prev[3], cur[3];
+	const int numPositions = c->positions.size / 3;
+	const int numUvs       = c->uvs.size / 2;
+	const int numNormals   = c->normals.size / 3;
+	for (int n = 0; ; ++n) {
+		while (s < end && is_blank(*s)) ++s;
+		if (s >= end || !(is_digit(*s) || *s == '-'))
+			break;
+		s = obj_index(c, s, end, numPositions, &cur[0]);
+		cur[1] = cur[2] = OBJ_MISSING;
+		if (s < end && *s == '/') {
+			s = obj_index(c, s + 1, end, numUvs, &cur[1]);
+			if (s < end && *s == '/')
+				s = obj_index(c, s + 1, end, numNormals, &cur[2]);
+		}
+		if (cur[0] == OBJ_MISSING) { // ex: "f 1/" garbage
+			c->invalid = true;
+			break;
+		}
+		if (n == 0) memcpy(first, cur, sizeof(cur));
+		else if (n >= 2) {
+			int* dst = ibuf_push(&c->corners, 9);
+			memcpy(dst,     first, sizeof(cur));
+			memcpy(dst + 3, prev,  sizeof(cur));
+			memcpy(dst + 6, cur,   sizeof(cur));
+		}
+		memcpy(prev, cur, sizeof(cur));
+	}
+	return s;
+}
+
+static bool obj_keyword(const char* s, const char* end, const char* keyword, int len)
+{
+	return end - s > len && memcmp(s, keyword, len) == 0 && is_blank(s[len]);
+}
+
+static void obj_parse_chunk(obj_chunk* c)
+{
+	const char* s   = c->begin;
+	const char* end = c->end;
+	while (s < end) {
+		while (s < end && is_blank(*s)) ++s;
+		if (end - s > 1 && s[0] == 'v' && is_blank(s[1])) {
+			s = parse_floats(s + 2, end, fbuf_push(&c->positions, 3), 3);
+		}
+		else if (end - s > 2 && s[0] == 'v' && s[1] == 't' && is_blank(s[2])) {
+			float* uv = fbuf_push(&c->uvs, 2);
+			s = parse_floats(s + 3, end, uv, 2);
+			uv[1] = 1.0f - uv[1]; // OBJ has a bottom left origin, our images are top row first
+		}
+		else if (end - s > 2 && s[0] == 'v' && s[1] == 'n' && is_blank(s[2])) {
+			s = parse_floats(s + 3, end, fbuf_push(&c->normals, 3), 3);
+		}
+		else if (end - s > 1 && s[0] == 'f' && is_blank(s[1])) {
+			s = obj_face(c, s + 2, end);
+		}
+		else if (!c->usemtl && obj_keyword(s, end, "usemtl", 6)) c->usemtl = s + 7;
+		else if (!c->mtllib && obj_keyword(s, end, "mtllib", 6)) c->mtllib = s + 7;
+
+		const char* eol = memchr(s, '\n', end - s);
+		s = eol ? eol + 1 : end;
+	}
+}
+
+// copies the chunk into the merged mesh, resolving relative and checking all indices
+static void obj_merge_chunk(obj_chunk* c)
+{
+	import_mesh* m = c->mesh;
+	if (c->positions.size) memcpy(m->positions + c->basePosition * 3, c->positions.data, c->positions.size * sizeof(float));
+	if (c->uvs.size)       memcpy(m->uvs       + c->baseUv       * 2, c->uvs.data,       c->uvs.size       * sizeof(float));
+	if (c->normals.size)   memcpy(m->normals   + c->baseNormal   * 3, c->normals.data,   c->normals.size   * sizeof(float));
+	free(c->positions.data);
+	free(c->uvs.data);
+	free(c->normals.data);
+
+	const int base[3]  = { c->basePosition, c->baseUv, c->baseNormal };
+	const int count[3] = { m->numPositions, m->numUvs, m->numNormals };
+	const int* src = c->corners.data;
+	int* dst = m->corners + c->baseCorner * 3;
+	for (int i = 0; i < c->corners.size; i += 3) {
+		for (int k = 0; k < 3; ++k) {
+			int v = src[i + k];
+			if (v == OBJ_MISSING) {
+				v = -1;
+			} else {
+				if (v < 0) v += OBJ_RELATIVE + base[k];
+				if ((unsigned)v >= (unsigned)count[k]) c->invalid = true, v = -1;
+			}
+			dst[i + k] = v;
+		}
+		if (dst[i] < 0) c->invalid = true; // positions are required
+	}
+	free(c->corners.data);
+}
+
+static int line_length(const char* s, const char* end)
+{
+	const char* p = s;
+	while (p < end && *p != '\n' && *p != '\r') ++p;
+	while (p > s && is_blank(p[-1])) --p;
+	return (int)(p - s);
+}
+
+// parses the OBJ text into m, returns the first usemtl and mtllib lines
+static bool obj_parse(taskpool* pool, int numThreads, const char* text, int size, import_mesh* m,
+                      const char** usemtl, const char** mtllib)
+{
+	int numChunks = size / OBJ_CHUNK_SIZE;
+	if (numChunks > numThreads * 8) numChunks = numThreads * 8;
+	if (numChunks < 1) numChunks = 1;
+	obj_chunk* chunks = calloc(numChunks, sizeof(obj_chunk));
+
+	const char* end = text + size;
+	const char* begin = text;
+	for (int i = 0; i < numChunks; ++i) {
+		const char* split = i == numChunks - 1 ? end : text + (long long)size * (i + 1) / numChunks;
+		if (split < begin) split = begin;
+		const char* eol = split < end ? memchr(split, '\n', end - split) : NULL;
+		chunks[i].begin = begin;
+		chunks[i].end   = i == numChunks - 1 || !eol ? end : eol + 1;
+		chunks[i].mesh  = m;
+		begin = chunks[i].end;
+	}
+	run_all(pool, (TaskFunc)&obj_parse_chunk, chunks, numChunks, sizeof(obj_chunk));
+
+	*usemtl = *mtllib = NULL;
+	for (int i = 0; i < numChunks; ++i) {
+		obj_chunk* c = &chunks[i];
+		c->basePosition = m->numPositions; m->numPositions += c->positions.size / 3;
+		c->baseUv       = m->numUvs;       m->numUvs       += c->uvs.size / 2;
+		c->baseNormal   = m->numNormals;   m->numNormals   += c->normals.size / 3;
+		c->baseCorner   = m->numCorners;   m->numCorners   += c->corners.size / 3;
+		if (!*usemtl) *usemtl = c->usemtl;
+		if (!*mtllib) *mtllib = c->mtllib;
+	}
+	m->positions = malloc(sizeof(float) * 3 * (m->numPositions + 1));
+	m->uvs       = malloc(sizeof(float) * 2 * (m->numUvs + 1));
+	m->normals   = malloc(sizeof(float) * 3 * (m->numNormals + 1));
+	m->corners   = malloc(sizeof(int)   * 3 * (m->numCorners + 1));
+	run_all(pool, (TaskFunc)&obj_merge_chunk, chunks, numChunks, sizeof(obj_chunk));
+
+	bool valid = true;
+	for (int i = 0; i < numChunks; ++i)
+		valid &= !chunks[i].invalid;
+	free(chunks);
+	if (!valid) LOG("import_obj(): invalid face index in '%s'\n", m->name);
+	return valid;
+}
+
+// finds the map_Kd texture of material in the .mtl library next to the OBJ file
+static void obj_texture(import_mesh* m, const char* objPath, const char* usemtl, const char* mtllib, const char* end)
+{
+	if (!usemtl || !mtllib || !objPath) return;
+	char path[512];
+	const char* file = filepart(objPath, (int)strlen(objPath));
+	const int dirLen  = (int)(file - objPath);
+	const int libLen  = line_length(mtllib, end);
+	if (dirLen + libLen >= (int)sizeof(path)) return;
+	memcpy(path, objPath, dirLen);
+	memcpy(path + dirLen, mtllib, libLen);
+	path[dirLen + libLen] = '\0';
+
+	vfs_file f;
+	if (!vfs_open(&f, path)) {
+		LOG("import_obj(): material library '%s' not found\n", path);
+		return;
+	}
+	const int nameLen = line_length(usemtl, end);
+	const char* s   = f.data;
+	const char* eof = s + f.size;
+	bool inMaterial = false;
+	while (s < eof) {
+		while (s < eof && is_blank(*s)) ++s;
+		if (obj_keyword(s, eof, "newmtl", 6)) {
+			const char* name = s + 7;
+			while (name < eof && is_blank(*name)) ++name;
+			inMaterial = line_length(name, eof) == nameLen && memcmp(name, usemtl, nameLen) == 0;
+		}
+		else if (inMaterial && obj_keyword(s, eof, "map_Kd", 6)) {
+			const char* tex = s + 7; // options like -s 1 1 1 precede the file name, which is last
+			const int len = line_length(tex, eof);
+			const char* name = tex + len;
+			while (name > tex && !is_blank(name[-1])) --name;
+			const char* part = filepart(name, (int)(tex + len - name));
+			copy_name(m->texture, part, (int)(tex + len - part));
+			break;
+		}
+		const char* eol = memchr(s, '\n', eof - s);
+		s = eol ? eol + 1 : eof;
+	}
+	vfs_close(&f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// the welded vertex: position (or its grid cell when welding nearby positions), uv, normal
+typedef struct weld_key
+{
+	unsigned position[3];
+	unsigned uv[2];
+	unsigned normal[3];
+} weld_key;
+
+// a corner and the hash of its vertex
+typedef struct weld_slot { unsigned hash; int corner; } weld_slot;
+
+typedef struct weld_job weld_job;
+
+typedef struct weld_range // a range of corners
+{
+	weld_job* job;
+	int  begin, end;
+	int* shardOffsets;  // [1 << WELD_SHARD_BITS] corners per shard, then their scatter offsets
+	int* gatherOffsets; // [1 << WELD_SHARD_BITS] copy of the scatter offsets, to read the results back
+	int  firstVertex;   // id of the first vertex this range emits
+	int  numVerts;      // corners of this range that are the first use of their vertex
+	bool missingNormals;
+} weld_range;
+
+typedef struct weld_shard // corners of one hash shard
+{
+	weld_job* job;
+	int begin, end;     // range of job->shardCorners
+} weld_shard;
+
+struct weld_job
+{
+	const import_mesh* mesh;
+	float      invWeld;      // 1/weld grid size, 0 for bitwise welding
+	unsigned*  hashes;       // [numCorners] hash of each corner's vertex, then its vertex id
+	int*       first;        // [numCorners] first corner with the same vertex
+	weld_slot* shardCorners; // [numCorners] corners grouped by shard in corner order, then their first corner
+	vertex_t*  vertices;     // [numVerts] welded vertices
+	int*       vertexCorner; // [numVerts] first corner of each vertex
+	index_t*   indices;      // [numCorners]
+};
+
+static inline unsigned float_bits(float f)
+{
+	f += 0.0f; // -0 ==> +0
+	unsigned u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+static void weld_key_of(const weld_job* j, int corner, weld_key* k)
+{
+	const import_mesh* m = j->mesh;
+	const int* c = &m->corners[corner * 3];
+	const float* p = &m->positions[c[0] * 3];
+	for (int i = 0; i < 3; ++i)
+		k->position[i] = j->invWeld ? (unsigned)(int)floorf(p[i] * j->invWeld + 0.5f) : float_bits(p[i]);
+	for (int i = 0; i < 2; ++i)
+		k->uv[i] = c[1] < 0 ? 0 : float_bits(m->uvs[c[1] * 2 + i]);
+	for (int i = 0; i < 3; ++i)
+		k->normal[i] = c[2] < 0 ? 0 : float_bits(m->normals[c[2] * 3 + i]);
+}
+
+// MurmurHash3 x86_32 of the key words, cheaper than xxhash64() for 32 bytes
+static unsigned weld_hash(const weld_key* k)
+{
+	const unsigned* w = (const unsigned*)k;
+	unsigned h = 0;
+	for (int i = 0; i < (int)(sizeof(*k) / 4); ++i) {
+		unsigned x = w[i] * 0xcc9e2d51u;
+		x = (x << 15 | x >> 17) * 0x1b873593u;
+		h ^= x;
+		h = (h << 13 | h >> 19) * 5 + 0xe6546b64u;
+	}
+	h ^= sizeof(*k);
+	h ^= h >> 16; h *= 0x85ebca6bu;
+	h ^= h >> 13; h *= 0xc2b2ae35u;
+	return h ^ (h >> 16);
+}
+
+static void weld_hash_range(weld_range* r)
+{
+	const weld_job* j = r->job;
+	const int* corners = j->mesh->corners;
+	weld_key k;
+	for (int c = r->begin; c < r->end; ++c) {
+		weld_key_of(j, c, &k);
+		const unsigned h = weld_hash(&k);
+		j->hashes[c] = h;
+		++r->shardOffsets[h >> (32 - WELD_SHARD_BITS)];
+		r->missingNormals |= corners[c * 3 + 2] < 0;
+	}
+}
+
+// writes 64 sequential streams, so the shards then read their corners and hashes in order
+static void weld_scatter_range(weld_range* r)
+{
+	const weld_job* j = r->job;
+	for (int c = r->begin; c < r->end; ++c) {
+		const unsigned h = j->hashes[c];
+		j->shardCorners[r->shardOffsets[h >> (32 - WELD_SHARD_BITS)]++] = (weld_slot){ h, c };
+	}
+}
+
+static weld_slot* weld_table_grow(weld_slot* table, unsigned* mask)
+{
+	const unsigned capacity = table ? (*mask + 1) * 2 : 1024;
+	weld_slot* grown = malloc(sizeof(weld_slot) * capacity);
+	memset(grown, 0xff, sizeof(weld_slot) * capacity); // corner -1
+	for (unsigned i = 0; table && i <= *mask; ++i) {
+		if (table[i].corner < 0) continue;
+		unsigned slot = table[i].hash & (capacity - 1);
+		while (grown[slot].corner >= 0) slot = (slot + 1) & (capacity - 1);
+		grown[slot] = table[i];
+	}
+	free(table);
+	*mask = capacity - 1;
+	return grown;
+}
+
+// deduplicates the corners of a shard, corners are visited in order, so the first
+// corner of every vertex becomes its representative and replaces the corner in the list
+static void weld_shard_corners(weld_shard* s)
+{
+	const weld_job* j = s->job;
+	const int* corners = j->mesh->corners;
+	unsigned mask = 0;
+	int numVerts = 0;
+	weld_slot* table = weld_table_grow(NULL, &mask); // sized by vertices, usually far fewer than corners
+
+	weld_key key, other;
+	for (int i = s->begin; i < s->end; ++i) {
+		weld_slot* item = &j->shardCorners[i];
+		const int c = item->corner;
+		const unsigned h = item->hash;
+		bool keyed = false;
+		for (unsigned slot = h & mask; ; slot = (slot + 1) & mask) {
+			weld_slot* e = &table[slot];
+			if (e->corner < 0) {
+				*e = *item;
+				if (++numVerts * 2 > (int)mask)
+					table = weld_table_grow(table, &mask);
+				break;
+			}
+			if (e->hash != h) continue;
+			// same indices are the same vertex, only other indices need their values compared
+			bool same = memcmp(&corners[c * 3], &corners[e->corner * 3], sizeof(int) * 3) == 0;
+			if (!same) {
+				if (!keyed) weld_key_of(j, c, &key), keyed = true;
+				weld_key_of(j, e->corner, &other);
+				same = memcmp(&key, &other, sizeof(key)) == 0;
+			}
+			if (same) {
+				item->corner = e->corner;
+				break;
+			}
+		}
+	}
+	free(table);
+}
+
+// reads the first corners back in corner order by replaying the scatter
+static void weld_gather_range(weld_range* r)
+{
+	const weld_job* j = r->job;
+	int n = 0;
+	for (int c = r->begin; c < r->end; ++c) {
+		const int first = j->shardCorners[r->gatherOffsets[j->hashes[c] >> (32 - WELD_SHARD_BITS)]++].corner;
+		j->first[c] = first;
+		n += first == c;
+	}
+	r->numVerts = n;
+}
+
+static void weld_emit_vertices(weld_range* r)
+{
+	const weld_job* j = r->job;
+	const import_mesh* m = j->mesh;
+	int id = r->firstVertex;
+	for (int c = r->begin; c < r->end; ++c) {
+		if (j->first[c] != c) continue;
+		const int* corner = &m->corners[c * 3];
+		vertex_t* v = &j->vertices[id];
+		memcpy(&v->pos, &m->positions[corner[0] * 3], sizeof(vec3));
+		if (corner[1] >= 0) memcpy(&v->tex, &m->uvs[corner[1] * 2], sizeof(vec2));
+		else v->u = v->v = 0.0f;
+		if (corner[2] >= 0) memcpy(&v->norm, &m->normals[corner[2] * 3], sizeof(vec3));
+		else v->nx = v->ny = v->nw = 0.0f;
+		j->vertexCorner[id] = c;
+		j->hashes[c] = id++;
+	}
+}
+
+static void weld_emit_indices(weld_range* r)
+{
+	const weld_job* j = r->job;
+	for (int c = r->begin; c < r->end; ++c)
+		j->indices[c] = j->hashes[j->first[c]];
+}
+
+// smooth normals for corners without one, area weighted over all faces sharing the position
+static void generate_normals(const import_mesh* m, vertex_t* vertices, int numVerts,
+                             const int* vertexCorner, const index_t* indices, int numIndices)
+{
+	vec3* sums = calloc(m->numPositions + 1, sizeof(vec3));
+	for (int i = 0; i + 2 < numIndices; i += 3) {
+		const vertex_t* a = &vertices[indices[i]];
+		const vertex_t* b = &vertices[indices[i + 1]];
+		const vertex_t* c = &vertices[indices[i + 2]];
+		const vec3 n = vec3_cross(vec3_sub(b->pos, a->pos), vec3_sub(c->pos, a->pos));
+		for (int k = 0; k < 3; ++k) {
+			vec3* sum = &sums[m->corners[vertexCorner[indices[i + k]] * 3]];
+			*sum = vec3_add(*sum, n);
+		}
+	}
+	for (int v = 0; v < numVerts; ++v) {
+		const int* corner = &m->corners[vertexCorner[v] * 3];
+		if (corner[2] >= 0) continue;
+		const vec3 n = sums[corner[0]];
+		const float len = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+		vertices[v].norm = len > 0.0f ? vec3_mulf(n, 1.0f / len) : (vec3){ 0.0f, 0.0f, 1.0f };
+	}
+	free(sums);
+}
+
+// welds the mesh vertices and builds the BMD_VERSION model
+static BMDModel* weld_mesh(taskpool* pool, int numThreads, const import_mesh* m, float weld,
+                           int* outSize, import_stats* stats)
+{
+	const double start = seconds();
+	const int numCorners = m->numCorners;
+	const int numShards  = 1 << WELD_SHARD_BITS;
+	int numRanges = numCorners / WELD_RANGE_SIZE;
+	if (numRanges > numThreads * 4) numRanges = numThreads * 4;
+	if (numRanges < 1) numRanges = 1;
+
+	weld_job j = {
+		.mesh         = m,
+		.invWeld      = weld > 0.0f ? 1.0f / weld : 0.0f,
+		.hashes       = malloc(sizeof(unsigned) * (numCorners + 1)),
+		.first        = malloc(sizeof(int) * (numCorners + 1)),
+		.shardCorners = malloc(sizeof(weld_slot) * (numCorners + 1)),
+	};
+	weld_range* ranges  = calloc(numRanges, sizeof(weld_range));
+	weld_shard* shards  = calloc(numShards, sizeof(weld_shard));
+	int*        offsets = calloc((size_t)numRanges * numShards * 2, sizeof(int));
+	for (int i = 0; i < numRanges; ++i) {
+		ranges[i].job   = &j;
+		ranges[i].begin = (int)((long long)numCorners * i / numRanges);
+		ranges[i].end   = (int)((long long)numCorners * (i + 1) / numRanges);
+		ranges[i].shardOffsets  = offsets + i * numShards * 2;
+		ranges[i].gatherOffsets = ranges[i].shardOffsets + numShards;
+	}
+	run_all(pool, (TaskFunc)&weld_hash_range, ranges, numRanges, sizeof(weld_range));
+
+	// shard corner counts ==> scatter offsets, shard by shard and range by range in order
+	int total = 0;
+	for (int s = 0; s < numShards; ++s) {
+		shards[s].job   = &j;
+		shards[s].begin = total;
+		for (int i = 0; i < numRanges; ++i) {
+			const int n = ranges[i].shardOffsets[s];
+			ranges[i].shardOffsets[s] = ranges[i].gatherOffsets[s] = total;
+			total += n;
+		}
+		shards[s].end = total;
+	}
+	run_all(pool, (TaskFunc)&weld_scatter_range, ranges, numRanges, sizeof(weld_range));
+	run_all(pool, (TaskFunc)&weld_shard_corners, shards, numShards, sizeof(weld_shard));
+	run_all(pool, (TaskFunc)&weld_gather_range,  ranges, numRanges, sizeof(weld_range));
+	free(j.shardCorners);
+
+	int numVerts = 0;
+	bool missingNormals = false;
+	for (int i = 0; i < numRanges; ++i) {
+		ranges[i].firstVertex = numVerts;
+		numVerts += ranges[i].numVerts;
+		missingNormals |= ranges[i].missingNormals;
+	}
+
+	// the welded vertices and indices are emitted straight into a BMD v1 model
+	const int offVerts   = BMD_V1_HEADER_SIZE;
+	const int offIndices = offVerts + numVerts * (int)sizeof(vertex_t);
+	const int v1Size     = offIndices + numCorners * (int)sizeof(index_t);
+	BMDModel* v1 = calloc(1, v1Size > (int)sizeof(BMDModel) ? v1Size : (int)sizeof(BMDModel));
+	memcpy(v1->name,     m->name,    sizeof(v1->name));
+	memcpy(v1->tex_name, m->texture, sizeof(v1->tex_name));
+	v1->num_verts   = numVerts;
+	v1->off_verts   = offVerts;
+	v1->off_indices = offIndices;
+	j.vertices     = model_vertices(v1);
+	j.indices      = model_indices(v1);
+	j.vertexCorner = malloc(sizeof(int) * (numVerts + 1));
+	run_all(pool, (TaskFunc)&weld_emit_vertices, ranges, numRanges, sizeof(weld_range));
+	run_all(pool, (TaskFunc)&weld_emit_indices,  ranges, numRanges, sizeof(weld_range));
+	free(j.hashes);
+	free(j.first);
+	free(ranges);
+	free(shards);
+	free(offsets);
+	const double welded = seconds();
+
+	// welding nearby positions can collapse triangles
+	int numIndices = 0;
+	for (int i = 0; i + 2 < numCorners; i += 3) {
+		const index_t a = j.indices[i], b = j.indices[i + 1], c = j.indices[i + 2];
+		if (a == b || b == c || a == c) continue;
+		j.indices[numIndices++] = a;
+		j.indices[numIndices++] = b;
+		j.indices[numIndices++] = c;
+	}
+	v1->num_indices = numIndices;
+	if (missingNormals)
+		generate_normals(m, j.vertices, numVerts, j.vertexCorner, j.indices, numIndices);
+	free(j.vertexCorner);
+
+	BMDModel* model = bmd_convert(v1, v1Size, outSize);
+	free(v1);
+	if (!model) LOG("import_model(): failed to build the BMD model of '%s'\n", m->name);
+	if (stats) {
+		stats->weldTime      = welded - start;
+		stats->buildTime     = seconds() - welded;
+		stats->numThreads    = numThreads;
+		stats->numCorners    = numCorners;
+		stats->numVerts      = numVerts;
+		stats->numDegenerate = (numCorners - numIndices) / 3;
+	}
+	return model;
+}
+
+static int thread_count(const import_options* opt)
+{
+	const int n = opt && opt->numThreads > 0 ? opt->numThreads : thread_cpu_count();
+	return n < 64 ? n : 64;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BMDModel* import_obj(const char* text, int size, const char* path,
+                     const import_options* opt, int* outSize, import_stats* stats)
+{
+	const double start = seconds();
+	const int numThreads = thread_count(opt);
+	taskpool* pool = taskpool_create(numThreads);
+
+	import_mesh m = { 0 };
+	name_from_path(m.name, path);
+	const char *usemtl, *mtllib;
+	BMDModel* model = NULL;
+	if (obj_parse(pool, numThreads, text, size, &m, &usemtl, &mtllib)) {
+		obj_texture(&m, path, usemtl, mtllib, text + size);
+		const double parsed = seconds();
+		model = weld_mesh(pool, numThreads, &m, opt ? opt->weld : 0.0f, outSize, stats);
+		if (stats) stats->parseTime = parsed - start;
+	}
+	import_mesh_free(&m);
+	taskpool_destroy(pool);
+	return model;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// JSON value, containers are followed by their children: key, value, key, value... for objects
+typedef struct json_token
+{
+	char type;  // '{' object, '[' array, '"' string, 'p' number, true, false or null
+	int  start; // text range, strings without their quotes
+	int  end;
+	int  size;  // number of array elements or object members
+	int  next;  // token after this value and all of its children
+} json_token;
+
+typedef struct json
+{
+	const char* text;
+	int         length;
+	int         pos;
+	json_token* tokens;
+	int         count;
+	int         capacity;
+	bool        error;
+} json;
+
+static inline void json_space(json* js)
+{
+	for (; js->pos < js->length; ++js->pos) {
+		const char c = js->text[js->pos];
+		if (c != ' ' && c != '\t' && c != '\r' && c != '\n') break;
+	}
+}
+
+static int json_token_new(json* js, char type, int start)
+{
+	if (js->count == js->capacity)
+		js->tokens = buf_reserve(js->tokens, &js->capacity, js->count + 1, sizeof(json_token));
+	js->tokens[js->count] = (json_token){ type, start, start, 0, 0 };
+	return js->count++;
+}
+
+static int json_value(json* js, int depth)
+{
+	json_space(js);
+	if (js->pos >= js->length || depth > 64) {
+		js->error = true;
+		return -1;
+	}
+	const char c = js->text[js->pos];
+	int t;
+	if (c == '{' || c == '[') {
+		t = json_token_new(js, c, js->pos++);
+		const char close = c == '{' ? '}' : ']';
+		json_space(js);
+		if (js->pos < js->length && js->text[js->pos] == close) ++js->pos;
+		else for (;;) {
+			if (c == '{') {
+				json_space(js);
+				if (js->pos >= js->length || js->text[js->pos] != '"') { js->error = true; return -1; }
+				json_value(js, depth + 1);
+				json_space(js);
+				if (js->pos >= js->length || js->text[js->pos] != ':') { js->error = true; return -1; }
+				++js->pos;
+			}
+			json_value(js, depth + 1);
+			if (js->error) return -1;
+			++js->tokens[t].size;
+			json_space(js);
+			const char sep = js->pos < js->length ? js->text[js->pos++] : 0;
+			if (sep == close) break;
+			if (sep != ',') { js->error = true; return -1; }
+		}
+		js->tokens[t].end = js->pos;
+	}
+	else if (c == '"') {
+		t = json_token_new(js, '"', ++js->pos);
+		while (js->pos < js->length && js->text[js->pos] != '"')
+			js->pos += js->text[js->pos] == '\\' ? 2 : 1;
+		if (js->pos >= js->length) { js->error = true; return -1; }
+		js->tokens[t].end = js->pos++;
+	}
+	else {
+		t = json_token_new(js, 'p', js->pos);
+		while (js->pos < js->length && !strchr(",]} \t\r\n", js->text[js->pos]))
+			++js->pos;
+		js->tokens[t].end = js->pos;
+	}
+	js->tokens[t].next = js->count;
+	return t;
+}
+
+// @return Token of the member value, -1 if obj isn't an object or has no such member
+static int json_get(const json* js, int obj, const char* key)
+{
+	if (obj < 0 || js->tokens[obj].type != '{') return -1;
+	const int len = (int)strlen(key);
+	for (int i = 0, k = obj + 1; i < js->tokens[obj].size; ++i) {
+		const json_token* name = &js->tokens[k];
+		if (name->end - name->start == len && memcmp(js->text + name->start, key, len) == 0)
+			return k + 1;
+		k = js->tokens[k + 1].next;
+	}
+	return -1;
+}
+
+// @return Token of the array element, -1 if arr isn't an array or is too short
+static int json_at(const json* js, int arr, int index)
+{
+	if (arr < 0 || js->tokens[arr].type != '[' || index < 0 || index >= js->tokens[arr].size) return -1;
+	int t = arr + 1;
+	while (index--) t = js->tokens[t].next;
+	return t;
+}
+
+static int json_size(const json* js, int t)
+{
+	return t >= 0 && (js->tokens[t].type == '[' || js->tokens[t].type == '{') ? js->tokens[t].size : 0;
+}
+
+static double json_number(const json* js, int t, double def)
+{
+	if (t < 0 || js->tokens[t].type != 'p') return def;
+	char buf[64];
+	const int len = js->tokens[t].end - js->tokens[t].start;
+	if (len <= 0 || len >= (int)sizeof(buf)) return def;
+	memcpy(buf, js->text + js->tokens[t].start, len);
+	buf[len] = '\0';
+	char* end;
+	const double v = strtod(buf, &end);
+	return end != buf ? v : def;
+}
+
+static int json_int(const json* js, int t, int def)
+{
+	return (int)json_number(js, t, def);
+}
+
+static bool json_equals(const json* js, int t, const char* str)
+{
+	return t >= 0 && js->tokens[t].type == '"' && js->tokens[t].end - js->tokens[t].start == (int)strlen(str)
+	    && memcmp(js->text + js->tokens[t].start, str, strlen(str)) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define GLB_MAGIC      0x46546C67 // "glTF"
+#define GLB_CHUNK_JSON 0x4E4F534A
+#define GLB_CHUNK_BIN  0x004E4942
+
+typedef struct gltf_buffer
+{
+	const unsigned char* data;
+	int      size;
+	vfs_file file;    // external .bin file
+	void*    decoded; // malloc'd data URI contents
+} gltf_buffer;
+
+typedef struct gltf
+{
+	json         js;
+	const char*  path;
+	gltf_buffer* buffers;
+	int          numBuffers;
+	fbuf positions, uvs, normals;
+	ibuf corners;
+	char texture[32];
+} gltf;
+
+// element accessor, see glTF 2.0 spec 3.6.2
+typedef struct gltf_accessor
+{
+	const unsigned char* data;
+	int  count;
+	int  stride;
+	int  componentType;
+	int  components;
+	bool normalized;
+} gltf_accessor;
+
+static int base64_value(char c)
+{
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if (c >= '0' && c <= '9') return c - '0' + 52;
+	if (c == '+' || c == '-') return 62;
+	if (c == '/' || c == '_') return 63;
+	return -1;
+}
+
+static unsigned char* base64_decode(const char* s, int len, int* outSize)
+{
+	unsigned char* out = malloc(len / 4 * 3 + 3);
+	int n = 0, bits = 0;
+	unsigned value = 0;
+	for (int i = 0; i < len; ++i) {
+		const int v = base64_value(s[i]);
+		if (v < 0) continue; // '=' padding
+		value = ((value << 6) | v) & 0x3fff; // at most 13 bits are pending
+		if ((bits += 6) >= 8) {
+			bits -= 8;
+			out[n++] = (unsigned char)(value >> bits);
+		}
+	}
+	*outSize = n;
+	return out;
+}
+
+static bool gltf_load_buffers(gltf* g, const unsigned char* bin, int binSize)
+{
+	const json* js = &g->js;
+	const int buffers = json_get(js, 0, "buffers");
+	g->numBuffers = json_size(js, buffers);
+	g->buffers = calloc(g->numBuffers + 1, sizeof(gltf_buffer));
+	for (int i = 0; i < g->numBuffers; ++i) {
+		gltf_buffer* b = &g->buffers[i];
+		const int uri = json_get(js, json_at(js, buffers, i), "uri");
+		if (uri < 0) { // GLB binary chunk
+			if (i != 0 || !bin) {
+				LOG("import_gltf(): buffer %d has no uri\n", i);
+				return false;
+			}
+			b->data = bin;
+			b->size = binSize;
+			continue;
+		}
+		const char* str = js->text + js->tokens[uri].start;
+		const int   len = js->tokens[uri].end - js->tokens[uri].start;
+		const char* comma = memchr(str, ',', len);
+		if (len > 5 && memcmp(str, "data:", 5) == 0 && comma) {
+			b->decoded = base64_decode(comma + 1, (int)(str + len - comma - 1), &b->size);
+			b->data = b->decoded;
+			continue;
+		}
+		char path[512];
+		const char* file  = filepart(g->path, (int)strlen(g->path));
+		const int   dirLen = (int)(file - g->path);
+		if (dirLen + len >= (int)sizeof(path)) return false;
+		memcpy(path, g->path, dirLen);
+		memcpy(path + dirLen, str, len);
+		path[dirLen + len] = '\0';
+		if (!vfs_map(&b->file, path)) {
+			LOG("import_gltf(): failed to read buffer '%s'\n", path);
+			return false;
+		}
+		b->data = b->file.data;
+		b->size = b->file.size;
+	}
+	return true;
+}
+
+static void gltf_free_buffers(gltf* g)
+{
+	for (int i = 0; i < g->numBuffers; ++i) {
+		if (g->buffers[i].file.data) vfs_close(&g->buffers[i].file);
+		free(g->buffers[i].decoded);
+	}
+	free(g->buffers);
+}
+
+static bool gltf_get_accessor(const gltf* g, int index, gltf_accessor* a)
+{
+	const json* js = &g->js;
+	const int acc  = json_at(js, json_get(js, 0, "accessors"), index);
+	const int view = json_at(js, json_get(js, 0, "bufferViews"), json_int(js, json_get(js, acc, "bufferView"), -1));
+	const int buf  = json_int(js, json_get(js, view, "buffer"), -1);
+	if (acc < 0 || view < 0 || buf < 0 || buf >= g->numBuffers) {
+		LOG("import_gltf(): accessor %d has no buffer data\n", index);
+		return false;
+	}
+	if (json_get(js, acc, "sparse") >= 0) {
+		LOG("import_gltf(): sparse accessor %d is not supported\n", index);
+		return false;
+	}
+	const int type = json_get(js, acc, "type");
+	a->components    = json_equals(js, type, "SCALAR") ? 1 : json_equals(js, type, "VEC2") ? 2
+	                 : json_equals(js, type, "VEC3")   ? 3 : json_equals(js, type, "VEC4") ? 4 : 0;
+	a->componentType = json_int(js, json_get(js, acc, "componentType"), 0);
+	const int normalized = json_get(js, acc, "normalized");
+	a->normalized    = normalized >= 0 && js->text[js->tokens[normalized].start] == 't';
+	a->count         = json_int(js, json_get(js, acc, "count"), 0);
+	const int componentSize = a->componentType == 5126 || a->componentType == 5125 ? 4
+	                        : a->componentType == 5122 || a->componentType == 5123 ? 2
+	                        : a->componentType == 5120 || a->componentType == 5121 ? 1 : 0;
+	const int elementSize = componentSize * a->components;
+	a->stride = json_int(js, json_get(js, view, "byteStride"), elementSize);
+
+	const long long offset = (long long)json_int(js, json_get(js, view, "byteOffset"), 0)
+	                       + json_int(js, json_get(js, acc, "byteOffset"), 0);
+	const long long viewEnd = json_int(js, json_get(js, view, "byteOffset"), 0)
+	                        + (long long)json_int(js, json_get(js, view, "byteLength"), 0);
+	const long long end = offset + (long long)a->stride * (a->count - 1) + elementSize;
+	if (!elementSize || a->count < 0 || a->stride < elementSize || offset < 0 ||
+	    (a->count && (end > viewEnd || viewEnd > g->buffers[buf].size))) {
+		LOG("import_gltf(): accessor %d is invalid\n", index);
+		return false;
+	}
+	a->data = g->buffers[buf].data + offset;
+	return true;
+}
+
+// reads n components of element i as floats, applying normalization
+static void gltf_read(const gltf_accessor* a, int i, float* out, int n)
+{
+	const unsigned char* p = a->data + (size_t)a->stride * i;
+	for (int k = 0; k < n; ++k) {
+		float v = 0.0f;
+		if (k < a->components) switch (a->componentType) {
+			case 5126: memcpy(&v, p + k * 4, 4); break;
+			case 5121: v = p[k];               if (a->normalized) v /= 255.0f;   break;
+			case 5120: v = (signed char)p[k];  if (a->normalized) v = fmaxf(v / 127.0f, -1.0f); break;
+			case 5123: { unsigned short s; memcpy(&s, p + k * 2, 2); v = s; if (a->normalized) v /= 65535.0f; } break;
+			case 5122: { short s;          memcpy(&s, p + k * 2, 2); v = s; if (a->normalized) v = fmaxf(v / 32767.0f, -1.0f); } break;
+			case 5125: { unsigned u;       memcpy(&u, p + k * 4, 4); v = (float)u; } break;
+		}
+		out[k] = v;
+	}
+}
+
+static unsigned gltf_read_index(const gltf_accessor* a, int i)
+{
+	const unsigned char* p = a->data + (size_t)a->stride * i;
+	switch (a->componentType) {
+		case 5121: return p[0];
+		case 5123: { unsigned short s; memcpy(&s, p, 2); return s; }
+		default:   { unsigned u;       memcpy(&u, p, 4); return u; }
+	}
+}
+
+// base color texture of a material, see glTF 2.0 spec 3.9.2
+static void gltf_material_texture(gltf* g, int material)
+{
+	const json* js = &g->js;
+	const int mat   = json_at(js, json_get(js, 0, "materials"), material);
+	const int info  = json_get(js, json_get(js, mat, "pbrMetallicRoughness"), "baseColorTexture");
+	const int tex   = json_at(js, json_get(js, 0, "textures"), json_int(js, json_get(js, info, "index"), -1));
+	const int image = json_at(js, json_get(js, 0, "images"), json_int(js, json_get(js, tex, "source"), -1));
+	const int uri   = json_get(js, image, "uri");
+	if (uri < 0 || js->tokens[uri].type != '"') return;
+	const char* str = js->text + js->tokens[uri].start;
+	const int   len = js->tokens[uri].end - js->tokens[uri].start;
+	if (len > 5 && memcmp(str, "data:", 5) == 0) return; // embedded images have no name
+	const char* part = filepart(str, len);
+	copy_name(g->texture, part, (int)(str + len - part));
+}
+
+static bool gltf_primitive(gltf* g, int prim, const mat4* world)
+{
+	const json* js = &g->js;
+	const int mode = json_int(js, json_get(js, prim, "mode"), 4);
+	if (mode != 4) {
+		LOG("import_gltf(): skipping primitive with mode %d, only triangle lists are imported\n", mode);
+		return true;
+	}
+	const int attributes = json_get(js, prim, "attributes");
+	const int position = json_get(js, attributes, "POSITION");
+	const int normal   = json_get(js, attributes, "NORMAL");
+	const int texcoord = json_get(js, attributes, "TEXCOORD_0");
+	const int indices  = json_get(js, prim, "indices");
+	gltf_accessor pos, nrm, uv, idx;
+	if (position < 0 || !gltf_get_accessor(g, json_int(js, position, -1), &pos) || pos.componentType != 5126 ||
+	    (normal   >= 0 && (!gltf_get_accessor(g, json_int(js, normal, -1), &nrm) || nrm.componentType != 5126 || nrm.count < pos.count)) ||
+	    (texcoord >= 0 && (!gltf_get_accessor(g, json_int(js, texcoord, -1), &uv) || uv.count < pos.count)) ||
+	    (indices  >= 0 && !gltf_get_accessor(g, json_int(js, indices, -1), &idx))) {
+		LOG("import_gltf(): invalid primitive attributes\n");
+		return false;
+	}
+	if (!g->texture[0] && json_get(js, prim, "material") >= 0)
+		gltf_material_texture(g, json_int(js, json_get(js, prim, "material"), -1));
+
+	// normals transform by the cofactor matrix, which is the inverse transpose scaled by the
+	// determinant; a negative determinant mirrors the mesh, which also flips the winding
+	const float* w = world->m;
+	const float cof[9] = {
+		w[5] * w[10] - w[6] * w[9], w[6] * w[8] - w[4] * w[10], w[4] * w[9] - w[5] * w[8],
+		w[9] * w[2] - w[10] * w[1], w[10] * w[0] - w[8] * w[2], w[8] * w[1] - w[9] * w[0],
+		w[1] * w[6] - w[2] * w[5],  w[2] * w[4] - w[0] * w[6],  w[0] * w[5] - w[1] * w[4],
+	};
+	const float det = w[0] * cof[0] + w[1] * cof[1] + w[2] * cof[2];
+
+	const int basePosition = g->positions.size / 3;
+	const int baseUv       = texcoord >= 0 ? g->uvs.size / 2     : -1;
+	const int baseNormal   = normal   >= 0 ? g->normals.size / 3 : -1;
+	float* positions = fbuf_push(&g->positions, pos.count * 3);
+	for (int i = 0; i < pos.count; ++i) {
+		float p[3];
+		gltf_read(&pos, i, p, 3);
+		for (int r = 0; r < 3; ++r)
+			positions[i * 3 + r] = w[r] * p[0] + w[4 + r] * p[1] + w[8 + r] * p[2] + w[12 + r];
+	}
+	if (normal >= 0) {
+		float* normals = fbuf_push(&g->normals, pos.count * 3);
+		for (int i = 0; i < pos.count; ++i) {
+			float n[3], t[3];
+			gltf_read(&nrm, i, n, 3);
+			for (int r = 0; r < 3; ++r)
+				t[r] = cof[r * 3] * n[0] + cof[r * 3 + 1] * n[1] + cof[r * 3 + 2] * n[2];
+			const float len = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+			const float s = len > 0.0f ? (det < 0.0f ? -1.0f : 1.0f) / len : 0.0f;
+			for (int r = 0; r < 3; ++r)
+				normals[i * 3 + r] = t[r] * s;
+		}
+	}
+	if (texcoord >= 0) {
+		float* uvs = fbuf_push(&g->uvs, pos.count * 2);
+		for (int i = 0; i < pos.count; ++i)
+			gltf_read(&uv, i, &uvs[i * 2], 2);
+	}
+
+	const int numIndices = (indices >= 0 ? idx.count : pos.count) / 3 * 3;
+	int* corners = ibuf_push(&g->corners, numIndices * 3);
+	for (int i = 0; i < numIndices; ++i) {
+		// mirrored: a b c ==> a c b
+		const int k = det < 0.0f && i % 3 ? i + (i % 3 == 1 ? 1 : -1) : i;
+		const unsigned v = indices >= 0 ? gltf_read_index(&idx, k) : (unsigned)k;
+		if (v >= (unsigned)pos.count) {
+			LOG("import_gltf(): index %u out of range\n", v);
+			return false;
+		}
+		corners[i * 3 + 0] = basePosition + v;
+		corners[i * 3 + 1] = baseUv     >= 0 ? baseUv + (int)v     : -1;
+		corners[i * 3 + 2] = baseNormal >= 0 ? baseNormal + (int)v : -1;
+	}
+	return true;
+}
+
+// node transform relative to its parent, see glTF 2.0 spec 3.5.3
+static void gltf_node_matrix(const json* js, int node, mat4* out)
+{
+	const int matrix = json_get(js, node, "matrix");
+	if (json_size(js, matrix) == 16) {
+		for (int i = 0; i < 16; ++i)
+			out->m[i] = (float)json_number(js, json_at(js, matrix, i), 0.0);
+		return;
+	}
+	float t[3] = { 0, 0, 0 }, q[4] = { 0, 0, 0, 1 }, s[3] = { 1, 1, 1 };
+	const int tr = json_get(js, node, "translation"), rot = json_get(js, node, "rotation"), sc = json_get(js, node, "scale");
+	for (int i = 0; i < 3; ++i) t[i] = (float)json_number(js, json_at(js, tr, i),  t[i]);
+	for (int i = 0; i < 4; ++i) q[i] = (float)json_number(js, json_at(js, rot, i), q[i]);
+	for (int i = 0; i < 3; ++i) s[i] = (float)json_number(js, json_at(js, sc, i),  s[i]);
+	const float x = q[0], y = q[1], z = q[2], w = q[3];
+	const float r[9] = { // column major rotation of the unit quaternion
+		1 - 2*(y*y + z*z), 2*(x*y + z*w),     2*(x*z - y*w),
+		2*(x*y - z*w),     1 - 2*(x*x + z*z), 2*(y*z + x*w),
+		2*(x*z + y*w),     2*(y*z - x*w),     1 - 2*(x*x + y*y),
+	};
+	mat4_identity(out);
+	for (int c = 0; c < 3; ++c)
+		for (int row = 0; row < 3; ++row)
+			out->m[c * 4 + row] = r[c * 3 + row] * s[c];
+	for (int row = 0; row < 3; ++row)
+		out->m[12 + row] = t[row];
+}
+
+static bool gltf_node(gltf* g, int nodeIndex, const mat4* parent, int depth)
+{
+	const json* js = &g->js;
+	const int node = json_at(js, json_get(js, 0, "nodes"), nodeIndex);
+	if (node < 0 || depth > 64) {
+		LOG("import_gltf(): invalid node %d\n", nodeIndex);
+		return false;
+	}
+	mat4 local, world = *parent;
+	gltf_node_matrix(js, node, &local);
+	mat4_mul(&world, &local);
+
+	const int mesh = json_at(js, json_get(js, 0, "meshes"), json_int(js, json_get(js, node, "mesh"), -1));
+	const int prims = json_get(js, mesh, "primitives");
+	for (int i = 0; i < json_size(js, prims); ++i)
+		if (!gltf_primitive(g, json_at(js, prims, i), &world))
+			return false;
+	const int children = json_get(js, node, "children");
+	for (int i = 0; i < json_size(js, children); ++i)
+		if (!gltf_node(g, json_int(js, json_at(js, children, i), -1), &world, depth + 1))
+			return false;
+	return true;
+}
+
+// imports the default scene, or every mesh untransformed if the model has no scenes
+static bool gltf_scene(gltf* g)
+{
+	const json* js = &g->js;
+	const int scenes = json_get(js, 0, "scenes");
+	const int scene  = json_at(js, scenes, json_int(js, json_get(js, 0, "scene"), 0));
+	if (scene >= 0) {
+		const int nodes = json_get(js, scene, "nodes");
+		for (int i = 0; i < json_size(js, nodes); ++i)
+			if (!gltf_node(g, json_int(js, json_at(js, nodes, i), -1), &IDENTITY, 0))
+				return false;
+		return true;
+	}
+	const int meshes = json_get(js, 0, "meshes");
+	for (int m = 0; m < json_size(js, meshes); ++m) {
+		const int prims = json_get(js, json_at(js, meshes, m), "primitives");
+		for (int i = 0; i < json_size(js, prims); ++i)
+			if (!gltf_primitive(g, json_at(js, prims, i), &IDENTITY))
+				return false;
+	}
+	return true;
+}
+
+BMDModel* import_gltf(const void* data, int size, const char* path,
+                      const import_options* opt, int* outSize, import_stats* stats)
+{
+	const double start = seconds();
+	const unsigned char* bytes = data;
+	const char* text = data;
+	int textSize = size;
+	const unsigned char* bin = NULL;
+	int binSize = 0;
+
+	unsigned header[5];
+	if (size >= 20 && (memcpy(header, bytes, 20), header[0] == GLB_MAGIC)) {
+		// GLB: 12 byte header, then a JSON chunk and an optional BIN chunk
+		if (header[1] != 2 || header[2] > (unsigned)size || header[4] != GLB_CHUNK_JSON || header[3] > (unsigned)size - 20) {
+			LOG("import_gltf(): invalid GLB header in '%s'\n", path);
+			return NULL;
+		}
+		text = (const char*)bytes + 20;
+		textSize = header[3];
+		const unsigned binOffset = 20 + ((header[3] + 3) & ~3u);
+		unsigned chunk[2];
+		if (binOffset + 8 <= header[2] && (memcpy(chunk, bytes + binOffset, 8), chunk[1] == GLB_CHUNK_BIN)
+		    && chunk[0] <= header[2] - binOffset - 8) {
+			bin = bytes + binOffset + 8;
+			binSize = chunk[0];
+		}
+	}
+
+	gltf g = { .js = { .text = text, .length = textSize }, .path = path };
+	json_value(&g.js, 0);
+	BMDModel* model = NULL;
+	if (g.js.error || g.js.tokens[0].type != '{') {
+		LOG("import_gltf(): invalid JSON in '%s'\n", path);
+	}
+	else if (gltf_load_buffers(&g, bin, binSize) && gltf_scene(&g)) {
+		import_mesh m = {
+			.positions = g.positions.data, .numPositions = g.positions.size / 3,
+			.uvs       = g.uvs.data,       .numUvs       = g.uvs.size / 2,
+			.normals   = g.normals.data,   .numNormals   = g.normals.size / 3,
+			.corners   = g.corners.data,   .numCorners   = g.corners.size / 3,
+		};
+		g.positions.data = g.uvs.data = g.normals.data = NULL;
+		g.corners.data = NULL;
+		name_from_path(m.name, path);
+		memcpy(m.texture, g.texture, sizeof(m.texture));
+
+		const int numThreads = thread_count(opt);
+		taskpool* pool = taskpool_create(numThreads);
+		const double parsed = seconds();
+		model = weld_mesh(pool, numThreads, &m, opt ? opt->weld : 0.0f, outSize, stats);
+		if (stats) stats->parseTime = parsed - start;
+		taskpool_destroy(pool);
+		import_mesh_free(&m);
+	}
+	if (g.buffers) gltf_free_buffers(&g);
+	free(g.positions.data);
+	free(g.uvs.data);
+	free(g.normals.data);
+	free(g.corners.data);
+	free(g.js.tokens);
+	return model;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BMDModel* import_model(const char* path, const import_options* opt, int* outSize, import_stats* stats)
+{
+	const char* ext = strrchr(path, '.');
+	const bool obj  = ext && (strcmp(ext, ".obj") == 0 || strcmp(ext, ".OBJ") == 0);
+	const bool gltf = ext && (strcmp(ext, ".gltf") == 0 || strcmp(ext, ".glb") == 0 ||
+	                          strcmp(ext, ".GLTF") == 0 || strcmp(ext, ".GLB") == 0);
+	if (!obj && !gltf) {
+		LOG("import_model(): unknown model format '%s'\n", path);
+		return NULL;
+	}
+	vfs_file f;
+	if (!vfs_map(&f, path)) {
+		LOG("import_model(): failed to read '%s'\n", path);
+		return NULL;
+	}
+	BMDModel* model = obj ? import_obj(f.data, f.size, path, opt, outSize, stats)
+	                      : import_gltf(f.data, f.size, path, opt, outSize, stats);
+	vfs_close(&f);
+	return model;
+}
+
+////////////////////////////////////////////////////////////////////////////////
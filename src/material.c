@@ -2,40 +2,116 @@
 #include <GL/glew.h>   // glGenTextures etc.
 #include <SOIL/SOIL.h> // SOIL_load_image
 #include <stdlib.h>    // free
+#include <stdatomic.h> // atomic_load_explicit
+#include "mipmap.h"    // mip_generate
 #include "util.h"      // LOG
+#include "vfs.h"       // vfs_open
+#include "delete_queue.h" // dq_delete_texture
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// written by tex_settings_set, read by the loader threads and the GL thread, so every field is
+// atomic: each is read once per texture, a texture may see one field before and one after a change
+static atomic_int     settingsMipmaps    = TEX_MIPS_KAISER; // TexMipmaps
+static _Atomic(float) settingsAnisotropy = 8.0f;
+
 static void _tex_free(Texture* tex)
 {
-	if (tex->glTexture) glDeleteTextures(1, &tex->glTexture);
-	if (tex->data)      free(tex->data);
+	dq_delete_texture(tex->glTexture);
+	dq_free(tex->data, (DeleteQueue_FreeFunc)&SOIL_free_image_data);
+	dq_free(tex->mips, &free);
 }
-static bool _tex_load(Texture* tex, const char* fullPath)
+static bool _tex_read(Texture* tex, const char* fullPath)
 {
-	int width, height;
-	uint8_t* image = SOIL_load_image(fullPath, &width, &height, 0, SOIL_LOAD_RGBA);
-	if (!image) {
+	tex->glTexture = 0;
+	tex->levels = 1;
+	tex->data = NULL;
+	tex->mips = NULL;
+	vfs_file f;
+	if (vfs_open(&f, fullPath)) {
+		tex->data = SOIL_load_image_from_memory(f.data, f.size, 
+			&tex->width, &tex->height, 0, SOIL_LOAD_RGBA);
+		vfs_close(&f);
+	}
+	if (!tex->data) {
 		LOG("load_image() failed: '%s'\n", fullPath);
 		return false;
 	}
+	tex->res.cpuBytes = tex->width * tex->height * 4;
 
-	tex->data = NULL;
+	// CPU filtered levels are generated here, on the loader thread, instead of stalling the GL thread
+	const TexMipmaps mipmaps = (TexMipmaps)atomic_load_explicit(&settingsMipmaps, memory_order_relaxed);
+	if (mipmaps != TEX_MIPS_NONE)
+		tex->levels = mip_levels(tex->width, tex->height);
+	if (tex->levels > 1 && (mipmaps == TEX_MIPS_BOX || mipmaps == TEX_MIPS_KAISER)) {
+		const mip_filter filter = mipmaps == TEX_MIPS_BOX ? MIP_BOX : MIP_KAISER;
+		if ((tex->mips = mip_generate(tex->data, tex->width, tex->height, tex->levels, filter)))
+			tex->res.cpuBytes += mip_chain_bytes(tex->width, tex->height, tex->levels);
+		else
+			LOG("mip_generate() failed: '%s', using glGenerateMipmap\n", fullPath);
+	}
+	return true;
+}
+static void _tex_set_anisotropy(float anisotropy)
+{
+	static float maxAnisotropy = 0.0f; // queried once, GL thread only
+	if (anisotropy <= 1.0f || !GLEW_EXT_texture_filter_anisotropic)
+		return;
+	if (maxAnisotropy == 0.0f)
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 
+		anisotropy < maxAnisotropy ? anisotropy : maxAnisotropy);
+}
+static bool _tex_load(Texture* tex, const char* fullPath)
+{
+	const int w = tex->width, h = tex->height;
 	glGenTextures(1, &tex->glTexture);
 	glBindTexture(GL_TEXTURE_2D, tex->glTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
+		tex->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	_tex_set_anisotropy(atomic_load_explicit(&settingsAnisotropy, memory_order_relaxed));
+
+	// immutable storage: the whole chain is allocated once and is always complete
+	glTexStorage2D(GL_TEXTURE_2D, tex->levels, GL_RGBA8, w, h);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, tex->data);
+	if (tex->mips) {
+		const char* level = tex->mips;
+		for (int i = 1; i < tex->levels; ++i) {
+			const int lw = mip_size(w, i), lh = mip_size(h, i);
+			glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, lw, lh, GL_RGBA, GL_UNSIGNED_BYTE, level);
+			level += lw * lh * 4;
+		}
+	}
+	else if (tex->levels > 1)
+		glGenerateMipmap(GL_TEXTURE_2D);
 
-	SOIL_free_image_data(image);
+	SOIL_free_image_data(tex->data);
+	free(tex->mips);
+	tex->data = NULL;
+	tex->mips = NULL;
+	tex->res.cpuBytes = 0;
+	tex->res.gpuBytes = w * h * 4 + mip_chain_bytes(w, h, tex->levels);
 	return true;
 }
 
-TexManager* tex_manager_create(int maxCount) {
+TexManager* tex_manager_create(int slabSize) {
 	static int id = 0;
-	char name[32]; snprintf(name, 32, "tex_manager_$%d_[%d]", id++, maxCount);
-	return (TexManager*)res_manager_create(name, maxCount, sizeof(Texture), 
-		(ResMgr_LoadFunc)_tex_load, (ResMgr_FreeFunc)_tex_free);
+	char name[32]; snprintf(name, 32, "tex_manager_$%d_[%d]", id++, slabSize);
+	return (TexManager*)res_manager_create(name, slabSize, sizeof(Texture), 
+		(ResMgr_ReadFunc)_tex_read, (ResMgr_LoadFunc)_tex_load, (ResMgr_FreeFunc)_tex_free);
+}
+
+void tex_settings_set(const TexSettings* s)
+{
+	atomic_store_explicit(&settingsMipmaps, s->mipmaps, memory_order_relaxed);
+	atomic_store_explicit(&settingsAnisotropy, s->anisotropy, memory_order_relaxed);
+}
+
+void tex_settings_get(TexSettings* out)
+{
+	out->mipmaps    = (TexMipmaps)atomic_load_explicit(&settingsMipmaps, memory_order_relaxed);
+	out->anisotropy = atomic_load_explicit(&settingsAnisotropy, memory_order_relaxed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -46,26 +122,35 @@ Material material_create(Shader* shader, Texture* texture)
 {
 	Material m;
 	m.color   = WHITE;
-	m.shader  = shader;
-	m.texture = texture;
+	m.shader  = shader  ? resource_handle(&shader->res)  : 0;
+	m.texture = texture ? resource_handle(&texture->res) : 0;
 	return m;
 }
 
 void material_destroy(Material* m)
 {
-	if (m->shader)  iresource_free(m->shader),  m->shader  = NULL;
-	if (m->texture) iresource_free(m->texture), m->texture = NULL;
+	if (m->shader)  resource_free_handle(m->shader),  m->shader  = 0;
+	if (m->texture) resource_free_handle(m->texture), m->texture = 0;
 }
 
 void material_move(Material* dst, Material* src)
 {
-	Shader*  s = dst->shader;
-	Texture* t = dst->texture;
+	ResHandle s = dst->shader;
+	ResHandle t = dst->texture;
 	dst->shader  = src->shader;
 	dst->texture = src->texture;
 	src->shader  = s;
 	src->texture = t;
 }
 
+Shader* material_shader(const Material* m)
+{
+	return iresource_resolve(Shader, m->shader);
+}
+Texture* material_texture(const Material* m)
+{
+	return iresource_resolve(Texture, m->texture);
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
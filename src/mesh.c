@@ -1,59 +1,606 @@
 #include "mesh.h"
 #include <stdlib.h>
+#include <string.h> // memset
+#include <stdint.h> // int64_t
+#include <math.h>   // fminf
+#include <float.h>  // FLT_MAX
 #include "util.h"
+#include "vfs.h"
+#include "delete_queue.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
+int bmd_version(const BMDModel* model)
+{
+	// v1 vertex data starts right after the v1 header, where v2+ keeps its magic
+	if (model->off_verts >= BMD_V2_HEADER_SIZE && memcmp(model->magic, BMD_MAGIC, 4) == 0)
+		return model->version;
+	return 1;
+}
+
+int bmd_header_size(const BMDModel* model)
+{
+	switch (bmd_version(model)) {
+		case 1:  return BMD_V1_HEADER_SIZE;
+		case 2:  return BMD_V2_HEADER_SIZE;
+		default: return (int)sizeof(BMDModel);
+	}
+}
+
 vertex_t* model_vertices(BMDModel* model)
 {
 	return (vertex_t*)((char*)model + model->off_verts);
 }
+qvertex_t* model_qvertices(BMDModel* model)
+{
+	return (qvertex_t*)((char*)model + model->off_verts);
+}
 index_t* model_indices(BMDModel* model)
 {
 	return (index_t*)((char*)model + model->off_indices);
 }
+unsigned short* model_indices16(BMDModel* model)
+{
+	return (unsigned short*)((char*)model + model->off_indices);
+}
+int bmd_lods(const BMDModel* model, BMDLod* out)
+{
+	if (bmd_version(model) != 1 && model->num_lods > 0) {
+		const int n = model->num_lods < BMD_MAX_LODS ? model->num_lods : BMD_MAX_LODS;
+		memcpy(out, (const char*)model + bmd_header_size(model), sizeof(BMDLod) * n); // the table follows the header
+		for (int i = 0; i < n && bmd_version(model) < 3; ++i)
+			out[i].num_meshlets = 0; // reserved before v3
+		return n;
+	}
+	out[0] = (BMDLod){ 0, model->num_indices, 0.0f, 0 };
+	return 1;
+}
+const BMDMeshlet* bmd_meshlets(const BMDModel* model, int* count)
+{
+	BMDLod lods[BMD_MAX_LODS];
+	const int numLods = bmd_lods(model, lods);
+	*count = 0;
+	for (int i = 0; i < numLods; ++i)
+		*count += lods[i].num_meshlets;
+	if (*count == 0)
+		return NULL;
+	// the meshlet table follows the LOD table
+	return (const BMDMeshlet*)((const char*)model + bmd_header_size(model) + numLods * sizeof(BMDLod));
+}
+
+bounds3d bmd_bounds(const BMDModel* model)
+{
+	const int version = bmd_version(model);
+	const char* verts = (const char*)model + model->off_verts;
+	if (version == 1)
+		return bounds_from_points((const float*)verts, model->num_verts, sizeof(vertex_t));
+	if (version == 2)
+		return bounds_from_qpoints((const unsigned short*)verts, model->num_verts, sizeof(qvertex_t),
+		                           model->bounds_min, model->bounds_max);
+	return (bounds3d){ model->bounds_min, model->bounds_max, model->sphere_center, model->sphere_radius };
+}
+
+bool bmd_validate(const BMDModel* m, int size)
+{
+	if (size < BMD_V1_HEADER_SIZE || m->num_verts < 0 || m->num_indices < 0 || 
+	    m->off_verts < BMD_V1_HEADER_SIZE || m->off_indices < BMD_V1_HEADER_SIZE)
+		return false;
+	const int version = size >= BMD_V2_HEADER_SIZE ? bmd_version(m) : 1;
+	if (version != 1 && version != 2 && version != BMD_VERSION)
+		return false;
+	const int headerSize = bmd_header_size(m);
+	if (size < headerSize || m->off_verts < headerSize || m->off_indices < headerSize)
+		return false;
+	const int64_t vertSize  = version == 1 ? sizeof(vertex_t) : sizeof(qvertex_t);
+	const int64_t indexSize = version == 1 ? sizeof(index_t)  : m->index_size;
+	if (indexSize != 2 && indexSize != 4)
+		return false;
+	if (indexSize == 2 && m->num_verts > 65536)
+		return false;
+	if (m->off_verts   + vertSize  * m->num_verts   > size ||
+	    m->off_indices + indexSize * m->num_indices > size)
+		return false;
+	if (version == 1 || m->num_lods == 0)
+		return true;
+
+	const int64_t tableEnd = headerSize + (int64_t)sizeof(BMDLod) * m->num_lods;
+	if (m->num_lods < 0 || m->num_lods > BMD_MAX_LODS || 
+	    m->off_verts < tableEnd || m->off_indices < tableEnd)
+		return false;
+	const BMDLod* lods = (const BMDLod*)((const char*)m + headerSize);
+	int64_t numMeshlets = 0;
+	for (int i = 0; i < m->num_lods; ++i) {
+		if (lods[i].first_index < 0 || lods[i].num_indices < 0 ||
+		    (int64_t)lods[i].first_index + lods[i].num_indices > m->num_indices)
+			return false;
+		if (version != 2 && lods[i].num_meshlets < 0)
+			return false;
+		numMeshlets += version != 2 ? lods[i].num_meshlets : 0;
+	}
+	if (numMeshlets == 0)
+		return true;
+
+	const int64_t meshletsEnd = tableEnd + (int64_t)sizeof(BMDMeshlet) * numMeshlets;
+	if (m->off_verts < meshletsEnd || m->off_indices < meshletsEnd)
+		return false;
+	const BMDMeshlet* meshlets = (const BMDMeshlet*)((const char*)m + tableEnd);
+	for (int i = 0; i < m->num_lods; ++i) { // every meshlet lies inside its LOD
+		const int64_t lodEnd = (int64_t)lods[i].first_index + lods[i].num_indices;
+		for (int j = 0; j < lods[i].num_meshlets; ++j, ++meshlets)
+			if (meshlets->first_index < lods[i].first_index || meshlets->num_indices < 0 ||
+			    (int64_t)meshlets->first_index + meshlets->num_indices > lodEnd)
+				return false;
+	}
+	return true;
+}
+
+// rounds x up to a multiple of 16, keeps vertex and index data SIMD aligned
+static int align16(int x) { return (x + 15) & ~15; }
+
+// quantizes v1 positions into the bounds, packs UVs as half floats and normals as octahedral
+static void quantize_vertices(BMDModel* v2, const vertex_t* src, const bounds3d* bounds)
+{
+	const int numVerts = v2->num_verts;
+	const vec3 lo = bounds->min, hi = bounds->max;
+	v2->bounds_min = lo;
+	v2->bounds_max = hi;
+
+	// flat axes would divide by zero, any scale quantizes them to 0
+	const vec3 extent = vec3_sub(hi, lo);
+	const vec3 scale  = { extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+	                      extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+	                      extent.z > 0.0f ? 65535.0f / extent.z : 0.0f };
+	qvertex_t* dst = model_qvertices(v2);
+	for (int i = 0; i < numVerts; ++i) {
+		const vertex_t* v = &src[i];
+		qvertex_t* q = &dst[i];
+		q->x = (unsigned short)fminf((v->x - lo.x) * scale.x + 0.5f, 65535.0f);
+		q->y = (unsigned short)fminf((v->y - lo.y) * scale.y + 0.5f, 65535.0f);
+		q->z = (unsigned short)fminf((v->z - lo.z) * scale.z + 0.5f, 65535.0f);
+		q->w = 0;
+		q->u = half_from_float(v->u);
+		q->v = half_from_float(v->v);
+		const vec2 n = oct_encode(v->norm);
+		q->nx = (short)lrintf(n.x * 32767.0f);
+		q->ny = (short)lrintf(n.y * 32767.0f);
+	}
+}
+
+BMDModel* bmd_convert(const BMDModel* m, int size, int* outSize)
+{
+	if (!bmd_validate(m, size) || bmd_version(m) == BMD_VERSION)
+		return NULL;
+
+	const int version    = bmd_version(m);
+	const int numVerts   = m->num_verts;
+	const int numIndices = m->num_indices;
+	const int numLods    = version == 1 ? 0 : m->num_lods;
+	const int indexSize  = version != 1 ? m->index_size : numVerts <= 65536 ? 2 : 4;
+	const int offVerts   = align16(sizeof(BMDModel) + numLods * sizeof(BMDLod));
+	const int offIndices = align16(offVerts + numVerts * sizeof(qvertex_t));
+	const int total      = offIndices + numIndices * indexSize;
+	BMDModel* out = calloc(1, total);
+	if (!out) return NULL;
+
+	memcpy(out->name,     m->name,     sizeof(out->name));
+	memcpy(out->tex_name, m->tex_name, sizeof(out->tex_name));
+	memcpy(out->magic, BMD_MAGIC, 4);
+	out->version     = BMD_VERSION;
+	out->num_verts   = numVerts;
+	out->num_indices = numIndices;
+	out->off_verts   = offVerts;
+	out->off_indices = offIndices;
+	out->index_size  = indexSize;
+	out->num_lods    = numLods;
+	if (numLods) bmd_lods(m, (BMDLod*)(out + 1)); // v2 has no meshlets, its LODs reserved 0
+
+	if (version == 1) {
+		const bounds3d b = bmd_bounds(m);
+		quantize_vertices(out, (const vertex_t*)((const char*)m + m->off_verts), &b);
+		const index_t* indices = (const index_t*)((const char*)m + m->off_indices);
+		if (indexSize == 2) {
+			unsigned short* dst16 = model_indices16(out);
+			for (int i = 0; i < numIndices; ++i)
+				dst16[i] = (unsigned short)indices[i];
+		}
+		else memcpy(model_indices(out), indices, numIndices * sizeof(index_t));
+	} else { // v2: the vertex format is unchanged, the header gains the bounding sphere
+		out->bounds_min = m->bounds_min;
+		out->bounds_max = m->bounds_max;
+		memcpy(model_qvertices(out), (const char*)m + m->off_verts, numVerts * sizeof(qvertex_t));
+		memcpy(model_indices(out), (const char*)m + m->off_indices, numIndices * indexSize);
+	}
+	// the sphere of the quantized positions, so it bounds exactly what's drawn
+	const bounds3d b = bounds_from_qpoints(&model_qvertices(out)->x, numVerts, sizeof(qvertex_t),
+	                                       out->bounds_min, out->bounds_max);
+	out->sphere_center = b.center;
+	out->sphere_radius = b.radius;
+	*outSize = total;
+	return out;
+}
+
+bool bmd_optimize(BMDModel* m, int size, meshopt_stats* before, meshopt_stats* after)
+{
+	if (!bmd_validate(m, size))
+		return false;
+	const int version    = bmd_version(m);
+	const int numVerts   = m->num_verts;
+	const int numIndices = m->num_indices;
+	const int stride     = version == 1 ? sizeof(vertex_t) : sizeof(qvertex_t);
+	const bool narrow    = version != 1 && m->index_size == 2;
+	BMDLod lods[BMD_MAX_LODS];
+	const int numLods    = bmd_lods(m, lods);
+	int numMeshlets;
+	const BMDMeshlet* meshlets = bmd_meshlets(m, &numMeshlets);
+
+	unsigned* indices   = malloc(sizeof(unsigned) * (numIndices + 1));
+	unsigned* reordered = malloc(sizeof(unsigned) * (numIndices + 1));
+	int*      clusters  = malloc(sizeof(int) * (numIndices / 3 + 1));
+	unsigned* remap     = malloc(sizeof(unsigned) * (numVerts + 1));
+	char*     vertices  = malloc((size_t)stride * numVerts + 1);
+	vec3*     positions = version == 1 ? NULL : malloc(sizeof(vec3) * (numVerts + 1));
+	bool ok = indices && reordered && clusters && remap && vertices && (version == 1 || positions);
+	for (int i = 0; ok && i < numIndices; ++i) {
+		indices[i] = narrow ? model_indices16(m)[i] : model_indices(m)[i];
+		ok = indices[i] < (unsigned)numVerts;
+	}
+	if (!ok) {
+		LOG("bmd_optimize(): '%s' is out of memory or has invalid indices\n", m->name);
+		goto cleanup;
+	}
+
+	// overdraw sorting only needs relative positions, v2 skips the dequantize transform
+	const float* pos = (const float*)model_vertices(m);
+	int posStride = stride;
+	if (version != 1) {
+		const qvertex_t* q = model_qvertices(m);
+		for (int i = 0; i < numVerts; ++i)
+			positions[i] = (vec3){ q[i].x, q[i].y, q[i].z };
+		pos = &positions->x;
+		posStride = sizeof(vec3);
+	}
+
+	if (before) *before = meshopt_analyze(&indices[lods[0].first_index], lods[0].num_indices, numVerts);
+	for (int i = 0; i < numLods; ++i) { // LODs are drawn on their own, so optimize each on its own
+		if (lods[i].num_meshlets == 0) {
+			unsigned* lod = &indices[lods[i].first_index];
+			const int count = lods[i].num_indices - lods[i].num_indices % 3;
+			const int numClusters = meshopt_vertex_cache(reordered, lod, count, numVerts, clusters);
+			meshopt_overdraw(lod, reordered, count, pos, numVerts, posStride, clusters, numClusters, 1.05f);
+			continue;
+		}
+		// meshlets are culled on their own too and already sorted against overdraw,
+		// so their triangles only get a vertex cache order inside them
+		for (int j = 0; j < lods[i].num_meshlets; ++j, ++meshlets) {
+			unsigned* ml = &indices[meshlets->first_index];
+			meshopt_vertex_cache(reordered, ml, meshlets->num_indices, numVerts, clusters);
+			memcpy(ml, reordered, sizeof(unsigned) * meshlets->num_indices);
+		}
+	}
+	// LOD0 comes first, so coarser LODs fetch a subset of its vertices in the same order
+	meshopt_vertex_fetch(remap, indices, numIndices, numVerts);
+	if (after) *after = meshopt_analyze(&indices[lods[0].first_index], lods[0].num_indices, numVerts);
+
+	char* data = (char*)model_vertices(m);
+	memcpy(vertices, data, (size_t)stride * numVerts);
+	meshopt_remap_vertices(data, vertices, numVerts, stride, remap);
+	for (int i = 0; i < numIndices; ++i) {
+		if (narrow) model_indices16(m)[i] = (unsigned short)indices[i];
+		else        model_indices(m)[i]   = indices[i];
+	}
+
+cleanup:
+	free(indices);
+	free(reordered);
+	free(clusters);
+	free(remap);
+	free(vertices);
+	free(positions);
+	return ok;
+}
+
+// decodes BMD v2+ vertices to 8 floats each: model space position, uv and normal
+static void decode_vertices(const BMDModel* m, float* verts)
+{
+	const qvertex_t* q = (const qvertex_t*)((const char*)m + m->off_verts);
+	const vec3 lo = m->bounds_min, extent = vec3_sub(m->bounds_max, m->bounds_min);
+	for (int i = 0; i < m->num_verts; ++i) {
+		float* v = &verts[i * 8];
+		v[0] = lo.x + q[i].x * (extent.x / 65535.0f);
+		v[1] = lo.y + q[i].y * (extent.y / 65535.0f);
+		v[2] = lo.z + q[i].z * (extent.z / 65535.0f);
+		v[3] = half_to_float(q[i].u);
+		v[4] = half_to_float(q[i].v);
+		const vec3 n = oct_decode((vec2){ fmaxf(q[i].nx / 32767.0f, -1.0f), fmaxf(q[i].ny / 32767.0f, -1.0f) });
+		v[5] = n.x, v[6] = n.y, v[7] = n.z;
+	}
+}
+
+BMDModel* bmd_generate_lods(const BMDModel* m, int size, int numLods, float ratio, int* outSize)
+{
+	if (!bmd_validate(m, size) || bmd_version(m) != BMD_VERSION)
+		return NULL;
+	numLods = numLods < 1 ? 1 : numLods > BMD_MAX_LODS ? BMD_MAX_LODS : numLods;
+
+	BMDLod lods[BMD_MAX_LODS];
+	bmd_lods(m, lods); // existing LODs are replaced, LOD0 is the source
+	const int numVerts    = m->num_verts;
+	const int baseIndices = lods[0].num_indices - lods[0].num_indices % 3;
+	const int indexSize   = m->index_size;
+	unsigned* chain = malloc(sizeof(unsigned) * ((size_t)baseIndices * numLods + 1));
+	float*    verts = malloc(sizeof(float) * 8 * (numVerts + 1)); // pos, uv, normal
+	if (!chain || !verts) {
+		free(chain);
+		free(verts);
+		return NULL;
+	}
+
+	// simplify in model space, quantized positions would weigh the axes unevenly
+	const qvertex_t* q = (const qvertex_t*)((const char*)m + m->off_verts);
+	decode_vertices(m, verts);
+	const char* srcIndices = (const char*)m + m->off_indices;
+	for (int i = 0; i < baseIndices; ++i)
+		chain[i] = indexSize == 2 ? ((const unsigned short*)srcIndices)[lods[0].first_index + i]
+		                          : ((const index_t*)srcIndices)[lods[0].first_index + i];
+
+	lods[0] = (BMDLod){ 0, baseIndices, 0.0f, 0 };
+	int n = 1, total = baseIndices;
+	for (; n < numLods; ++n) {
+		const int target = (int)(lods[n - 1].num_indices / 3 * ratio) * 3;
+		float error;
+		const int count = meshopt_simplify(&chain[total], chain, baseIndices, verts, numVerts,
+			8 * sizeof(float), &verts[3], 8 * sizeof(float), 5, target, &error);
+		if (count == 0 || count > lods[n - 1].num_indices * 0.9f)
+			break; // not worth another LOD
+		lods[n] = (BMDLod){ total, count, fmaxf(error, lods[n - 1].error), 0 };
+		total += count;
+	}
+
+	const int offVerts   = align16(sizeof(BMDModel) + n * sizeof(BMDLod));
+	const int offIndices = align16(offVerts + numVerts * sizeof(qvertex_t));
+	const int outBytes   = offIndices + total * indexSize;
+	BMDModel* out = calloc(1, outBytes);
+	if (out) {
+		memcpy(out, m, sizeof(BMDModel)); // bounds are unchanged, LODs reuse the vertices
+		out->num_lods    = n;
+		out->num_indices = total;
+		out->off_verts   = offVerts;
+		out->off_indices = offIndices;
+		memcpy(out + 1, lods, n * sizeof(BMDLod));
+		memcpy(model_qvertices(out), q, numVerts * sizeof(qvertex_t));
+		for (int i = 0; i < total; ++i) {
+			if (indexSize == 2) model_indices16(out)[i] = (unsigned short)chain[i];
+			else                model_indices(out)[i]   = chain[i];
+		}
+		*outSize = outBytes;
+	}
+	free(chain);
+	free(verts);
+	return out;
+}
+
+BMDModel* bmd_build_meshlets(const BMDModel* m, int size, int* outSize)
+{
+	if (!bmd_validate(m, size) || bmd_version(m) != BMD_VERSION)
+		return NULL;
+
+	BMDLod lods[BMD_MAX_LODS];
+	const int numLods    = bmd_lods(m, lods); // models without LODs get a LOD0 entry for the table
+	const int numVerts   = m->num_verts;
+	const int numIndices = m->num_indices;
+	const int indexSize  = m->index_size;
+	int maxMeshlets = 1;
+	for (int i = 0; i < numLods; ++i)
+		maxMeshlets += lods[i].num_indices / 3;
+
+	unsigned*   indices  = malloc(sizeof(unsigned) * (numIndices + 1));
+	unsigned*   grouped  = malloc(sizeof(unsigned) * (numIndices + 1));
+	float*      verts    = malloc(sizeof(float) * 8 * (numVerts + 1));
+	BMDMeshlet* meshlets = malloc(sizeof(BMDMeshlet) * maxMeshlets);
+	BMDModel*   out      = NULL;
+	bool ok = indices && grouped && verts && meshlets;
+	const char* srcIndices = (const char*)m + m->off_indices;
+	for (int i = 0; ok && i < numIndices; ++i) {
+		indices[i] = indexSize == 2 ? ((const unsigned short*)srcIndices)[i] : ((const index_t*)srcIndices)[i];
+		ok = indices[i] < (unsigned)numVerts;
+	}
+	if (!ok) {
+		LOG("bmd_build_meshlets(): '%s' is out of memory or has invalid indices\n", m->name);
+		goto cleanup;
+	}
+
+	decode_vertices(m, verts); // bounds in model space, so culling doesn't need to dequantize
+	memcpy(grouped, indices, sizeof(unsigned) * numIndices);
+	int total = 0;
+	for (int i = 0; i < numLods; ++i) {
+		const int count = lods[i].num_indices - lods[i].num_indices % 3;
+		const int n = meshopt_build_meshlets(&meshlets[total], &grouped[lods[i].first_index],
+			&indices[lods[i].first_index], count, verts, numVerts, 8 * sizeof(float));
+		if (n == 0 && count > 0)
+			goto cleanup; // out of memory
+		for (int j = 0; j < n; ++j)
+			meshlets[total + j].first_index += lods[i].first_index;
+		lods[i].num_meshlets = n;
+		total += n;
+	}
+
+	const int tableSize  = numLods * sizeof(BMDLod) + total * sizeof(BMDMeshlet);
+	const int offVerts   = align16(sizeof(BMDModel) + tableSize);
+	const int offIndices = align16(offVerts + numVerts * sizeof(qvertex_t));
+	const int outBytes   = offIndices + numIndices * indexSize;
+	if ((out = calloc(1, outBytes))) {
+		memcpy(out, m, sizeof(BMDModel)); // vertex data is unchanged
+		out->num_lods    = numLods;
+		out->off_verts   = offVerts;
+		out->off_indices = offIndices;
+		memcpy(out + 1, lods, numLods * sizeof(BMDLod));
+		memcpy((BMDLod*)(out + 1) + numLods, meshlets, total * sizeof(BMDMeshlet));
+		memcpy(model_qvertices(out), (const char*)m + m->off_verts, numVerts * sizeof(qvertex_t));
+		for (int i = 0; i < numIndices; ++i) {
+			if (indexSize == 2) model_indices16(out)[i] = (unsigned short)grouped[i];
+			else                model_indices(out)[i]   = grouped[i];
+		}
+		*outSize = outBytes;
+	}
+
+cleanup:
+	free(indices);
+	free(grouped);
+	free(verts);
+	free(meshlets);
+	return out;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
+bool mesh_dequantize_matrix(const StaticMesh* sm, mat4* out)
+{
+	if (bmd_version(sm->model) == 1)
+		return false;
+	mat4_from_position(out, sm->model->bounds_min);
+	vec3 extent = vec3_sub(sm->model->bounds_max, sm->model->bounds_min);
+	return mat4_scale(out, extent) != NULL;
+}
+
+float mesh_projected_size(const StaticMesh* sm, const mat4* model, const mat4* viewProjection)
+{
+	const bounds3d world = bounds_transform(&sm->bounds, model);
+	mat4 vp = *viewProjection;
+	const vec4 clip = mat4_mul3(&vp, world.center);
+
+	// the view rotation is orthonormal, so the length of the clip Y row is the projection's
+	// focal scale: the radius projects without decomposing the camera
+	const float focal = sqrtf(vp.m01*vp.m01 + vp.m11*vp.m11 + vp.m21*vp.m21);
+	if (clip.w <= world.radius) // the camera is inside the bounds
+		return FLT_MAX;
+	return 0.5f * world.radius * focal / clip.w; // NDC spans 2 units of the viewport height
+}
+
+int mesh_select_lod(const StaticMesh* sm, float screenSize, int current)
+{
+	if (current < 0 || current >= sm->numLods)
+		current = 0;
+	const float tolerance = MESH_LOD_TOLERANCE;
+	if (sm->lods[current].error * screenSize > tolerance * (1.0f + MESH_LOD_HYSTERESIS)) {
+		// too coarse: the coarsest finer LOD that's within tolerance, errors grow with the LOD index
+		while (current > 0 && sm->lods[current].error * screenSize > tolerance)
+			--current;
+		return current;
+	}
+	// coarser LODs only once they're clearly within tolerance
+	while (current + 1 < sm->numLods &&
+	       sm->lods[current + 1].error * screenSize <= tolerance * (1.0f - MESH_LOD_HYSTERESIS))
+		++current;
+	return current;
+}
+
+int mesh_draw_meshlets(const StaticMesh* sm, int lod, const mat4* mvp)
+{
+	meshopt_frustum frustum;
+	meshopt_frustum_from_matrix(&frustum, mvp->m);
+	const BMDMeshlet* meshlets = sm->meshlets;
+	for (int i = 0; i < lod; ++i)
+		meshlets += sm->lods[i].num_meshlets;
+
+	// meshlets of a LOD are back to back, so visible neighbours merge into one range
+	enum { MAX_RANGES = 256 };
+	int first[MAX_RANGES], count[MAX_RANGES];
+	int numRanges = 0, numDrawn = 0;
+	for (int i = 0; i < sm->lods[lod].num_meshlets; ++i) {
+		const BMDMeshlet* ml = &meshlets[i];
+		if (!meshopt_meshlet_visible(ml, &frustum))
+			continue;
+		++numDrawn;
+		if (numRanges && first[numRanges - 1] + count[numRanges - 1] == ml->first_index) {
+			count[numRanges - 1] += ml->num_indices;
+			continue;
+		}
+		if (numRanges == MAX_RANGES) {
+			gp_draw_multi(sm->pool, &sm->range, first, count, numRanges);
+			numRanges = 0;
+		}
+		first[numRanges] = ml->first_index;
+		count[numRanges++] = ml->num_indices;
+	}
+	if (numRanges)
+		gp_draw_multi(sm->pool, &sm->range, first, count, numRanges);
+	return numDrawn;
+}
+
+bool mesh_has_cpu_data(const StaticMesh* sm)
+{
+	return sm->model && (const void*)sm->model == sm->file.data;
+}
+
+static void close_file(vfs_file* f)
+{
+	vfs_close(f);
+	free(f);
+}
+
+// loose file data is released once the GPU is done with this frame
+static void release_file(StaticMesh* sm)
+{
+	vfs_file* f;
+	if ((sm->file.owned || sm->file.mapped) && (f = malloc(sizeof(vfs_file)))) {
+		*f = sm->file;
+		dq_free(f, (DeleteQueue_FreeFunc)&close_file);
+		memset(&sm->file, 0, sizeof(sm->file));
+	}
+	else vfs_close(&sm->file);
+}
+
 static void _mesh_free(StaticMesh* sm)
 {
-	if (sm->model) free(sm->model);
-	if (sm->array) va_destroy(sm->array);
+	if (sm->model && !mesh_has_cpu_data(sm))
+		free(sm->model); // header copy of a gpuOnly mesh
+	sm->model = NULL;
+	free(sm->meshlets);
+	sm->meshlets = NULL;
+	release_file(sm);
+	if (sm->pool) gp_free(sm->pool, &sm->range);
+	sm->pool = NULL;
 }
-static bool _mesh_load(StaticMesh* sm, const char* fullPath)
+static bool _mesh_read(StaticMesh* sm, const char* fullPath)
 {
-	// read the 3D model data
-	FILE* f = fopen(fullPath, "rb");
-	if (f == 0) {
-		printf("meshmgr_load(): fopen failed %s\n", fullPath);
+	sm->model = NULL;
+	sm->pool  = NULL;
+	sm->meshlets = NULL;
+	sm->numMeshlets = 0;
+
+	// map the 3D model data, packed models are used in place
+	if (!vfs_map(&sm->file, fullPath)) {
+		printf("meshmgr_load(): open failed %s\n", fullPath);
 		return false;
 	}
 	
-	int size = sm->size = fsize(f);
-	// allocate memory for the model and read the binary data:
-	BMDModel* m = sm->model = malloc(size);
-	if (!m) { // good practice: recover gracefully if something breaks
-		printf("meshmgr_load(): malloc %dKB failed %s\n", size/1024, fullPath);
+	int size = sm->size = sm->file.size;
+	BMDModel* m = sm->model = (BMDModel*)sm->file.data;
+	if (!bmd_validate(m, size)) { // good practice: recover gracefully if something breaks
+		printf("meshmgr_load(): invalid model %s\n", fullPath);
+		vfs_close(&sm->file);
 		return false;
 	}
-	fread(m, size, 1, f);
-	fclose(f); // close the file handle (!)
-
-	// finalize mesh data by uploading it to the GPU
-	vertex_descr descr = { sizeof(vertex_t), a_Position,3, a_Coord,2, a_Normal,3 };
-	sm->array = va_new_indexed_array(
-		model_vertices(m), m->num_verts,
-		model_indices(m),  m->num_indices, descr 
-	);
+	sm->res.cpuBytes = sm->file.owned ? size : 0; // mapped pages belong to the OS cache
+	sm->numLods = bmd_lods(m, sm->lods); // copied, gpuOnly meshes drop the table with the file
+	sm->bounds  = bmd_bounds(m);         // read from v3 headers, older models are scanned
+	const BMDMeshlet* meshlets = bmd_meshlets(m, &sm->numMeshlets);
+	if (meshlets && (sm->meshlets = malloc(sizeof(BMDMeshlet) * sm->numMeshlets)))
+		memcpy(sm->meshlets, meshlets, sizeof(BMDMeshlet) * sm->numMeshlets);
+	else for (int i = 0; i < sm->numLods; ++i) // no table or out of memory: draw whole LODs
+		sm->lods[i].num_meshlets = 0, sm->numMeshlets = 0;
+	sm->res.cpuBytes += sizeof(BMDMeshlet) * sm->numMeshlets;
 
 	#if DEBUG
 		printf("------------------\n");
 		printf("FileSize: %d\n", size);
-		printf("Loaded model   %s (%dKB)\n", m->name, size / 1024);
+		printf("Loaded model   %s (%dKB) BMD v%d\n", m->name, size / 1024, bmd_version(m));
 		printf("  Texture      %s\n", m->tex_name);
 		printf("  NumVertices  %d\n", m->num_verts);
 		printf("  NumIndices   %d\n", m->num_indices);
 		printf("  Polys        %d\n", m->num_indices/3);
+		printf("  LODs         %d\n", sm->numLods);
+		printf("  Meshlets     %d\n", sm->numMeshlets);
 		//vertex_t* verts   = model_vertices(m);
 		//index_t*  indices = model_indices(m);
 		//for (int i = 0; i < 20 && i < m->num_verts; ++i) {
@@ -67,14 +614,43 @@ static bool _mesh_load(StaticMesh* sm, const char* fullPath)
 	#endif
 	return true;
 }
+static bool _mesh_load(StaticMesh* sm, const char* fullPath)
+{
+	// finalize mesh data by uploading it to the GPU
+	BMDModel* m = sm->model;
+	const int version = bmd_version(m);
+	const vertex_descr descr = version == 1
+		? (vertex_descr){ sizeof(vertex_t), {{a_Position,3}, {a_Coord,2}, {a_Normal,3}} }
+		: (vertex_descr){ sizeof(qvertex_t), 
+			{{a_Position,4,VT_UNORM16}, {a_Coord,2,VT_HALF}, {a_Normal,2,VT_SNORM16}} };
+	const int indexSize = version == 1 ? (int)sizeof(index_t) : m->index_size;
+
+	// meshes of the same vertex layout share one VAO and one pair of buffers
+	geometry_pool* pool = gp_shared(descr);
+	if (!pool || !gp_alloc(pool, &sm->range, model_vertices(m), m->num_verts,
+	                       model_indices(m), m->num_indices, indexSize))
+		return false;
+	sm->pool = pool;
+	sm->res.gpuBytes = m->num_verts*descr.sizeOf + m->num_indices*va_index_size(sm->range.indexType);
+
+	// gpuOnly: keep the header, the vertex and index data now live on the GPU
+	BMDModel* header;
+	if (sm->res.mgr->gpuOnly && (header = calloc(1, sizeof(BMDModel)))) {
+		memcpy(header, m, bmd_header_size(m));
+		sm->model = header;
+		release_file(sm);
+		sm->res.cpuBytes = sizeof(BMDModel) + sizeof(BMDMeshlet) * sm->numMeshlets;
+	}
+	return true;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
-MeshManager* mesh_manager_create(int maxCount) {
+MeshManager* mesh_manager_create(int slabSize) {
 	static int id = 0;
-	char name[32]; snprintf(name, 32, "mesh_manager_$%d_[%d]", id++, maxCount);
-	return (MeshManager*)res_manager_create(name, maxCount, sizeof(StaticMesh), 
-		(ResMgr_LoadFunc)_mesh_load, (ResMgr_FreeFunc)_mesh_free);
+	char name[32]; snprintf(name, 32, "mesh_manager_$%d_[%d]", id++, slabSize);
+	return (MeshManager*)res_manager_create(name, slabSize, sizeof(StaticMesh), 
+		(ResMgr_ReadFunc)_mesh_read, (ResMgr_LoadFunc)_mesh_load, (ResMgr_FreeFunc)_mesh_free);
 }
 
 
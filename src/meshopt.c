@@ -0,0 +1,949 @@
+#include "meshopt.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "util.h" // xxhash64
+
+////////////////////////////////////////////////////////////////////////////////
+
+// FIFO cache simulation: a vertex is cached if it was transformed at most
+// MESHOPT_CACHE_SIZE transforms ago. Hits don't refresh the entry.
+typedef struct fifo_cache
+{
+	unsigned* stamps; // [numVerts] transform time of every vertex
+	unsigned  time;   // ticks on every transform
+} fifo_cache;
+
+static bool cache_init(fifo_cache* c, int numVerts)
+{
+	c->stamps = calloc(numVerts ? numVerts : 1, sizeof(unsigned));
+	c->time   = MESHOPT_CACHE_SIZE + 1; // everything starts uncached
+	return c->stamps != NULL;
+}
+
+// invalidates all entries, used when simulating a cold start
+static void cache_reset(fifo_cache* c)
+{
+	c->time += MESHOPT_CACHE_SIZE + 1;
+}
+
+static bool cache_hit(const fifo_cache* c, unsigned v)
+{
+	return c->time - c->stamps[v] <= MESHOPT_CACHE_SIZE;
+}
+
+// @return Number of cache misses for a triangle
+static int cache_triangle(fifo_cache* c, const unsigned* tri)
+{
+	int misses = 0;
+	for (int k = 0; k < 3; ++k)
+		if (!cache_hit(c, tri[k]))
+			c->stamps[tri[k]] = c->time++, ++misses;
+	return misses;
+}
+
+meshopt_stats meshopt_analyze(const unsigned* indices, int numIndices, int numVerts)
+{
+	meshopt_stats stats = { 0.0f, 0.0f };
+	fifo_cache cache;
+	bool* used = calloc(numVerts ? numVerts : 1, sizeof(bool));
+	if (!used || !cache_init(&cache, numVerts)) {
+		free(used);
+		return stats;
+	}
+	int misses = 0, numUsed = 0;
+	for (int i = 0; i + 2 < numIndices; i += 3)
+		misses += cache_triangle(&cache, &indices[i]);
+	for (int i = 0; i < numIndices; ++i)
+		if (!used[indices[i]]) used[indices[i]] = true, ++numUsed;
+	if (numIndices >= 3) stats.acmr = (float)misses / (numIndices / 3);
+	if (numUsed)         stats.atvr = (float)misses / numUsed;
+	free(cache.stamps);
+	free(used);
+	return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Tipsify: fans around a vertex that's still in the cache, falling back to
+//// recently used vertices, then to the next unfinished vertex in input order.
+
+typedef struct tipsify
+{
+	int*      live;      // [numVerts] triangles not emitted yet per vertex
+	int*      offsets;   // [numVerts+1] start of each vertex's triangles in adjacency
+	int*      adjacency; // [numIndices] triangles of every vertex
+	unsigned* deadEnd;   // [numIndices] stack of recently emitted vertices
+	int       deadTop;
+	int       cursor;    // next vertex to try in input order
+	int       numVerts;
+} tipsify;
+
+static int skip_dead_end(tipsify* t)
+{
+	while (t->deadTop > 0) {
+		const unsigned d = t->deadEnd[--t->deadTop];
+		if (t->live[d] > 0) return (int)d;
+	}
+	for (; t->cursor < t->numVerts; ++t->cursor)
+		if (t->live[t->cursor] > 0) return t->cursor;
+	return -1;
+}
+
+int meshopt_vertex_cache(unsigned* dst, const unsigned* indices, int numIndices, int numVerts,
+                         int* clusters)
+{
+	const int numTris = numIndices / 3;
+	tipsify t = { 0 };
+	t.numVerts  = numVerts;
+	t.live      = calloc(numVerts + 1, sizeof(int));
+	t.offsets   = calloc(numVerts + 1, sizeof(int));
+	t.adjacency = malloc(sizeof(int) * (numIndices + 1));
+	t.deadEnd   = malloc(sizeof(unsigned) * (numIndices + 1));
+	unsigned* candidates = malloc(sizeof(unsigned) * (numIndices + 1));
+	bool*     emitted    = calloc(numTris + 1, sizeof(bool));
+	fifo_cache cache = { 0 };
+	int numClusters = 0;
+	if (!t.live || !t.offsets || !t.adjacency || !t.deadEnd || !candidates || !emitted ||
+	    !cache_init(&cache, numVerts)) {
+		memcpy(dst, indices, sizeof(unsigned) * numTris * 3); // keep the input order
+		if (clusters) clusters[0] = 0;
+		numClusters = numTris ? 1 : 0;
+		goto cleanup;
+	}
+
+	// vertex -> triangle adjacency
+	for (int i = 0; i < numTris * 3; ++i)
+		++t.live[indices[i]];
+	for (int v = 0; v < numVerts; ++v)
+		t.offsets[v + 1] = t.offsets[v] + t.live[v];
+	for (int i = 0; i < numTris * 3; ++i)
+		t.adjacency[t.offsets[indices[i]]++] = i / 3;
+	for (int v = numVerts; v > 0; --v) // undo the fill increments
+		t.offsets[v] = t.offsets[v - 1];
+	t.offsets[0] = 0;
+
+	int out = 0;
+	int fan = skip_dead_end(&t);
+	if (fan >= 0 && clusters) clusters[numClusters] = 0;
+	if (fan >= 0) ++numClusters;
+	while (fan >= 0) {
+		int numCandidates = 0;
+		for (int a = t.offsets[fan]; a < t.offsets[fan + 1]; ++a) {
+			const int tri = t.adjacency[a];
+			if (emitted[tri]) continue;
+			emitted[tri] = true;
+			const unsigned* v = &indices[tri * 3];
+			for (int k = 0; k < 3; ++k) {
+				dst[out++] = v[k];
+				t.deadEnd[t.deadTop++] = v[k];
+				candidates[numCandidates++] = v[k];
+				--t.live[v[k]];
+			}
+			cache_triangle(&cache, v);
+		}
+
+		// the oldest candidate that stays cached while fanning its remaining triangles
+		int best = -1, bestPriority = -1;
+		for (int i = 0; i < numCandidates; ++i) {
+			const unsigned v = candidates[i];
+			if (t.live[v] <= 0) continue;
+			const int age = (int)(cache.time - cache.stamps[v]);
+			const int priority = age + 2 * t.live[v] <= MESHOPT_CACHE_SIZE ? age : 0;
+			if (priority > bestPriority)
+				bestPriority = priority, best = (int)v;
+		}
+		if (best < 0 && (best = skip_dead_end(&t)) >= 0) { // dead end starts a new cluster
+			if (clusters) clusters[numClusters] = out / 3;
+			++numClusters;
+		}
+		fan = best;
+	}
+
+cleanup:
+	free(t.live);
+	free(t.offsets);
+	free(t.adjacency);
+	free(t.deadEnd);
+	free(candidates);
+	free(emitted);
+	free(cache.stamps);
+	return numClusters;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Overdraw: view independent cluster sorting [Sander et al. 2007]
+
+typedef struct cluster_key
+{
+	float sortKey; // dot(cluster center - mesh center, cluster normal)
+	int   cluster;
+} cluster_key;
+
+static int compare_clusters(const void* a, const void* b)
+{
+	const float ka = ((const cluster_key*)a)->sortKey;
+	const float kb = ((const cluster_key*)b)->sortKey;
+	return ka > kb ? -1 : ka < kb; // descending, outward facing clusters first
+}
+
+// splits clusters where the running ACMR since the last split has warmed up to
+// threshold * the cluster's ACMR, so a cold restart there costs little
+static int split_clusters(int* out, const unsigned* indices, int numTris, int numVerts,
+                          const int* clusters, int numClusters, float threshold)
+{
+	fifo_cache cache;
+	if (!cache_init(&cache, numVerts)) {
+		memcpy(out, clusters, sizeof(int) * numClusters);
+		return numClusters;
+	}
+	int numOut = 0;
+	for (int c = 0; c < numClusters; ++c) {
+		const int start = clusters[c];
+		const int end   = c + 1 < numClusters ? clusters[c + 1] : numTris;
+		cache_reset(&cache);
+		int misses = 0;
+		for (int i = start; i < end; ++i)
+			misses += cache_triangle(&cache, &indices[i * 3]);
+		const float limit = threshold * misses / (end - start);
+
+		cache_reset(&cache);
+		out[numOut++] = start;
+		int splitStart = start;
+		misses = 0;
+		for (int i = start; i < end - 1; ++i) {
+			misses += cache_triangle(&cache, &indices[i * 3]);
+			if (misses <= limit * (i - splitStart + 1)) {
+				out[numOut++] = splitStart = i + 1;
+				misses = 0;
+				cache_reset(&cache);
+			}
+		}
+	}
+	free(cache.stamps);
+	return numOut;
+}
+
+static const float* vertex_pos(const float* positions, int stride, unsigned v)
+{
+	return (const float*)((const char*)positions + (size_t)v * stride);
+}
+
+void meshopt_overdraw(unsigned* dst, const unsigned* indices, int numIndices,
+                      const float* positions, int numVerts, int stride,
+                      int* clusters, int numClusters, float threshold)
+{
+	const int numTris = numIndices / 3;
+	int* split = malloc(sizeof(int) * (numTris + 1));
+	float* sums = calloc((size_t)(numTris + 1) * 7, sizeof(float)); // per cluster: area, centroid*area, normal
+	cluster_key* keys = malloc(sizeof(cluster_key) * (numTris + 1));
+	if (!split || !sums || !keys) {
+		memcpy(dst, indices, sizeof(unsigned) * numTris * 3);
+		goto cleanup;
+	}
+	numClusters = split_clusters(split, indices, numTris, numVerts, clusters, numClusters, threshold);
+
+	// area weighted cluster centroids and normals
+	double mesh[4] = { 0.0, 0.0, 0.0, 0.0 }; // area, centroid*area
+	for (int c = 0; c < numClusters; ++c) {
+		const int end = c + 1 < numClusters ? split[c + 1] : numTris;
+		float* s = &sums[c * 7];
+		for (int i = split[c]; i < end; ++i) {
+			const float* p0 = vertex_pos(positions, stride, indices[i*3 + 0]);
+			const float* p1 = vertex_pos(positions, stride, indices[i*3 + 1]);
+			const float* p2 = vertex_pos(positions, stride, indices[i*3 + 2]);
+			const float e1[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+			const float e2[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+			const float n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+			const float area  = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+			s[0] += area;
+			for (int k = 0; k < 3; ++k) {
+				s[1 + k] += (p0[k] + p1[k] + p2[k]) * (1.0f / 3.0f) * area;
+				s[4 + k] += n[k];
+			}
+		}
+		for (int k = 0; k < 4; ++k) mesh[k] += s[k];
+	}
+	const double meshArea = mesh[0] > 0.0 ? mesh[0] : 1.0;
+	for (int c = 0; c < numClusters; ++c) {
+		const float* s = &sums[c * 7];
+		const float area = s[0] > 0.0f ? s[0] : 1.0f;
+		const float len  = sqrtf(s[4]*s[4] + s[5]*s[5] + s[6]*s[6]);
+		float key = 0.0f;
+		for (int k = 0; k < 3; ++k)
+			key += (float)(s[1 + k] / area - mesh[1 + k] / meshArea) * (len > 0.0f ? s[4 + k] / len : 0.0f);
+		keys[c].sortKey = key;
+		keys[c].cluster = c;
+	}
+	qsort(keys, numClusters, sizeof(cluster_key), compare_clusters);
+
+	int out = 0;
+	for (int i = 0; i < numClusters; ++i) {
+		const int c     = keys[i].cluster;
+		const int start = split[c];
+		const int end   = c + 1 < numClusters ? split[c + 1] : numTris;
+		memcpy(&dst[out], &indices[start * 3], sizeof(unsigned) * (end - start) * 3);
+		out += (end - start) * 3;
+	}
+
+cleanup:
+	free(split);
+	free(sums);
+	free(keys);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int meshopt_vertex_fetch(unsigned* remap, unsigned* indices, int numIndices, int numVerts)
+{
+	memset(remap, 0xff, sizeof(unsigned) * numVerts);
+	unsigned next = 0;
+	for (int i = 0; i < numIndices; ++i) {
+		unsigned* r = &remap[indices[i]];
+		if (*r == ~0u) *r = next++;
+		indices[i] = *r;
+	}
+	const int numUsed = (int)next;
+	for (int v = 0; v < numVerts; ++v)
+		if (remap[v] == ~0u) remap[v] = next++;
+	return numUsed;
+}
+
+void meshopt_remap_vertices(void* dst, const void* vertices, int numVerts, int stride,
+                            const unsigned* remap)
+{
+	for (int v = 0; v < numVerts; ++v)
+		memcpy((char*)dst + (size_t)remap[v] * stride, (const char*)vertices + (size_t)v * stride, stride);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Simplification: quadric error half-edge collapses [Garland & Heckbert 1997]
+//// on position welded vertices, in passes of independent collapses.
+
+typedef struct quadric
+{
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2; // symmetric plane quadric (a,b,c,d)(a,b,c,d)^T
+	double w; // total weight, error / w is the mean squared distance
+} quadric;
+
+static void quadric_add_plane(quadric* q, const float n[3], float d, float w)
+{
+	const double a = n[0], b = n[1], c = n[2];
+	q->a2 += a*a*w; q->ab += a*b*w; q->ac += a*c*w; q->ad += a*d*w;
+	q->b2 += b*b*w; q->bc += b*c*w; q->bd += b*d*w;
+	q->c2 += c*c*w; q->cd += c*d*w;
+	q->d2 += (double)d*d*w;
+	q->w  += w;
+}
+
+static void quadric_add(quadric* q, const quadric* o)
+{
+	double* dst = &q->a2; const double* src = &o->a2;
+	for (int i = 0; i < 11; ++i) dst[i] += src[i];
+}
+
+// @return Mean squared distance of p to the planes of q and r
+static float quadric_error(const quadric* q, const quadric* r, const float p[3])
+{
+	quadric s = *q;
+	if (r) quadric_add(&s, r);
+	const double x = p[0], y = p[1], z = p[2];
+	const double e = s.a2*x*x + 2*s.ab*x*y + 2*s.ac*x*z + 2*s.ad*x
+	               + s.b2*y*y + 2*s.bc*y*z + 2*s.bd*y
+	               + s.c2*z*z + 2*s.cd*z + s.d2;
+	return s.w > 0.0 && e > 0.0 ? (float)(e / s.w) : 0.0f;
+}
+
+static void cross3(float out[3], const float* p0, const float* p1, const float* p2)
+{
+	const float e1[3] = { p1[0]-p0[0], p1[1]-p0[1], p1[2]-p0[2] };
+	const float e2[3] = { p2[0]-p0[0], p2[1]-p0[1], p2[2]-p0[2] };
+	out[0] = e1[1]*e2[2] - e1[2]*e2[1];
+	out[1] = e1[2]*e2[0] - e1[0]*e2[2];
+	out[2] = e1[0]*e2[1] - e1[1]*e2[0];
+}
+
+static float normalize3(float v[3])
+{
+	const float len = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+	if (len > 0.0f) v[0] /= len, v[1] /= len, v[2] /= len;
+	return len;
+}
+
+typedef struct collapse
+{
+	float cost;
+	unsigned from, to;
+} collapse;
+
+static int compare_collapses(const void* a, const void* b)
+{
+	const float ca = ((const collapse*)a)->cost;
+	const float cb = ((const collapse*)b)->cost;
+	return ca < cb ? -1 : ca > cb;
+}
+
+typedef struct simplifier
+{
+	int       numVerts;
+	float*    pos;      // [numVerts*3] positions normalized into the unit cube
+	unsigned* weld;     // [numVerts] first vertex with the same position
+	unsigned* remap;    // [numVerts] collapse target of every welded vertex, or itself
+	unsigned* wedges;   // [numVerts] next vertex with the same position, circular
+	quadric*  quadrics; // [numVerts] per welded vertex
+	unsigned* tris;     // [numIndices] welded corners of the remaining triangles
+	unsigned* source;   // [numIndices/3] input triangle of every remaining triangle
+	int       numTris;
+	int*      offsets;  // [numVerts+1] vertex -> triangle adjacency, rebuilt every pass
+	int*      adjacency;// [numIndices]
+	bool*     locked;   // [numVerts] touched by a collapse this pass
+	collapse* edges;    // [numIndices] candidate collapses
+} simplifier;
+
+static void build_adjacency(simplifier* s)
+{
+	memset(s->offsets, 0, sizeof(int) * (s->numVerts + 1));
+	for (int i = 0; i < s->numTris * 3; ++i)
+		++s->offsets[s->tris[i] + 1];
+	for (int v = 0; v < s->numVerts; ++v)
+		s->offsets[v + 1] += s->offsets[v];
+	for (int i = 0; i < s->numTris * 3; ++i)
+		s->adjacency[s->offsets[s->tris[i]]++] = i / 3;
+	for (int v = s->numVerts; v > 0; --v) // undo the fill increments
+		s->offsets[v] = s->offsets[v - 1];
+	s->offsets[0] = 0;
+}
+
+static bool has_edge(const simplifier* s, unsigned a, unsigned b) // directed a->b
+{
+	for (int i = s->offsets[a]; i < s->offsets[a + 1]; ++i) {
+		const unsigned* t = &s->tris[s->adjacency[i] * 3];
+		for (int k = 0; k < 3; ++k)
+			if (t[k] == a && t[(k + 1) % 3] == b) return true;
+	}
+	return false;
+}
+
+// links vertices with bitwise equal positions: weld[v] is the first of them, wedges is optional
+// and receives a circular list through all of them. Without memory nothing is welded.
+static void weld_vertices(unsigned* weld, unsigned* wedges, const float* positions, int numVerts, int stride)
+{
+	int cap = 1;
+	while (cap < numVerts * 2) cap <<= 1;
+	unsigned* table = malloc(sizeof(unsigned) * cap);
+	for (int v = 0; v < numVerts; ++v) {
+		weld[v] = (unsigned)v;
+		if (wedges) wedges[v] = (unsigned)v;
+	}
+	if (!table) return;
+	memset(table, 0xff, sizeof(unsigned) * cap);
+	for (int v = 0; v < numVerts; ++v) {
+		const float* p = vertex_pos(positions, stride, v);
+		unsigned h = (unsigned)xxhash64(p, sizeof(float) * 3, 0) & (cap - 1);
+		for (;; h = (h + 1) & (cap - 1)) {
+			const unsigned u = table[h];
+			if (u == ~0u) { table[h] = v; break; }
+			if (!memcmp(vertex_pos(positions, stride, u), p, sizeof(float) * 3)) {
+				weld[v] = u;
+				if (wedges) {
+					wedges[v] = wedges[u]; // insert into u's circular list
+					wedges[u] = v;
+				}
+				break;
+			}
+		}
+	}
+	free(table);
+}
+
+static void weld_positions(simplifier* s, const float* positions, int stride)
+{
+	weld_vertices(s->weld, s->wedges, positions, s->numVerts, stride); // seams become borders if it fails
+}
+
+static void init_quadrics(simplifier* s)
+{
+	memset(s->quadrics, 0, sizeof(quadric) * s->numVerts);
+	for (int t = 0; t < s->numTris; ++t) {
+		const unsigned* c = &s->tris[t * 3];
+		float n[3];
+		cross3(n, &s->pos[c[0]*3], &s->pos[c[1]*3], &s->pos[c[2]*3]);
+		const float area = normalize3(n) * 0.5f;
+		const float d = -(n[0]*s->pos[c[0]*3] + n[1]*s->pos[c[0]*3+1] + n[2]*s->pos[c[0]*3+2]);
+		for (int k = 0; k < 3; ++k)
+			quadric_add_plane(&s->quadrics[c[k]], n, d, area);
+
+		// open borders get a plane perpendicular to the triangle, so they keep their shape
+		for (int k = 0; k < 3; ++k) {
+			const unsigned a = c[k], b = c[(k + 1) % 3];
+			if (has_edge(s, b, a)) continue;
+			const float* pa = &s->pos[a*3];
+			const float* pb = &s->pos[b*3];
+			float e[3] = { pb[0]-pa[0], pb[1]-pa[1], pb[2]-pa[2] };
+			const float len = normalize3(e);
+			float p[3] = { e[1]*n[2] - e[2]*n[1], e[2]*n[0] - e[0]*n[2], e[0]*n[1] - e[1]*n[0] };
+			normalize3(p);
+			const float pd = -(p[0]*pa[0] + p[1]*pa[1] + p[2]*pa[2]);
+			quadric_add_plane(&s->quadrics[a], p, pd, len * len * 10.0f);
+			quadric_add_plane(&s->quadrics[b], p, pd, len * len * 10.0f);
+		}
+	}
+}
+
+// @return FALSE if moving from onto to flips or degenerates a triangle around from
+static bool collapse_keeps_orientation(const simplifier* s, unsigned from, unsigned to)
+{
+	for (int i = s->offsets[from]; i < s->offsets[from + 1]; ++i) {
+		const unsigned* t = &s->tris[s->adjacency[i] * 3];
+		if (t[0] == to || t[1] == to || t[2] == to) continue; // collapses away
+		const float* p[3];
+		for (int k = 0; k < 3; ++k) p[k] = &s->pos[t[k] * 3];
+		float before[3], after[3];
+		cross3(before, p[0], p[1], p[2]);
+		for (int k = 0; k < 3; ++k) if (t[k] == from) p[k] = &s->pos[to * 3];
+		cross3(after, p[0], p[1], p[2]);
+		const float dot = before[0]*after[0] + before[1]*after[1] + before[2]*after[2];
+		const float lb = normalize3(before), la = normalize3(after);
+		if (dot <= 0.25f * lb * la) // rejects flips and folds sharper than ~75 degrees
+			return false;
+	}
+	return true;
+}
+
+// one pass of independent collapses, cheapest first
+// @return Number of collapses
+static int collapse_pass(simplifier* s, int maxCollapses, float* maxError)
+{
+	build_adjacency(s);
+	int numEdges = 0;
+	for (int t = 0; t < s->numTris; ++t) {
+		const unsigned* c = &s->tris[t * 3];
+		for (int k = 0; k < 3; ++k) {
+			const unsigned a = c[k], b = c[(k + 1) % 3];
+			if (a > b && has_edge(s, b, a)) continue; // visit shared edges once
+			const float ab = quadric_error(&s->quadrics[a], &s->quadrics[b], &s->pos[b*3]);
+			const float ba = quadric_error(&s->quadrics[a], &s->quadrics[b], &s->pos[a*3]);
+			s->edges[numEdges++] = ab <= ba ? (collapse){ ab, a, b } : (collapse){ ba, b, a };
+		}
+	}
+	qsort(s->edges, numEdges, sizeof(collapse), compare_collapses);
+
+	// locked edges push the pass towards costlier collapses, cap them near the cheapest ones
+	const float limit = numEdges ? s->edges[maxCollapses < numEdges ? maxCollapses : numEdges - 1].cost * 1.5f : 0.0f;
+
+	memset(s->locked, 0, sizeof(bool) * s->numVerts);
+	int numCollapses = 0;
+	for (int i = 0; i < numEdges && numCollapses < maxCollapses; ++i) {
+		const collapse* e = &s->edges[i];
+		if (e->cost > limit)
+			break;
+		if (s->locked[e->from] || s->locked[e->to])
+			continue;
+		if (!collapse_keeps_orientation(s, e->from, e->to)) {
+			// try the other direction before giving up on this edge
+			const float cost = quadric_error(&s->quadrics[e->from], &s->quadrics[e->to], &s->pos[e->from*3]);
+			if (!collapse_keeps_orientation(s, e->to, e->from)) continue;
+			s->edges[i] = (collapse){ cost, e->to, e->from };
+		}
+		// everything around from changes, later collapses there would miss it
+		for (int a = s->offsets[e->from]; a < s->offsets[e->from + 1]; ++a) {
+			const unsigned* t = &s->tris[s->adjacency[a] * 3];
+			s->locked[t[0]] = s->locked[t[1]] = s->locked[t[2]] = true;
+		}
+		s->locked[e->to] = true;
+		quadric_add(&s->quadrics[e->to], &s->quadrics[e->from]);
+		s->remap[e->from] = e->to;
+		if (e->cost > *maxError) *maxError = e->cost;
+		++numCollapses;
+	}
+
+	// apply the collapses and drop degenerate triangles
+	int out = 0;
+	for (int t = 0; t < s->numTris; ++t) {
+		unsigned c[3];
+		for (int k = 0; k < 3; ++k) {
+			c[k] = s->remap[s->tris[t*3 + k]];
+		}
+		if (c[0] == c[1] || c[1] == c[2] || c[0] == c[2])
+			continue;
+		memcpy(&s->tris[out * 3], c, sizeof(c));
+		s->source[out++] = s->source[t];
+	}
+	s->numTris = out;
+	return numCollapses;
+}
+
+// @return Vertex of welded position p with the attributes closest to vertex v
+static unsigned closest_wedge(const simplifier* s, unsigned p, unsigned v,
+                              const float* attributes, int attrStride, int attrCount)
+{
+	if (!attributes) return p;
+	const float* av = vertex_pos(attributes, attrStride, v);
+	unsigned best = p;
+	float bestDist = INFINITY;
+	unsigned w = p;
+	do {
+		const float* aw = vertex_pos(attributes, attrStride, w);
+		float dist = 0.0f;
+		for (int i = 0; i < attrCount; ++i)
+			dist += (aw[i] - av[i]) * (aw[i] - av[i]);
+		if (dist < bestDist) bestDist = dist, best = w;
+	} while ((w = s->wedges[w]) != p);
+	return best;
+}
+
+int meshopt_simplify(unsigned* dst, const unsigned* indices, int numIndices,
+                     const float* positions, int numVerts, int stride,
+                     const float* attributes, int attrStride, int attrCount,
+                     int targetIndices, float* error)
+{
+	const int numTris = numIndices / 3;
+	simplifier s = { 0 };
+	s.numVerts  = numVerts;
+	s.pos       = malloc(sizeof(float) * 3 * (numVerts + 1));
+	s.weld      = malloc(sizeof(unsigned) * (numVerts + 1));
+	s.remap     = malloc(sizeof(unsigned) * (numVerts + 1));
+	s.wedges    = malloc(sizeof(unsigned) * (numVerts + 1));
+	s.quadrics  = malloc(sizeof(quadric) * (numVerts + 1));
+	s.tris      = malloc(sizeof(unsigned) * (numIndices + 1));
+	s.source    = malloc(sizeof(unsigned) * (numTris + 1));
+	s.offsets   = malloc(sizeof(int) * (numVerts + 1));
+	s.adjacency = malloc(sizeof(int) * (numIndices + 1));
+	s.locked    = malloc(sizeof(bool) * (numVerts + 1));
+	s.edges     = malloc(sizeof(collapse) * (numIndices + 1));
+	float maxError = 0.0f, radius = 0.0f;
+	int out = numTris * 3;
+	if (!s.pos || !s.weld || !s.remap || !s.wedges || !s.quadrics || !s.tris || !s.source ||
+	    !s.offsets || !s.adjacency || !s.locked || !s.edges) {
+		memcpy(dst, indices, sizeof(unsigned) * out); // nothing simplified
+		goto cleanup;
+	}
+
+	// normalize into the unit cube, errors are then relative to the mesh size
+	float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (int v = 0; v < numVerts; ++v) {
+		const float* p = vertex_pos(positions, stride, v);
+		for (int k = 0; k < 3; ++k) lo[k] = fminf(lo[k], p[k]), hi[k] = fmaxf(hi[k], p[k]);
+	}
+	const float extent = fmaxf(fmaxf(hi[0] - lo[0], hi[1] - lo[1]), fmaxf(hi[2] - lo[2], 1e-20f));
+	for (int v = 0; v < numVerts; ++v) {
+		const float* p = vertex_pos(positions, stride, v);
+		for (int k = 0; k < 3; ++k) s.pos[v*3 + k] = (p[k] - lo[k]) / extent;
+	}
+	if (numVerts) radius = 0.5f * sqrtf((hi[0]-lo[0])*(hi[0]-lo[0]) + (hi[1]-lo[1])*(hi[1]-lo[1]) +
+	                                    (hi[2]-lo[2])*(hi[2]-lo[2])) / extent;
+
+	weld_positions(&s, positions, stride);
+	for (int v = 0; v < numVerts; ++v)
+		s.remap[v] = (unsigned)v;
+	for (int t = 0; t < numTris; ++t) {
+		unsigned c[3];
+		for (int k = 0; k < 3; ++k) c[k] = s.weld[indices[t*3 + k]];
+		if (c[0] == c[1] || c[1] == c[2] || c[0] == c[2])
+			continue;
+		memcpy(&s.tris[s.numTris * 3], c, sizeof(c));
+		s.source[s.numTris++] = t;
+	}
+	build_adjacency(&s);
+	init_quadrics(&s);
+
+	const int targetTris = targetIndices / 3;
+	while (s.numTris > targetTris) // every collapse removes ~2 triangles
+		if (!collapse_pass(&s, (s.numTris - targetTris) / 2 + 1, &maxError))
+			break;
+
+	// the triangles keep their input vertices, or the closest wedge of the collapse target
+	out = 0;
+	for (int t = 0; t < s.numTris; ++t) {
+		for (int k = 0; k < 3; ++k) {
+			const unsigned v = indices[s.source[t]*3 + k];
+			const unsigned p = s.tris[t*3 + k];
+			dst[out++] = s.weld[v] == p ? v : closest_wedge(&s, p, v, attributes, attrStride, attrCount);
+		}
+	}
+
+cleanup:
+	if (error) // relative to the bounding sphere radius in the unit cube
+		*error = radius > 0.0f ? sqrtf(maxError) / radius : 0.0f;
+	free(s.pos);
+	free(s.weld);
+	free(s.remap);
+	free(s.wedges);
+	free(s.quadrics);
+	free(s.tris);
+	free(s.source);
+	free(s.offsets);
+	free(s.adjacency);
+	free(s.locked);
+	free(s.edges);
+	return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Meshlets
+
+// computes the bounding sphere and normal cone of a finished meshlet
+static void close_meshlet(meshopt_meshlet* m, const unsigned* indices, const float* positions, int stride)
+{
+	const unsigned* tris = &indices[m->first_index];
+	const int numTris = m->num_indices / 3;
+
+	// sphere around the AABB center, tight enough for clusters of neighbouring triangles
+	float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (int i = 0; i < numTris * 3; ++i) {
+		const float* p = vertex_pos(positions, stride, tris[i]);
+		for (int k = 0; k < 3; ++k) lo[k] = fminf(lo[k], p[k]), hi[k] = fmaxf(hi[k], p[k]);
+	}
+	float radiusSq = 0.0f;
+	for (int k = 0; k < 3; ++k) m->center[k] = (lo[k] + hi[k]) * 0.5f;
+	for (int i = 0; i < numTris * 3; ++i) {
+		const float* p = vertex_pos(positions, stride, tris[i]);
+		const float d[3] = { p[0] - m->center[0], p[1] - m->center[1], p[2] - m->center[2] };
+		radiusSq = fmaxf(radiusSq, d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+	}
+	m->radius = sqrtf(radiusSq);
+
+	// normal cone: the average normal, and how far the triangle normals stray from it
+	float normals[MESHOPT_MESHLET_TRIS][3];
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	int numNormals = 0;
+	for (int t = 0; t < numTris && numNormals < MESHOPT_MESHLET_TRIS; ++t) {
+		float* n = normals[numNormals];
+		cross3(n, vertex_pos(positions, stride, tris[t*3]),
+		          vertex_pos(positions, stride, tris[t*3 + 1]),
+		          vertex_pos(positions, stride, tris[t*3 + 2]));
+		if (normalize3(n) == 0.0f) continue; // degenerate triangles face nowhere
+		for (int k = 0; k < 3; ++k) axis[k] += n[k];
+		++numNormals;
+	}
+	float minDot = normalize3(axis) > 0.0f ? 1.0f : -1.0f;
+	for (int i = 0; i < numNormals; ++i)
+		minDot = fminf(minDot, normals[i][0]*axis[0] + normals[i][1]*axis[1] + normals[i][2]*axis[2]);
+	memcpy(m->cone_axis, axis, sizeof(axis));
+	// wider than ~85 degrees leaves nothing to cull, and the cutoff loses precision
+	m->cone_cutoff = minDot > 0.1f ? sqrtf(1.0f - minDot * minDot) : 2.0f;
+}
+
+// how much facing away from a meshlet's average normal costs compared to one new vertex: the cone
+// only ranks candidates, meshlets still fill up to the limits, as a cone that is too wide to cull
+// costs less than many small meshlets with more draw ranges and duplicated vertices
+#define MESHLET_CONE_WEIGHT 0.5f
+
+// unemitted triangles after the seed that are searched when no neighbour fits into a meshlet
+#define MESHLET_SEARCH 1024
+
+// vertices of triangle t that aren't in the meshlet yet
+static int meshlet_extra_verts(const unsigned* indices, const int* stamps, int t, int meshlet)
+{
+	int extra = 0;
+	for (int k = 0; k < 3; ++k) extra += stamps[indices[t*3 + k]] != meshlet;
+	return extra;
+}
+
+// next triangle for a meshlet: adjacent to its vertices, adding the fewest new vertices and
+// facing along its average normal, so meshlets grow into compact patches with narrow cones.
+// @return -1 if no neighbour fits into the meshlet
+static int next_meshlet_triangle(const unsigned* indices, const unsigned* weld, const int* adjOffsets,
+                                 const int* adjTris, const float* normals, const bool* emitted,
+                                 const int* stamps, const unsigned* verts, int numUnique, int meshlet,
+                                 const float axis[3])
+{
+	int best = -1;
+	float bestCost = INFINITY;
+	for (int i = 0; i < numUnique; ++i) {
+		const unsigned w = weld[verts[i]]; // neighbours across UV and normal seams too
+		for (int a = adjOffsets[w]; a < adjOffsets[w + 1]; ++a) {
+			const int t = adjTris[a];
+			if (emitted[t]) continue;
+			const int extra = meshlet_extra_verts(indices, stamps, t, meshlet);
+			if (numUnique + extra > MESHOPT_MESHLET_VERTS) continue;
+			const float* n = &normals[t * 3];
+			const float d = n[0]*axis[0] + n[1]*axis[1] + n[2]*axis[2];
+			const float cost = extra + MESHLET_CONE_WEIGHT * (1.0f - d);
+			if (cost < bestCost) bestCost = cost, best = t;
+		}
+	}
+	return best;
+}
+
+// fallback when a meshlet has no free neighbours left: the free triangle closest to its centroid
+// among the next MESHLET_SEARCH triangles after the seed, which are nearby in most input orders.
+// @return -1 if none of them fits into the meshlet
+static int nearest_meshlet_triangle(const unsigned* indices, const float* positions, int stride,
+                                    const bool* emitted, const int* stamps, int numUnique, int meshlet,
+                                    int first, int numTris, const float centroid[3])
+{
+	int best = -1;
+	float bestDist = INFINITY;
+	for (int t = first, searched = 0; t < numTris && searched < MESHLET_SEARCH; ++t) {
+		if (emitted[t]) continue;
+		++searched;
+		if (numUnique + meshlet_extra_verts(indices, stamps, t, meshlet) > MESHOPT_MESHLET_VERTS) continue;
+		float distSq = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			const float c = (vertex_pos(positions, stride, indices[t*3])[k]
+			               + vertex_pos(positions, stride, indices[t*3 + 1])[k]
+			               + vertex_pos(positions, stride, indices[t*3 + 2])[k]) / 3.0f;
+			distSq += (c - centroid[k]) * (c - centroid[k]);
+		}
+		if (distSq < bestDist) bestDist = distSq, best = t;
+	}
+	return best;
+}
+
+int meshopt_build_meshlets(meshopt_meshlet* meshlets, unsigned* dst, const unsigned* indices, int numIndices,
+                           const float* positions, int numVerts, int stride)
+{
+	const int numTris = numIndices / 3;
+	int*   stamps     = malloc(sizeof(int) * (numVerts + 1)); // meshlet that last used every vertex
+	unsigned* weld    = malloc(sizeof(unsigned) * (numVerts + 1));
+	int*   adjOffsets = calloc(numVerts + 1, sizeof(int));    // triangles around every welded vertex
+	int*   adjTris    = malloc(sizeof(int) * (numTris * 3 + 1));
+	float* normals    = malloc(sizeof(float) * 3 * (numTris + 1));
+	bool*  emitted    = calloc(numTris + 1, sizeof(bool));
+	int numMeshlets = 0;
+	if (!stamps || !weld || !adjOffsets || !adjTris || !normals || !emitted)
+		goto cleanup;
+
+	memset(stamps, 0xff, sizeof(int) * numVerts);
+	weld_vertices(weld, NULL, positions, numVerts, stride);
+	for (int i = 0; i < numTris * 3; ++i)
+		++adjOffsets[weld[indices[i]]];
+	for (int v = 0, sum = 0; v <= numVerts; ++v) { // offsets of the end of every list, filled backwards
+		sum += v < numVerts ? adjOffsets[v] : 0;
+		adjOffsets[v] = sum;
+	}
+	for (int i = numTris * 3 - 1; i >= 0; --i)
+		adjTris[--adjOffsets[weld[indices[i]]]] = i / 3;
+	for (int t = 0; t < numTris; ++t) {
+		cross3(&normals[t * 3], vertex_pos(positions, stride, indices[t*3]),
+		                        vertex_pos(positions, stride, indices[t*3 + 1]),
+		                        vertex_pos(positions, stride, indices[t*3 + 2]));
+		normalize3(&normals[t * 3]);
+	}
+
+	// grow meshlets from the first free triangle in input order, which keeps the seeds local
+	unsigned verts[MESHOPT_MESHLET_VERTS];
+	int numOut = 0;
+	for (int seed = 0; seed < numTris; ++seed) {
+		if (emitted[seed]) continue;
+		meshopt_meshlet* m = &meshlets[numMeshlets];
+		memset(m, 0, sizeof(*m));
+		m->first_index = numOut;
+		float axis[3] = { 0.0f, 0.0f, 0.0f }, sum[3] = { 0.0f, 0.0f, 0.0f };
+		float centroid[3] = { 0.0f, 0.0f, 0.0f }; // sum of the triangle centers until the last one
+		int numUnique = 0;
+		for (int t = seed; t >= 0 && m->num_indices < MESHOPT_MESHLET_TRIS * 3; ) {
+			emitted[t] = true;
+			for (int k = 0; k < 3; ++k) {
+				const unsigned v = dst[numOut++] = indices[t*3 + k];
+				if (stamps[v] != numMeshlets)
+					stamps[v] = numMeshlets, verts[numUnique++] = v;
+				for (int j = 0; j < 3; ++j) centroid[j] += vertex_pos(positions, stride, v)[j] / 3.0f;
+			}
+			for (int k = 0; k < 3; ++k) sum[k] += normals[t*3 + k];
+			m->num_indices += 3;
+			memcpy(axis, sum, sizeof(axis));
+			normalize3(axis);
+			t = next_meshlet_triangle(indices, weld, adjOffsets, adjTris, normals, emitted, stamps,
+			                          verts, numUnique, numMeshlets, axis);
+			if (t < 0) { // closed patch or seam, keep filling with what lies nearby
+				const float tris = (float)(m->num_indices / 3);
+				const float c[3] = { centroid[0] / tris, centroid[1] / tris, centroid[2] / tris };
+				t = nearest_meshlet_triangle(indices, positions, stride, emitted, stamps, numUnique,
+				                             numMeshlets, seed + 1, numTris, c);
+			}
+		}
+		close_meshlet(m, dst, positions, stride);
+		++numMeshlets;
+	}
+
+	// outward facing meshlets first, as in meshopt_overdraw(): they tend to occlude the others
+	cluster_key* keys = malloc(sizeof(cluster_key) * (numMeshlets + 1));
+	meshopt_meshlet* sorted = malloc(sizeof(meshopt_meshlet) * (numMeshlets + 1));
+	unsigned* reordered = malloc(sizeof(unsigned) * (numTris * 3 + 1));
+	if (keys && sorted && reordered) {
+		float center[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < numMeshlets; ++i)
+			for (int k = 0; k < 3; ++k) center[k] += meshlets[i].center[k] * meshlets[i].num_indices / numOut;
+		for (int i = 0; i < numMeshlets; ++i) {
+			const meshopt_meshlet* m = &meshlets[i];
+			keys[i].sortKey = (m->center[0] - center[0]) * m->cone_axis[0]
+			                + (m->center[1] - center[1]) * m->cone_axis[1]
+			                + (m->center[2] - center[2]) * m->cone_axis[2];
+			keys[i].cluster = i;
+		}
+		qsort(keys, numMeshlets, sizeof(cluster_key), compare_clusters);
+		numOut = 0;
+		for (int i = 0; i < numMeshlets; ++i) {
+			sorted[i] = meshlets[keys[i].cluster];
+			memcpy(&reordered[numOut], &dst[sorted[i].first_index], sizeof(unsigned) * sorted[i].num_indices);
+			sorted[i].first_index = numOut;
+			numOut += sorted[i].num_indices;
+		}
+		memcpy(meshlets, sorted, sizeof(meshopt_meshlet) * numMeshlets);
+		memcpy(dst, reordered, sizeof(unsigned) * numOut);
+	}
+	free(keys);
+	free(sorted);
+	free(reordered);
+
+cleanup:
+	free(stamps);
+	free(weld);
+	free(adjOffsets);
+	free(adjTris);
+	free(normals);
+	free(emitted);
+	return numMeshlets;
+}
+
+void meshopt_frustum_from_matrix(meshopt_frustum* f, const float mvp[16])
+{
+	// Gribb & Hartmann: clip space planes are sums of the matrix rows
+	for (int i = 0; i < 6; ++i) {
+		const int row = i / 2;
+		const float sign = i % 2 ? -1.0f : 1.0f;
+		for (int k = 0; k < 4; ++k)
+			f->planes[i][k] = mvp[k*4 + 3] + sign * mvp[k*4 + row];
+	}
+
+	// the eye projects to clip x = y = w = 0, solve the 3x3 system with Cramer's rule
+	const float a[3][3] = {
+		{ mvp[0], mvp[4], mvp[8]  },
+		{ mvp[1], mvp[5], mvp[9]  },
+		{ mvp[3], mvp[7], mvp[11] },
+	};
+	const float b[3] = { -mvp[12], -mvp[13], -mvp[15] };
+	const float det = a[0][0] * (a[1][1]*a[2][2] - a[1][2]*a[2][1])
+	                - a[0][1] * (a[1][0]*a[2][2] - a[1][2]*a[2][0])
+	                + a[0][2] * (a[1][0]*a[2][1] - a[1][1]*a[2][0]);
+	f->perspective = fabsf(det) > 1e-12f;
+	for (int c = 0; c < 3; ++c) {
+		float m[3][3];
+		memcpy(m, a, sizeof(m));
+		for (int r = 0; r < 3; ++r) m[r][c] = b[r];
+		const float d = m[0][0] * (m[1][1]*m[2][2] - m[1][2]*m[2][1])
+		              - m[0][1] * (m[1][0]*m[2][2] - m[1][2]*m[2][0])
+		              + m[0][2] * (m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+		f->eye[c] = f->perspective ? d / det : 0.0f;
+	}
+}
+
+bool meshopt_meshlet_visible(const meshopt_meshlet* m, const meshopt_frustum* f)
+{
+	for (int i = 0; i < 6; ++i) {
+		const float* p = f->planes[i];
+		const float len = sqrtf(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+		if (p[0]*m->center[0] + p[1]*m->center[1] + p[2]*m->center[2] + p[3] < -m->radius * len)
+			return false;
+	}
+	if (!f->perspective || m->cone_cutoff > 1.0f)
+		return true;
+	// every triangle faces away if the eye is outside the cone's "front" [meshoptimizer]
+	const float d[3] = { m->center[0] - f->eye[0], m->center[1] - f->eye[1], m->center[2] - f->eye[2] };
+	const float dist = sqrtf(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+	return d[0]*m->cone_axis[0] + d[1]*m->cone_axis[1] + d[2]*m->cone_axis[2]
+	     < m->cone_cutoff * dist + m->radius;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,301 @@
+#include "mipmap.h"
+#include <stdlib.h> // malloc
+#include <string.h> // memcpy
+#include <math.h>   // sinf, sqrtf
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MIP_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define KAISER_TAPS  8    // taps per axis, spanning 8 source texels around each 2x2 footprint
+#define KAISER_ALPHA 4.0f // window shape, higher trades sharpness for less ringing
+#define KAISER_LEFT  (KAISER_TAPS / 2 - 1) // taps left of the footprint
+
+int mip_levels(int width, int height)
+{
+	int size = width > height ? width : height;
+	int levels = 1;
+	while (size > 1) size >>= 1, ++levels;
+	return levels;
+}
+
+int mip_size(int size, int level)
+{
+	size >>= level;
+	return size ? size : 1;
+}
+
+int mip_chain_bytes(int width, int height, int levels)
+{
+	int bytes = 0;
+	for (int i = 1; i < levels; ++i)
+		bytes += mip_size(width, i) * mip_size(height, i) * 4;
+	return bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void box_scalar(unsigned char* dst, const unsigned char* src, int width, int height, int x0)
+{
+	const int dw = mip_size(width, 1), dh = mip_size(height, 1);
+	for (int y = 0; y < dh; ++y) {
+		const unsigned char* r0 = src + (2 * y) * width * 4;
+		const unsigned char* r1 = src + (2 * y + 1 < height ? 2 * y + 1 : height - 1) * width * 4;
+		for (int x = x0; x < dw; ++x) {
+			const int a = 2 * x * 4, b = (2 * x + 1 < width ? 2 * x + 1 : width - 1) * 4;
+			for (int c = 0; c < 4; ++c)
+				dst[(y * dw + x) * 4 + c] = (unsigned char)((r0[a + c] + r0[b + c] + r1[a + c] + r1[b + c] + 2) >> 2);
+		}
+	}
+}
+
+#if MIP_SSE2
+// 4 destination pixels per iteration, the leftover columns go through box_scalar
+static void box_sse2(unsigned char* dst, const unsigned char* src, int width, int height)
+{
+	const int dw = mip_size(width, 1), dh = mip_size(height, 1);
+	const int simdWidth = dw & ~3;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two  = _mm_set1_epi16(2);
+	for (int y = 0; y < dh; ++y) {
+		const unsigned char* r0 = src + (2 * y) * width * 4;
+		const unsigned char* r1 = src + (2 * y + 1 < height ? 2 * y + 1 : height - 1) * width * 4;
+		unsigned char* out = dst + y * dw * 4;
+		for (int x = 0; x < simdWidth; x += 4) {
+			const __m128i a0 = _mm_loadu_si128((const __m128i*)(r0 + x * 8));
+			const __m128i a1 = _mm_loadu_si128((const __m128i*)(r0 + x * 8 + 16));
+			const __m128i b0 = _mm_loadu_si128((const __m128i*)(r1 + x * 8));
+			const __m128i b1 = _mm_loadu_si128((const __m128i*)(r1 + x * 8 + 16));
+			// vertical sums of source pixels 0-1, 2-3, 4-5, 6-7 as 16-bit channels
+			const __m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			const __m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			const __m128i s45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			const __m128i s67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+			// horizontal pairs: even pixels + odd pixels
+			const __m128i d01 = _mm_add_epi16(_mm_unpacklo_epi64(s01, s23), _mm_unpackhi_epi64(s01, s23));
+			const __m128i d23 = _mm_add_epi16(_mm_unpacklo_epi64(s45, s67), _mm_unpackhi_epi64(s45, s67));
+			const __m128i lo = _mm_srli_epi16(_mm_add_epi16(d01, two), 2);
+			const __m128i hi = _mm_srli_epi16(_mm_add_epi16(d23, two), 2);
+			_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(lo, hi));
+		}
+	}
+	if (simdWidth < dw)
+		box_scalar(dst, src, width, height, simdWidth);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+static float bessel_i0(float x)
+{
+	float sum = 1.0f, term = 1.0f;
+	for (int k = 1; k < 16; ++k) {
+		const float t = x / (2.0f * k);
+		term *= t * t;
+		sum += term;
+	}
+	return sum;
+}
+
+// normalized weights of the taps at distances -3.5 .. +3.5 source texels from the footprint center
+static void kaiser_weights(float* weights)
+{
+	const float pi = 3.14159265f;
+	float total = 0.0f;
+	for (int k = 0; k < KAISER_TAPS; ++k) {
+		const float d = k - (KAISER_TAPS - 1) * 0.5f;
+		const float x = d * 0.5f; // cutoff at half the source frequency
+		const float sinc = sinf(pi * x) / (pi * x);
+		const float t = d / (KAISER_TAPS * 0.5f);
+		const float window = bessel_i0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / bessel_i0(KAISER_ALPHA);
+		total += weights[k] = sinc * window;
+	}
+	for (int k = 0; k < KAISER_TAPS; ++k)
+		weights[k] /= total;
+}
+
+/**
+ * Separable filter: source rows are widened to float with clamped padding, filtered
+ * horizontally into a ring of KAISER_TAPS rows, then each destination row is
+ * filtered vertically from the ring. Neighbouring destination rows share 6 of the 8 rows.
+ */
+typedef struct kaiser_state
+{
+	float  weights[KAISER_TAPS];
+	float* padded;                // source row, KAISER_TAPS-1 clamped pixels of padding
+	float* ring[KAISER_TAPS];     // horizontally filtered rows, dw pixels each
+	int    ringRow[KAISER_TAPS];  // source row held by each ring slot, -1 if none
+} kaiser_state;
+
+static bool kaiser_begin(kaiser_state* ks, int width, int dw)
+{
+	kaiser_weights(ks->weights);
+	const int paddedSize = (width + KAISER_TAPS - 1) * 4;
+	const int ringSize   = dw * 4;
+	float* mem = malloc(sizeof(float) * (paddedSize + ringSize * KAISER_TAPS));
+	if (!mem) return false;
+	ks->padded = mem;
+	for (int i = 0; i < KAISER_TAPS; ++i) {
+		ks->ring[i] = mem + paddedSize + ringSize * i;
+		ks->ringRow[i] = -1;
+	}
+	return true;
+}
+
+static void kaiser_pad_row(float* padded, const unsigned char* row, int width)
+{
+	for (int i = 0; i < width + KAISER_TAPS - 1; ++i) {
+		int x = i - KAISER_LEFT;
+		x = x < 0 ? 0 : x >= width ? width - 1 : x;
+		for (int c = 0; c < 4; ++c)
+			padded[i * 4 + c] = row[x * 4 + c];
+	}
+}
+
+static inline unsigned char kaiser_round(float v)
+{
+	v += 0.5f;
+	return (unsigned char)(v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v);
+}
+
+static void kaiser_scalar_row(const kaiser_state* ks, float* dst, const float* padded, int width, int dw)
+{
+	const float* w = ks->weights;
+	if (width == 1) { // nothing to filter on this axis
+		memcpy(dst, padded + KAISER_LEFT * 4, sizeof(float) * 4);
+		return;
+	}
+	for (int x = 0; x < dw; ++x) {
+		const float* p = padded + (2 * x) * 4; // first tap at source x = 2x - KAISER_LEFT
+		for (int c = 0; c < 4; ++c) {
+			float acc = 0.0f;
+			for (int k = 0; k < KAISER_TAPS; ++k)
+				acc += p[k * 4 + c] * w[k];
+			dst[x * 4 + c] = acc;
+		}
+	}
+}
+
+static void kaiser_scalar_column(const kaiser_state* ks, unsigned char* dst, const float** rows, int dw)
+{
+	const float* w = ks->weights;
+	for (int i = 0; i < dw * 4; ++i) {
+		float acc = 0.0f;
+		for (int k = 0; k < KAISER_TAPS; ++k)
+			acc += rows[k][i] * w[k];
+		dst[i] = kaiser_round(acc);
+	}
+}
+
+#if MIP_SSE2
+static void kaiser_sse2_row(const kaiser_state* ks, float* dst, const float* padded, int width, int dw)
+{
+	if (width == 1) {
+		memcpy(dst, padded + KAISER_LEFT * 4, sizeof(float) * 4);
+		return;
+	}
+	__m128 w[KAISER_TAPS / 2];
+	for (int k = 0; k < KAISER_TAPS / 2; ++k)
+		w[k] = _mm_set1_ps(ks->weights[k]);
+	for (int x = 0; x < dw; ++x) {
+		const float* p = padded + (2 * x) * 4;
+		__m128 acc = _mm_setzero_ps();
+		for (int k = 0; k < KAISER_TAPS / 2; ++k) // symmetric kernel, half the multiplies
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(p + k * 4),
+				_mm_loadu_ps(p + (KAISER_TAPS - 1 - k) * 4)), w[k]));
+		_mm_storeu_ps(dst + x * 4, acc);
+	}
+}
+
+static void kaiser_sse2_column(const kaiser_state* ks, unsigned char* dst, const float** rows, int dw)
+{
+	__m128 w[KAISER_TAPS / 2];
+	for (int k = 0; k < KAISER_TAPS / 2; ++k)
+		w[k] = _mm_set1_ps(ks->weights[k]);
+	const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps(), max = _mm_set1_ps(255.0f);
+	for (int i = 0; i < dw * 4; i += 4) {
+		__m128 acc = _mm_setzero_ps();
+		for (int k = 0; k < KAISER_TAPS / 2; ++k)
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(rows[k] + i),
+				_mm_loadu_ps(rows[KAISER_TAPS - 1 - k] + i)), w[k]));
+		acc = _mm_min_ps(_mm_max_ps(_mm_add_ps(acc, half), zero), max);
+		const __m128i v = _mm_cvttps_epi32(acc);
+		const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v, v), v);
+		const int rgba = _mm_cvtsi128_si32(packed);
+		memcpy(dst + i, &rgba, 4);
+	}
+}
+#endif
+
+static void kaiser(unsigned char* dst, const unsigned char* src, int width, int height, bool simd)
+{
+	const int dw = mip_size(width, 1), dh = mip_size(height, 1);
+	kaiser_state ks;
+	if (!kaiser_begin(&ks, width, dw)) {
+		box_scalar(dst, src, width, height, 0);
+		return;
+	}
+	void (*filter_row)(const kaiser_state*, float*, const float*, int, int) = &kaiser_scalar_row;
+	void (*filter_column)(const kaiser_state*, unsigned char*, const float**, int) = &kaiser_scalar_column;
+#if MIP_SSE2
+	if (simd) filter_row = &kaiser_sse2_row, filter_column = &kaiser_sse2_column;
+#else
+	(void)simd;
+#endif
+	for (int y = 0; y < dh; ++y) {
+		const float* rows[KAISER_TAPS];
+		for (int k = 0; k < KAISER_TAPS; ++k) {
+			int sy = height == 1 ? 0 : 2 * y - KAISER_LEFT + k;
+			sy = sy < 0 ? 0 : sy >= height ? height - 1 : sy;
+			const int slot = sy % KAISER_TAPS; // 8 consecutive rows never share a slot
+			if (ks.ringRow[slot] != sy) {
+				kaiser_pad_row(ks.padded, src + sy * width * 4, width);
+				filter_row(&ks, ks.ring[slot], ks.padded, width, dw);
+				ks.ringRow[slot] = sy;
+			}
+			rows[k] = ks.ring[slot];
+		}
+		if (height == 1) { // only filtered horizontally
+			for (int i = 0; i < dw * 4; ++i)
+				dst[i] = kaiser_round(rows[0][i]);
+		}
+		else filter_column(&ks, dst + y * dw * 4, rows, dw);
+	}
+	free(ks.padded);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void mip_downsample(void* dst, const void* src, int width, int height, mip_filter filter, bool simd)
+{
+	if (filter == MIP_KAISER) {
+		kaiser(dst, src, width, height, simd);
+		return;
+	}
+#if MIP_SSE2
+	if (simd) {
+		box_sse2(dst, src, width, height);
+		return;
+	}
+#endif
+	box_scalar(dst, src, width, height, 0);
+}
+
+void* mip_generate(const void* rgba, int width, int height, int levels, mip_filter filter)
+{
+	if (levels < 2) return NULL;
+	unsigned char* chain = malloc(mip_chain_bytes(width, height, levels));
+	if (!chain) return NULL;
+	const unsigned char* src = rgba;
+	unsigned char* dst = chain;
+	for (int i = 1; i < levels; ++i) {
+		mip_downsample(dst, src, mip_size(width, i - 1), mip_size(height, i - 1), filter, true);
+		src = dst;
+		dst += mip_size(width, i) * mip_size(height, i) * 4;
+	}
+	return chain;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -1,121 +1,946 @@
 #include "resource.h"
+#include "taskpool.h"
 #include "util.h"
+#include "vfs.h"
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// full path identity of a resource
+typedef struct ResKey
+{
+	uint64_t hash;   // 64-bit path hash
+	uint64_t fphash; // 64-bit filepart hash
+	int      hlen;   // length of path string
+	int      fphlen; // length of path filepart string
+} ResKey;
+
 static int init_hash(uint64_t* outHash, const char* string)
 {
 	int slen = strlen(string);
 	*outHash = fnv64(string, slen);
 	return slen;
 }
-#define keys_begin(resmgr) ((uint64_t*)((char*)resmgr + sizeof(ResManager)))
-#define keys_at(resmgr, index) keys_begin(resmgr)[index]
-#define resmgr_begin(resmgr) ((Resource*)((char*)resmgr + sizeof(ResManager) \
-	+ sizeof(uint64_t)*resmgr->maxCount))
-#define resmgr_at(resmgr, index) ((Resource*)((char*)resmgr + sizeof(ResManager)\
-	+ sizeof(uint64_t)*resmgr->maxCount + resmgr->sizeOf*index))
-#define resmgr_end(resmgr) ((Resource*)((char*)resmgr + sizeof(ResManager)\
-	+ resmgr->maxCount*(sizeof(uint64_t) + resmgr->sizeOf)))
-#define resmgr_next(resmgr, res, sizeOf) ((Resource*)((char*)res + sizeOf))
+static bool init_key(ResKey* key, const char* path)
+{
+	key->hlen   = init_hash(&key->hash, path);
+	key->fphlen = key->hlen ? init_hash(&key->fphash, filepart(path, key->hlen)) : 0;
+	return key->hlen != 0;
+}
+static bool key_matches(const Resource* r, const ResKey* key)
+{
+	return r->hash == key->hash && r->hlen == key->hlen 
+		&& r->fphash == key->fphash && r->fphlen == key->fphlen;
+}
+static bool key_equals(const ResKey* a, const ResKey* b)
+{
+	return a->hash == b->hash && a->hlen == b->hlen 
+		&& a->fphash == b->fphash && a->fphlen == b->fphlen;
+}
+
+// directory of item slabs; when it grows a bigger copy is published and the
+// old one is kept until res_manager_destroy(), so handles resolve without locking
+typedef struct ResSlabs
+{
+	int maxSlabs;             // capacity of slabs[]
+	struct ResSlabs* retired; // previous, smaller directory
+	char* slabs[];            // [maxSlabs] item slabs, NULL if not allocated
+} ResSlabs;
+
+#define keys_at(resmgr, index) (resmgr)->keys[index]
+#define resmgr_slab_size(resmgr) (1 << (resmgr)->slabShift)
+#define resmgr_slabs(resmgr) atomic_load_explicit(&(resmgr)->slabs, memory_order_acquire)
+#define resmgr_at(resmgr, index) ((Resource*)(resmgr_slabs(resmgr)->slabs[(index) >> (resmgr)->slabShift] \
+	+ (resmgr)->sizeOf*((index) & (resmgr_slab_size(resmgr) - 1))))
+
+#define handle_slot(h) ((int)((h) & (RES_MAX_SLOTS - 1)))
+#define handle_gen(h)  ((unsigned)(((h) >> RES_HANDLE_SLOT_BITS) & ((1ull << RES_HANDLE_GEN_BITS) - 1)))
+#define handle_mgr(h)  ((int)((h) >> (RES_HANDLE_SLOT_BITS + RES_HANDLE_GEN_BITS)))
+
+// managers by handle id, slot 0 is never used so handle 0 stays invalid
+static _Atomic(ResManager*) res_managers[RES_MAX_MANAGERS];
+
+// current frame number, see resource_next_frame()
+static atomic_uint res_frame;
+
+// marks the resource as used this frame, only writes once per frame
+static void touch(Resource* r)
+{
+	const unsigned frame = atomic_load_explicit(&res_frame, memory_order_relaxed);
+	if (atomic_load_explicit(&r->lastFrame, memory_order_relaxed) != frame)
+		atomic_store_explicit(&r->lastFrame, frame, memory_order_relaxed);
+}
+
+static void next_generation(Resource* r)
+{
+	if (!++r->generation) r->generation = 1; // 0 is skipped when the 32 bits wrap
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Open-addressing hash index: fnv64 path hash -> item, linear probing.
+//// Entries are write-once: EMPTY -> live -> TOMB, so lock-free readers never
+//// see an entry change identity. Inserts that would push live+tomb entries
+//// over 3/4 of the table publish a fresh table instead, and the old one is
+//// retired until no lock-free readers remain.
+
+typedef struct ResIndexEntry
+{
+	ResKey             key; // path identity, written before res is published
+	_Atomic(Resource*) res; // NULL if empty, INDEX_TOMB if freed
+} ResIndexEntry;
+
+typedef struct ResIndex
+{
+	int mask; // capacity-1, capacity is a power of 2 >= 2x item capacity
+	int used; // number of live + tombstone entries
+	struct ResIndex* retired; // next retired index
+	ResIndexEntry entries[];
+} ResIndex;
+
+static Resource index_tomb;
+#define INDEX_TOMB (&index_tomb)
+
+static ResIndex* index_create(int minSize)
+{
+	int size = 16;
+	while (size < minSize) size <<= 1;
+	ResIndex* ix = calloc(1, sizeof(ResIndex) + size*sizeof(ResIndexEntry));
+	if (ix) ix->mask = size - 1;
+	return ix;
+}
+
+// @note Safe to call without holding the lock
+static Resource* index_find(ResIndex* ix, const ResKey* key)
+{
+	const int mask = ix->mask;
+	for (int i = (int)key->hash & mask; ; i = (i + 1) & mask) {
+		ResIndexEntry* e = &ix->entries[i];
+		Resource* r = atomic_load_explicit(&e->res, memory_order_acquire);
+		if (!r) return NULL;
+		if (r != INDEX_TOMB && key_equals(&e->key, key))
+			return r; // we have a pretty solid match
+	}
+}
+
+static void index_put(ResIndex* ix, const ResKey* key, Resource* r)
+{
+	const int mask = ix->mask;
+	int i = (int)key->hash & mask;
+	while (atomic_load_explicit(&ix->entries[i].res, memory_order_relaxed))
+		i = (i + 1) & mask; // live and tombstone entries are skipped
+	ix->entries[i].key = *key;
+	atomic_store_explicit(&ix->entries[i].res, r, memory_order_release);
+	++ix->used;
+}
+
+// publishes a new index with all live items and no tombstones
+static bool index_rebuild(ResManager* rm)
+{
+	ResIndex* ix = index_create(rm->capacity * 2);
+	if (!ix) return false;
+	for (int i = 0; i < rm->count; ++i) {
+		const int slot = rm->alive[i];
+		Resource* r = resmgr_at(rm, slot);
+		ResKey key = { keys_at(rm, slot), r->fphash, r->hlen, r->fphlen };
+		index_put(ix, &key, r);
+	}
+
+	ResIndex* old = atomic_load_explicit(&rm->index, memory_order_relaxed);
+	atomic_store_explicit(&rm->index, ix, memory_order_release);
+	old->retired = rm->retired;
+	rm->retired  = old;
+	return true;
+}
+
+// makes sure the next insert keeps live+tomb entries under 3/4 of the table
+static bool index_reserve(ResManager* rm)
+{
+	ResIndex* ix = atomic_load_explicit(&rm->index, memory_order_relaxed);
+	return (ix->used + 1) * 4 <= (ix->mask + 1) * 3 || index_rebuild(rm);
+}
+
+static void index_remove(ResManager* rm, uint64_t hash, Resource* r)
+{
+	ResIndex* ix = atomic_load_explicit(&rm->index, memory_order_relaxed);
+	const int mask = ix->mask;
+	int i = (int)hash & mask;
+	for (; atomic_load_explicit(&ix->entries[i].res, memory_order_relaxed) != r; i = (i + 1) & mask)
+		assert(ix->entries[i].res && "index_remove(): resource not indexed");
+	atomic_store_explicit(&ix->entries[i].res, INDEX_TOMB, memory_order_release);
+}
+
+// frees replaced indices once there are no lock-free readers that could see them
+static void index_free_retired(ResManager* rm, bool force)
+{
+	if (!force && atomic_load(&rm->readers) != 0)
+		return;
+	while (rm->retired) {
+		ResIndex* next = rm->retired->retired;
+		free(rm->retired);
+		rm->retired = next;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Path intern table: raw relativePath string -> ResKey and normalized path.
+//// Repeated loads of the same path skip normalization and key hashing.
+//// Same write-once scheme as the index, but entries are never removed and
+//// grown tables are only freed in res_manager_destroy().
+
+typedef struct ResPath
+{
+	uint64_t rawHash; // fnv64 of the raw relative path
+	int      rawLen;  // length of the raw relative path
+	ResKey   key;     // key of the normalized full path
+	char*    path;    // normalized full path, stored after raw
+	char     raw[];   // raw relative path
+} ResPath;
+
+typedef struct ResPathTable
+{
+	int mask; // capacity-1, capacity is a power of 2
+	int used; // number of interned paths
+	struct ResPathTable* retired; // previous, smaller table
+	_Atomic(ResPath*) entries[];
+} ResPathTable;
+
+static ResPathTable* paths_create(int size)
+{
+	ResPathTable* t = calloc(1, sizeof(ResPathTable) + size*sizeof(ResPath*));
+	if (t) t->mask = size - 1;
+	return t;
+}
+
+static const ResPath* paths_find(ResPathTable* t, uint64_t rawHash, const char* raw, int rawLen)
+{
+	for (int i = (int)rawHash & t->mask; ; i = (i + 1) & t->mask) {
+		ResPath* p = atomic_load_explicit(&t->entries[i], memory_order_acquire);
+		if (!p) return NULL; // table is never full, so this terminates
+		if (p->rawHash == rawHash && p->rawLen == rawLen && !memcmp(p->raw, raw, rawLen))
+			return p;
+	}
+}
+
+static void paths_put(ResPathTable* t, ResPath* p)
+{
+	int i = (int)p->rawHash & t->mask;
+	while (atomic_load_explicit(&t->entries[i], memory_order_relaxed))
+		i = (i + 1) & t->mask;
+	atomic_store_explicit(&t->entries[i], p, memory_order_release);
+	++t->used;
+}
+
+// makes room for one more path, must hold the lock
+static ResPathTable* paths_reserve(ResManager* rm)
+{
+	ResPathTable* t = atomic_load_explicit(&rm->paths, memory_order_relaxed);
+	if ((t->used + 1) * 4 <= (t->mask + 1) * 3)
+		return t;
+	ResPathTable* bigger = paths_create((t->mask + 1) * 2);
+	if (!bigger) return NULL;
+	for (int i = 0; i <= t->mask; ++i) {
+		ResPath* p = atomic_load_explicit(&t->entries[i], memory_order_relaxed);
+		if (p) paths_put(bigger, p);
+	}
+	bigger->retired = t;
+	atomic_store_explicit(&rm->paths, bigger, memory_order_release);
+	return bigger;
+}
+
+static void paths_destroy(ResManager* rm)
+{
+	ResPathTable* t = atomic_load(&rm->paths);
+	for (int i = 0; t && i <= t->mask; ++i)
+		free(atomic_load_explicit(&t->entries[i], memory_order_relaxed));
+	while (t) {
+		ResPathTable* retired = t->retired;
+		free(t);
+		t = retired;
+	}
+}
+
+// @return Interned key and normalized path of relativePath, NULL if invalid
+static const ResPath* intern_path(ResManager* rm, const char* relativePath)
+{
+	const int rawLen = (int)strlen(relativePath);
+	const uint64_t rawHash = fnv64(relativePath, rawLen);
+	const ResPath* found = paths_find(atomic_load_explicit(&rm->paths, memory_order_acquire), 
+	                                  rawHash, relativePath, rawLen);
+	if (found) return found;
+
+	char path[260];
+	ResKey key;
+	if (!init_key(&key, normalized_datapath(path, relativePath)))
+		return NULL;
+
+	mutex_lock(&rm->lock);
+	ResPathTable* t = atomic_load_explicit(&rm->paths, memory_order_relaxed);
+	if (!(found = paths_find(t, rawHash, relativePath, rawLen)) && (t = paths_reserve(rm))) {
+		ResPath* p = malloc(sizeof(ResPath) + rawLen + 1 + key.hlen + 1);
+		if (p) {
+			p->rawHash = rawHash;
+			p->rawLen  = rawLen;
+			p->key     = key;
+			p->path    = p->raw + rawLen + 1;
+			memcpy(p->raw, relativePath, rawLen + 1);
+			memcpy(p->path, path, key.hlen + 1);
+			paths_put(t, p);
+			found = p;
+		}
+	}
+	mutex_unlock(&rm->lock);
+	return found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Content index: contentHash -> ready payload owner, for ResManager::dedupe.
+//// Guarded by the lock. Removed entries are tombstoned and the table is
+//// rebuilt once live+tomb entries reach 3/4 of it.
+
+typedef struct ResContentEntry
+{
+	uint64_t  hash; // Resource::contentHash
+	Resource* res;  // NULL if empty, INDEX_TOMB if removed
+} ResContentEntry;
+
+typedef struct ResContents
+{
+	int mask; // capacity-1, capacity is a power of 2
+	int used; // number of live + tombstone entries
+	int live; // number of live entries
+	ResContentEntry entries[];
+} ResContents;
+
+// owners of a hashed, ready payload are indexed, aliases and failed loads aren't
+static bool content_indexed(const Resource* r)
+{
+	return r->contentSize >= 0 && !r->alias;
+}
+
+static void contents_put(ResContents* t, uint64_t hash, Resource* r)
+{
+	int i = (int)hash & t->mask;
+	while (t->entries[i].res)
+		i = (i + 1) & t->mask;
+	t->entries[i].hash = hash;
+	t->entries[i].res  = r;
+	++t->used, ++t->live;
+}
+
+// indexes a ready owner, must hold the lock
+static void contents_add(ResManager* rm, Resource* r)
+{
+	ResContents* t = rm->contents;
+	if (!t || (t->used + 1) * 4 > (t->mask + 1) * 3) {
+		int size = 16;
+		while (size < ((t ? t->live : 0) + 1) * 2) size <<= 1;
+		ResContents* bigger = calloc(1, sizeof(ResContents) + size*sizeof(ResContentEntry));
+		if (!bigger) return; // only costs a missed dedupe
+		bigger->mask = size - 1;
+		for (int i = 0; t && i <= t->mask; ++i)
+			if (t->entries[i].res && t->entries[i].res != INDEX_TOMB)
+				contents_put(bigger, t->entries[i].hash, t->entries[i].res);
+		free(t);
+		rm->contents = t = bigger;
+	}
+	contents_put(t, r->contentHash, r);
+}
+
+// unindexes an owner before its payload or content hash goes away, must hold the lock
+static void contents_remove(ResManager* rm, Resource* r)
+{
+	ResContents* t = rm->contents;
+	if (!t || !content_indexed(r)) return;
+	for (int i = (int)r->contentHash & t->mask; t->entries[i].res; i = (i + 1) & t->mask) {
+		if (t->entries[i].res == r) {
+			t->entries[i].res = INDEX_TOMB;
+			--t->live;
+			return;
+		}
+	}
+}
+
+// finds a ready owner with identical contents, must hold the lock
+static Resource* find_content(ResManager* rm, const Resource* r)
+{
+	ResContents* t = rm->contents;
+	if (!t) return NULL;
+	for (int i = (int)r->contentHash & t->mask; t->entries[i].res; i = (i + 1) & t->mask) {
+		Resource* e = t->entries[i].res;
+		if (e != INDEX_TOMB && e != r && t->entries[i].hash == r->contentHash && 
+		    e->contentSize == r->contentSize && resource_ready(e))
+			return e;
+	}
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// pops the first slot of the free list, -1 if there are no free slots
+static int pop_free_slot(ResManager* rm)
+{
+	const int slot = rm->freeHead;
+	if (slot != -1)
+		rm->freeHead = resmgr_at(rm, slot)->link;
+	return slot;
+}
+
+static void push_free_slot(ResManager* rm, Resource* r)
+{
+	r->link = rm->freeHead;
+	rm->freeHead = r->slot;
+}
+
+// adds a new slab of items; existing slabs are never moved or copied
+static bool add_slab(ResManager* rm)
+{
+	const int slabSize = resmgr_slab_size(rm);
+	const int capacity = rm->capacity + slabSize;
+	if (capacity > RES_MAX_SLOTS)
+		return false; // slot index would overflow resource handles
+
+	ResSlabs* dir = atomic_load_explicit(&rm->slabs, memory_order_relaxed);
+	if (!dir || rm->numSlabs == dir->maxSlabs) {
+		int maxSlabs = dir ? dir->maxSlabs * 2 : 4;
+		ResSlabs* bigger = calloc(1, sizeof(ResSlabs) + maxSlabs*sizeof(char*));
+		if (!bigger) return false;
+		bigger->maxSlabs = maxSlabs;
+		bigger->retired  = dir;
+		if (dir) memcpy(bigger->slabs, dir->slabs, rm->numSlabs * sizeof(char*));
+		atomic_store_explicit(&rm->slabs, bigger, memory_order_release);
+		dir = bigger;
+	}
+	uint64_t* keys = realloc(rm->keys, capacity * sizeof(uint64_t));
+	if (!keys) return false;
+	rm->keys = keys;
+	int* alive = realloc(rm->alive, capacity * sizeof(int));
+	if (!alive) return false;
+	rm->alive = alive;
+
+	char* slab = malloc(slabSize * rm->sizeOf);
+	if (!slab) return false;
+	for (int i = 0; i < slabSize; ++i) {
+		Resource* r = (Resource*)(slab + i*rm->sizeOf);
+		atomic_init(&r->refcount, -1);
+		atomic_init(&r->lastUsed, 0);
+		atomic_init(&r->lastFrame, 0);
+		r->hlen       = 0; // hlen 0 means uninitialized
+		r->slot       = rm->capacity + i;
+		r->generation = 1;
+	}
+	dir->slabs[rm->numSlabs++] = slab;
+	memset(keys + rm->capacity, 0, slabSize * sizeof(uint64_t));
+	rm->capacity = capacity;
+	for (int i = slabSize - 1; i >= 0; --i) // lowest slot ends up first
+		push_free_slot(rm, (Resource*)(slab + i*rm->sizeOf));
+
+	// keep the index at least 2x capacity, so probes stay short
+	ResIndex* ix = atomic_load_explicit(&rm->index, memory_order_relaxed);
+	return ix->mask + 1 >= capacity * 2 || index_rebuild(rm);
+}
+
+// adds or removes the byte cost of a ready resource from the manager totals
+static void account_bytes(ResManager* rm, const Resource* r, bool add)
+{
+	if (add) {
+		atomic_fetch_add(&rm->cpuBytes, (size_t)r->cpuBytes);
+		atomic_fetch_add(&rm->gpuBytes, (size_t)r->gpuBytes);
+	} else {
+		atomic_fetch_sub(&rm->cpuBytes, (size_t)r->cpuBytes);
+		atomic_fetch_sub(&rm->gpuBytes, (size_t)r->gpuBytes);
+	}
+}
+
+// frees a ready payload, aliases only drop their reference to the shared one
+static void release_payload(ResManager* rm, Resource* r)
+{
+	if (r->alias) {
+		resource_free(r->alias);
+		r->alias = NULL;
+	}
+	else rm->free(r);
+}
+
+static void free_slot(ResManager* rm, Resource* r, int slot)
+{
+	index_remove(rm, keys_at(rm, slot), r);
+	keys_at(rm, slot) = 0;
+	r->hlen = 0; // hlen=0 - this marks the slot as free
+	next_generation(r); // invalidates all outstanding handles
+	if (atomic_load(&r->state) == RES_READY) {
+		account_bytes(rm, r, false);
+		contents_remove(rm, r);
+		release_payload(rm, r); // failed loads have already cleaned up after themselves
+	}
+
+	const int last = rm->alive[--rm->count]; // swap-remove from the dense alive array
+	rm->alive[r->link] = last;
+	resmgr_at(rm, last)->link = r->link;
+	push_free_slot(rm, r);
+}
+
+// tries to grab a reference without locking, fails on cached or dying items
+static bool try_acquire(Resource* r)
+{
+	int refs = atomic_load_explicit(&r->refcount, memory_order_relaxed);
+	while (refs > 0)
+		if (atomic_compare_exchange_weak(&r->refcount, &refs, refs + 1))
+			return true;
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Content dedupe: with ResManager::dedupe the file is hashed before ReadFunc runs,
+//// and a path whose contents match a ready resource shares that resource's payload
+//// (GL objects included) instead of reading and uploading it again.
+
+// hashes the file of a fresh slot and references a resident duplicate, if any
+static Resource* find_duplicate(ResManager* rm, Resource* r, const char* path, bool locked)
+{
+	r->contentSize = -1;
+	if (!rm->dedupe || !vfs_hash(path, &r->contentHash, &r->contentSize))
+		return NULL;
+	if (!locked) mutex_lock(&rm->lock);
+	Resource* e = find_content(rm, r);
+	if (e) atomic_fetch_add(&e->refcount, 1); // also revives cached items
+	if (!locked) mutex_unlock(&rm->lock);
+	return e;
+}
+
+// shares the payload of the referenced duplicate e, on the GL thread
+static void alias_payload(ResManager* rm, Resource* r, Resource* e)
+{
+	memcpy((char*)r + sizeof(Resource), (char*)e + sizeof(Resource), rm->sizeOf - sizeof(Resource));
+	r->alias    = e;
+	r->cpuBytes = 0; // the bytes are only counted once, by the owner
+	r->gpuBytes = 0;
+	atomic_fetch_add_explicit(&rm->dedupes, 1, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Async loading: the worker pool runs ReadFunc, then the job is queued for
+//// res_manager_pump() to run LoadFunc on the GL thread.
+
+typedef struct ResLoadJob
+{
+	ResManager* rm;
+	Resource*   res;
+	Resource*   alias; // referenced resource with identical contents, skips Read/LoadFunc
+	const char* path;  // interned normalized full path
+} ResLoadJob;
+
+// ReadFunc and LoadFunc durations both add up to Resource::loadTime
+static bool timed_read(ResManager* rm, Resource* r, const char* path)
+{
+	const double start = timer_now();
+	bool ok = rm->read(r, path);
+	r->loadTime += (float)(timer_now() - start);
+	return ok;
+}
+static bool timed_load(ResManager* rm, Resource* r, const char* path)
+{
+	const double start = timer_now();
+	bool ok = rm->load(r, path);
+	r->loadTime += (float)(timer_now() - start);
+	return ok;
+}
+
+// runs read + load for a fresh slot on the calling thread
+static bool load_now(ResManager* rm, Resource* r, const char* path)
+{
+	if (rm->read && !timed_read(rm, r, path))
+		return false;
+	if (timed_load(rm, r, path))
+		return true;
+	if (rm->read) rm->free(r); // release whatever ReadFunc decoded
+	return false;
+}
+
+static int load_time_bucket(float seconds)
+{
+	int bucket = 0;
+	for (float ms = seconds * 1000.0f; ms >= 1.0f && bucket < RES_LOAD_BUCKETS-1; ms *= 0.5f)
+		++bucket;
+	return bucket;
+}
+
+static void count_load(ResManager* rm, const Resource* r, bool ok)
+{
+	if (ok) {
+		atomic_fetch_add_explicit(&rm->loads, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&rm->loadHistogram[load_time_bucket(r->loadTime)], 1, memory_order_relaxed);
+	}
+	else atomic_fetch_add_explicit(&rm->failures, 1, memory_order_relaxed);
+}
+
+static void finish_load(Resource* r, bool ok)
+{
+	ResManager* rm = r->mgr;
+	if (ok && rm->dedupe && content_indexed(r)) {
+		mutex_lock(&rm->lock);
+		contents_add(rm, r);
+		mutex_unlock(&rm->lock);
+	}
+	if (ok) account_bytes(r->mgr, r, true);
+	count_load(r->mgr, r, ok);
+	atomic_store_explicit(&r->state, ok ? RES_READY : RES_FAILED, memory_order_release);
+}
+
+static bool free_unused_slot(ResManager* rm, Resource* r, int slot);
+
+// unindexes an unreferenced failed resource, so the next load retries the file
+static void drop_failed(ResManager* rm, Resource* r)
+{
+	mutex_lock(&rm->lock);
+	if (r->hlen && atomic_load(&r->state) == RES_FAILED)
+		free_unused_slot(rm, r, r->slot); // fails if someone grabbed a reference meanwhile
+	mutex_unlock(&rm->lock);
+}
+
+// marks an async load as failed, dropping it right away if every reference is already gone
+static void fail_load(Resource* r)
+{
+	finish_load(r, false);
+	atomic_thread_fence(memory_order_seq_cst); // pairs with the last resource_free()
+	if (atomic_load(&r->refcount) == 0)
+		drop_failed(r->mgr, r);
+}
+
+// runs on a pool worker, or on the loading thread when there is no pool or no ReadFunc
+static void read_job(ResLoadJob* job)
+{
+	ResManager* rm = job->rm;
+	job->alias = find_duplicate(rm, job->res, job->path, false);
+	if (job->alias || !rm->read || timed_read(rm, job->res, job->path)) {
+		mutex_lock(&rm->lock);
+		pvector_append(&rm->finalize, job);
+		mutex_unlock(&rm->lock);
+	} else {
+		fail_load(job->res);
+		free(job);
+	}
+	atomic_fetch_sub(&rm->inflight, 1);
+}
+
+static ResLoadJob* pop_finalize_job(ResManager* rm)
+{
+	ResLoadJob* job = NULL;
+	mutex_lock(&rm->lock);
+	if (rm->finalize.size) {
+		job = pvector_at(&rm->finalize, ResLoadJob, 0);
+		pvector_erase(&rm->finalize, 0);
+	}
+	mutex_unlock(&rm->lock);
+	return job;
+}
+
+int res_manager_pump(ResManager* rm, double timeBudget)
+{
+	const double deadline = timer_now() + timeBudget;
+	int finalized = 0;
+	ResLoadJob* job;
+	while ((job = pop_finalize_job(rm))) {
+		Resource* r = job->res;
+		if (job->alias && job->alias->contentHash != r->contentHash) {
+			resource_free(job->alias); // the original was reloaded meanwhile, read our own copy
+			job->alias = NULL;
+			if (!timed_read(rm, r, job->path)) {
+				fail_load(r);
+				free(job);
+				continue;
+			}
+		}
+		bool ok = true;
+		if (job->alias) alias_payload(rm, r, job->alias);
+		else if (!(ok = timed_load(rm, r, job->path)) && rm->read) rm->free(r);
+		if (ok) finish_load(r, true);
+		else    fail_load(r);
+		free(job);
+		++finalized;
+		if (timer_now() >= deadline)
+			break;
+	}
+	return finalized;
+}
+
+// waits for async reads and drops queued finalizers, must hold no lock
+static void cancel_async_loads(ResManager* rm)
+{
+	while (atomic_load(&rm->inflight) > 0)
+		sleep_ms(1);
+	ResLoadJob* job;
+	while ((job = pop_finalize_job(rm))) {
+		if (job->alias) resource_free(job->alias);
+		else if (rm->read) rm->free(job->res); // without a ReadFunc nothing was decoded yet
+		finish_load(job->res, false);
+		free(job);
+	}
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
-ResManager* res_manager_create(const char* name, int maxCount, int sizeOf, 
-	ResMgr_LoadFunc loadFunc, ResMgr_FreeFunc freeFunc)
+ResManager* res_manager_create(const char* name, int slabSize, int sizeOf, 
+	ResMgr_ReadFunc readFunc, ResMgr_LoadFunc loadFunc, ResMgr_FreeFunc freeFunc)
 {
 	assert(sizeOf > sizeof(Resource) && 
 		"resmgr_init(): sizeOf not larger than sizeof(Resource)! "
 		"Items must extend struct Resource for bookkeeping");
-	const int extraBytes = maxCount * (sizeof(uint64_t) + sizeOf);
-	const int totalBytes = sizeof(ResManager) + extraBytes;
-	ResManager* rm = malloc(totalBytes);
-	if (!rm) {
-		LOG("resmgr_init(): failed to allocate manager '%s' of size %d bytes\n", name, totalBytes);
+	int slabShift = 0;
+	while ((1 << slabShift) < slabSize) ++slabShift;
+	ResManager*   rm    = calloc(1, sizeof(ResManager));
+	ResIndex*     ix    = index_create(2 << slabShift);
+	ResPathTable* paths = paths_create(64);
+	if (!rm || !ix || !paths) {
+		LOG("resmgr_init(): failed to allocate manager '%s'\n", name);
+		free(rm), free(ix), free(paths);
+		return NULL;
+	}
+	for (int id = 1; id < RES_MAX_MANAGERS && !rm->id; ++id) {
+		ResManager* unused = NULL;
+		if (atomic_compare_exchange_strong(&res_managers[id], &unused, rm))
+			rm->id = id;
+	}
+	if (!rm->id) {
+		LOG("resmgr_init(): more than %d managers, can't create '%s'\n", RES_MAX_MANAGERS-1, name);
+		free(rm), free(ix), free(paths);
 		return NULL;
 	}
-	rm->count    = 0;
-	rm->sizeOf   = sizeOf;
-	rm->maxCount = maxCount;
-	rm->load     = loadFunc;
-	rm->free     = freeFunc;
+	rm->sizeOf    = sizeOf;
+	rm->slabShift = slabShift;
+	rm->read      = readFunc;
+	rm->load      = loadFunc;
+	rm->free      = freeFunc;
 	strncpy(rm->name, name, sizeof(rm->name));
-
-	// default init keys:
-	memset(keys_begin(rm), 0, sizeof(uint64_t) * maxCount);
-	// default init values:
-	Resource* r = resmgr_begin(rm);
-	for (int i = 0; i < maxCount; ++i, r = resmgr_next(rm, r, sizeOf))
-		r->hlen = 0; // hlen 0 means uninitialized
+	atomic_init(&rm->index, ix);
+	atomic_init(&rm->paths, paths);
+	atomic_init(&rm->readers, 0);
+	atomic_init(&rm->inflight, 0);
+	rm->freeHead = -1;
+	pvector_create(&rm->finalize);
+	mutex_init(&rm->lock);
 	return rm;
 }
 void res_manager_destroy(ResManager* rm)
 {
 	res_manager_destroy_all_items(rm);
+	atomic_store(&res_managers[rm->id], NULL);
+	ResSlabs* dir = atomic_load(&rm->slabs);
+	for (int i = 0; i < rm->numSlabs; ++i)
+		free(dir->slabs[i]);
+	while (dir) {
+		ResSlabs* retired = dir->retired;
+		free(dir);
+		dir = retired;
+	}
+	free(rm->keys);
+	free(rm->alive);
+	paths_destroy(rm);
+	free(rm->contents);
+	index_free_retired(rm, true);
+	free(atomic_load(&rm->index));
+	pvector_destroy(&rm->finalize);
+	mutex_destroy(&rm->lock);
 	free(rm);
 }
 
 Resource* res_manager_data(ResManager* rm)
 {
-	return (Resource*)((char*)rm + sizeof(ResManager));
+	return rm->numSlabs ? (Resource*)resmgr_slabs(rm)->slabs[0] : NULL;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// TODO: make resource management thread safe (atomic refcounts?)
+// finds and references an already loaded or pending resource
+static Resource* find_loaded(ResManager* rm, const ResKey* key, bool* locked)
+{
+	// lock-free fast path for resources that are already referenced
+	atomic_fetch_add(&rm->readers, 1);
+	Resource* r = index_find(atomic_load_explicit(&rm->index, memory_order_acquire), key);
+	bool hit = r && try_acquire(r);
+	atomic_fetch_sub(&rm->readers, 1);
+	if (hit) {
+		if (key_matches(r, key)) {
+			atomic_fetch_add_explicit(&rm->hits, 1, memory_order_relaxed);
+			touch(r);
+			return r;
+		}
+		resource_free(r); // slot was recycled under our feet, retry with the lock
+	}
+
+	mutex_lock(&rm->lock);
+	*locked = true;
+	if ((r = index_find(atomic_load_explicit(&rm->index, memory_order_relaxed), key))) {
+		if (atomic_load(&r->state) == RES_FAILED && free_unused_slot(rm, r, r->slot))
+			r = NULL; // nobody references the failed load anymore, retry the file
+		else {
+			atomic_fetch_add(&r->refcount, 1); // also revives cached items
+			touch(r);
+		}
+	}
+	atomic_fetch_add_explicit(r ? &rm->hits : &rm->misses, 1, memory_order_relaxed);
+	return r;
+}
+
+// reserves a free slot for a new resource, must hold the lock
+static Resource* reserve_slot(ResManager* rm, const char* path, int* slot)
+{
+	if ((rm->count == rm->capacity && !add_slab(rm)) || !index_reserve(rm)) {
+		LOG("resource_load(): failed to grow '%s'! Failed to load '%s'\n", rm->name, path);
+		return NULL;
+	}
+	*slot = pop_free_slot(rm);
+	Resource* r = resmgr_at(rm, *slot);
+	r->cpuBytes    = 0;
+	r->gpuBytes    = 0;
+	r->loadTime    = 0.0f;
+	r->contentSize = -1;
+	r->alias       = NULL;
+	return r;
+}
+
+// publishes a reserved slot in the index, must hold the lock
+static void insert_slot(ResManager* rm, Resource* r, int slot, const ResKey* key, 
+                        const char* path, ResState state)
+{
+	r->mgr    = rm;
+	r->hash   = key->hash;
+	r->hlen   = key->hlen;
+	r->fphlen = key->fphlen;
+	r->fphash = key->fphash;
+	r->path   = path; // interned, lives as long as the manager
+	touch(r);
+	atomic_store_explicit(&r->state, state, memory_order_relaxed);
+	atomic_store_explicit(&r->refcount, 1, memory_order_release);
+	index_put(atomic_load_explicit(&rm->index, memory_order_relaxed), key, r);
+	if (state == RES_READY) {
+		account_bytes(rm, r, true);
+		count_load(rm, r, true);
+	}
+	keys_at(rm, slot) = key->hash;
+	r->link = rm->count;
+	rm->alive[rm->count++] = slot;
+}
+
 Resource* resource_load(ResManager* rm, const char* relativePath)
 {
-	char path[260];
 	assert(strlen(relativePath) < 260-6 && "resource_load(): relativePath too long");
-	uint64_t hash, fphash;
-	int fphlen = 0;
-	int hlen = init_hash(&hash, normalized_datapath(path, relativePath));
-	if (!hlen) {
+	const ResPath* p = intern_path(rm, relativePath);
+	if (!p) {
 		LOG("resource_load(): invalid relativePath '%s'\n", relativePath);
 		return NULL;
 	}
+	const char* path = p->path;
 
-	int count = rm->count;
-	int ifree = count;
-	uint64_t* keys = keys_begin(rm);
-	for (int i = 0; i < count; ++i) {
-		uint64_t key = keys[i];
-		if (!key) {
-			ifree = i; continue;
-		}
-		if (key != hash) continue;
-		Resource* r = resmgr_at(rm, i);
-		if (r->hlen != hlen) continue;
-
-		if (!fphlen) fphlen = init_hash(&fphash, filepart(path, hlen));
-		if (r->fphlen == fphlen && r->fphash == fphash) {
-			++r->refcount;
-			return r; // we have a pretty solid match
-		}
+	bool locked = false;
+	Resource* r = find_loaded(rm, &p->key, &locked);
+	if (r) {
+		if (locked) mutex_unlock(&rm->lock);
+		while (resource_state(r) == RES_PENDING) // finish it here, we can't return it pending
+			if (!res_manager_pump(rm, 0.0)) sleep_ms(1);
+		if (resource_ready(r))
+			return r;
+		resource_free(r);
+		return NULL;
 	}
-	if (count == rm->maxCount) {
-		LOG("resource_load(): out of item slots! Failed to load '%s'\n", path);
+
+	// publish a pending slot and load it unlocked, loads of the same path wait for it in the pump
+	int slot;
+	if ((r = reserve_slot(rm, path, &slot)))
+		insert_slot(rm, r, slot, &p->key, path, RES_PENDING);
+	mutex_unlock(&rm->lock);
+	if (!r) return NULL;
+
+	Resource* e = find_duplicate(rm, r, path, false);
+	if (e) alias_payload(rm, r, e);
+	const bool ok = e || load_now(rm, r, path);
+	finish_load(r, ok);
+	if (ok) return r;
+	resource_free(r); // the last reference unindexes the failed load
+	return NULL;
+}
+
+Resource* resource_load_async(ResManager* rm, const char* relativePath)
+{
+	assert(strlen(relativePath) < 260-6 && "resource_load_async(): relativePath too long");
+	const ResPath* p = intern_path(rm, relativePath);
+	if (!p) {
+		LOG("resource_load_async(): invalid relativePath '%s'\n", relativePath);
 		return NULL;
 	}
 
-	Resource* r = resmgr_at(rm, ifree);
-	if (rm->load(r, path)) {
-		keys_at(rm, ifree) = hash;
-		r->refcount = 1;
-		r->mgr    = rm;
-		r->hlen   = hlen;
-		r->fphlen = fphlen ? fphlen : init_hash(&fphash, filepart(path, hlen));
-		r->fphash = fphash;
-		r->path   = indebug(strdup(path)) inrelease(NULL);
-		++rm->count;
-		return r;
+	ResLoadJob* job = NULL;
+	bool locked = false;
+	Resource* r = find_loaded(rm, &p->key, &locked);
+	if (!r) {
+		int slot;
+		if ((job = malloc(sizeof(ResLoadJob))) && (r = reserve_slot(rm, p->path, &slot))) {
+			insert_slot(rm, r, slot, &p->key, p->path, RES_PENDING);
+			job->rm    = rm;
+			job->res   = r;
+			job->alias = NULL;
+			job->path  = p->path;
+			atomic_fetch_add(&rm->inflight, 1);
+			mutex_unlock(&rm->lock); // reads and hashes files, like synchronous misses
+			if (rm->read && rm->pool)
+				taskpool_run(rm->pool, (TaskFunc)&read_job, job);
+			else
+				read_job(job); // no pool, only the GL part is deferred
+			return r;
+		}
+	}
+	if (locked) mutex_unlock(&rm->lock);
+	free(job);
+	return r;
+}
+
+ResState resource_state(const Resource* res)
+{
+	return (ResState)atomic_load_explicit(&((Resource*)res)->state, memory_order_acquire);
+}
+
+bool resource_ready(const Resource* res)
+{
+	return resource_state(res) == RES_READY;
+}
+
+ResHandle resource_handle(const Resource* res)
+{
+	if (!res) return 0;
+	return (ResHandle)res->mgr->id << (RES_HANDLE_SLOT_BITS + RES_HANDLE_GEN_BITS)
+	     | (ResHandle)res->generation << RES_HANDLE_SLOT_BITS
+	     | (ResHandle)res->slot;
+}
+
+Resource* resource_resolve(ResHandle handle)
+{
+	if (!handle) return NULL;
+	ResManager* rm = atomic_load_explicit(&res_managers[handle_mgr(handle)], memory_order_acquire);
+	if (rm) {
+		const int slot = handle_slot(handle);
+		ResSlabs* dir  = resmgr_slabs(rm);
+		const int si   = slot >> rm->slabShift;
+		if (dir && si < dir->maxSlabs && dir->slabs[si]) {
+			Resource* r = (Resource*)(dir->slabs[si] + rm->sizeOf*(slot & (resmgr_slab_size(rm) - 1)));
+			if (r->generation == handle_gen(handle)) {
+				touch(r);
+				return r;
+			}
+		}
 	}
+	indebug(LOG("resource_resolve(): stale handle %016llx (manager %d slot %d gen %u)\n", 
+		(unsigned long long)handle, handle_mgr(handle), handle_slot(handle), handle_gen(handle)));
+	assert(!"resource_resolve(): stale resource handle");
 	return NULL;
 }
 
+void resource_free_handle(ResHandle handle)
+{
+	Resource* r = resource_resolve(handle);
+	if (r) resource_free(r);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void resource_free(Resource* item)
@@ -124,45 +949,337 @@ void resource_free(Resource* item)
 	// respawned during the next frame
 	// res_manager_clean_unused() should be called periodically to remove
 	// unused resources
-	--item->refcount;
-	assert(item->refcount >= 0 && "resource_free(): refcount negative, too many frees!");
+	ResManager* rm = item->mgr; // read before our reference is gone and the slot can be reused
+	int refs = atomic_fetch_sub(&item->refcount, 1);
+	assert(refs > 0 && "resource_free(): refcount negative, too many frees!");
+	if (refs == 1) {
+		unsigned now = atomic_fetch_add_explicit(&rm->useClock, 1, memory_order_relaxed);
+		atomic_store_explicit(&item->lastUsed, now + 1, memory_order_relaxed);
+		// failed loads hold no payload worth caching, unindex them so the file is retried
+		if (atomic_load(&item->state) == RES_FAILED)
+			drop_failed(rm, item);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool resource_reload(Resource* res)
+{
+	ResManager* rm = res->mgr;
+	const ResState state = resource_state(res);
+	if (state == RES_PENDING)
+		return false; // pending loads will read the new file anyway
+
+	// load into a scratch copy, so the callbacks see the usual Resource header
+	Resource* tmp = malloc(rm->sizeOf);
+	if (!tmp) return false;
+	memcpy(tmp, res, rm->sizeOf);
+	tmp->cpuBytes    = 0;
+	tmp->gpuBytes    = 0;
+	tmp->loadTime    = 0.0f;
+	tmp->contentSize = -1;
+	if (rm->dedupe && !vfs_hash(res->path, &tmp->contentHash, &tmp->contentSize))
+		tmp->contentSize = -1;
+	if (!load_now(rm, tmp, res->path)) {
+		LOG("resource_reload(): failed to reload '%s', keeping the old version\n", res->path);
+		free(tmp);
+		return false;
+	}
+
+	// swap in the new payload, the header keeps its slot, generation and refcount
+	mutex_lock(&rm->lock);
+	Resource* heir = NULL; // aliases keep the old contents, the first one inherits the old payload
+	if (state == RES_READY) {
+		account_bytes(rm, res, false);
+		contents_remove(rm, res);
+	}
+	for (int i = 0; i < rm->count && state == RES_READY; ++i) {
+		Resource* a = resmgr_at(rm, rm->alive[i]);
+		if (a->alias != res) continue;
+		if (!heir) {
+			heir = a;
+			heir->alias    = NULL;
+			heir->cpuBytes = res->cpuBytes;
+			heir->gpuBytes = res->gpuBytes;
+			account_bytes(rm, heir, true);
+			contents_add(rm, heir);
+		} else {
+			a->alias = heir;
+			atomic_fetch_add(&heir->refcount, 1);
+		}
+		resource_free(res);
+	}
+	if (!heir && state == RES_READY) release_payload(rm, res);
+	memcpy((char*)res + sizeof(Resource), (char*)tmp + sizeof(Resource), rm->sizeOf - sizeof(Resource));
+	res->cpuBytes    = tmp->cpuBytes;
+	res->gpuBytes    = tmp->gpuBytes;
+	res->loadTime    = tmp->loadTime;
+	res->contentHash = tmp->contentHash;
+	res->contentSize = tmp->contentSize;
+	account_bytes(rm, res, true);
+	if (rm->dedupe && content_indexed(res)) contents_add(rm, res);
+	if (state == RES_FAILED) { // a fixed file brings a failed resource back to life
+		count_load(rm, res, true);
+		atomic_store_explicit(&res->state, RES_READY, memory_order_release);
+	}
+	mutex_unlock(&rm->lock);
+	free(tmp);
+	return true;
+}
+
+bool res_manager_reload_path(ResManager* rm, const char* fullPath)
+{
+	ResKey key;
+	if (!init_key(&key, fullPath))
+		return false;
+
+	mutex_lock(&rm->lock); // hold a reference, so it can't be evicted while reloading
+	Resource* r = index_find(atomic_load_explicit(&rm->index, memory_order_relaxed), &key);
+	if (r) atomic_fetch_add(&r->refcount, 1);
+	mutex_unlock(&rm->lock);
+	if (!r) return false;
+
+	bool reloaded = resource_reload(r);
+	resource_free(r);
+	return reloaded;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //// Nasty optimized code follows:
 
-void res_manager_clean_unused(ResManager* rm)
+typedef struct ResLRU { unsigned lastUsed; int slot; } ResLRU;
+
+static int lru_compare(const void* a, const void* b)
 {
-	int count  = rm->count;
-	int sizeOf = rm->sizeOf;
-	Resource* r = resmgr_begin(rm);
-	for (; count > 0; r = resmgr_next(rm, r, sizeOf)) {
-		if (!r->hlen || r->refcount > 0)
-			continue;
-		assert(r < resmgr_end(rm) && "res_manager_clean_unused(): resource buffer overflow");
-		r->hlen = 0; // hlen=0 - this marks the slot as free
-		rm->free(r);
-		--rm->count;
-		indebug(free(r->path));
-		--count;
+	unsigned ua = ((const ResLRU*)a)->lastUsed, ub = ((const ResLRU*)b)->lastUsed;
+	return ua < ub ? -1 : ua > ub;
+}
+
+static size_t resident_bytes(ResManager* rm)
+{
+	return atomic_load_explicit(&rm->cpuBytes, memory_order_relaxed)
+	     + atomic_load_explicit(&rm->gpuBytes, memory_order_relaxed);
+}
+
+// frees an unused slot unless someone revived it, must hold the lock
+static bool free_unused_slot(ResManager* rm, Resource* r, int slot)
+{
+	int unused = 0; // mark as dying, so lock-free lookups can't revive it
+	if (!atomic_compare_exchange_strong(&r->refcount, &unused, -1))
+		return false;
+	free_slot(rm, r, slot);
+	return true;
+}
+
+static bool evict_slot(ResManager* rm, Resource* r, int slot)
+{
+	if (!free_unused_slot(rm, r, slot))
+		return false;
+	atomic_fetch_add_explicit(&rm->evictions, 1, memory_order_relaxed);
+	return true;
+}
+
+int res_manager_clean_unused(ResManager* rm)
+{
+	mutex_lock(&rm->lock);
+	index_free_retired(rm, false); // also while under budget, where nothing else frees them
+	if (rm->budget && resident_bytes(rm) <= rm->budget) {
+		mutex_unlock(&rm->lock);
+		return 0; // everything fits, keep unused items cached
 	}
+
+	int evicted = 0;
+	ResLRU* lru = rm->budget ? malloc(sizeof(ResLRU) * (rm->count + 1)) : NULL;
+	int numUnused = 0;
+	for (int i = rm->count - 1; i >= 0; --i) { // backwards, evicting swaps the last item into i
+		const int slot = rm->alive[i];
+		Resource* r = resmgr_at(rm, slot);
+		if (atomic_load(&r->state) == RES_PENDING || atomic_load(&r->refcount) != 0)
+			continue; // in use, or a worker may still be writing into it
+		if (!rm->budget) // no budget, free all unused right away
+			evicted += evict_slot(rm, r, slot);
+		else if (lru) {
+			lru[numUnused].lastUsed = atomic_load_explicit(&r->lastUsed, memory_order_relaxed);
+			lru[numUnused++].slot   = slot;
+		}
+	}
+	if (numUnused) {
+		qsort(lru, numUnused, sizeof(ResLRU), lru_compare);
+		for (int i = 0; i < numUnused && resident_bytes(rm) > rm->budget; ++i)
+			evicted += evict_slot(rm, resmgr_at(rm, lru[i].slot), lru[i].slot);
+	}
+	free(lru);
+	mutex_unlock(&rm->lock);
+	return evicted;
 }
 
 void res_manager_destroy_all_items(ResManager* rm)
 {
-	int count  = rm->count;
-	int sizeOf = rm->sizeOf;
-	Resource* r = resmgr_begin(rm);
-	for (; count > 0; r = resmgr_next(rm, r, sizeOf)) {
-		if (!r->hlen)
-			continue;
-		assert(r < resmgr_end(rm) && "res_manager_destroy_all_items(): resource buffer overflow");
+	cancel_async_loads(rm);
+	mutex_lock(&rm->lock);
+	for (int i = 0; i < rm->count; ++i) {
+		Resource* r = resmgr_at(rm, rm->alive[i]);
+		atomic_store(&r->refcount, -1);
 		r->hlen = 0; // hlen=0 - this marks the slot as free
-		rm->free(r);
-		indebug(free(r->path));
-		--count;
+		next_generation(r);
+		if (atomic_load(&r->state) == RES_READY) {
+			account_bytes(rm, r, false);
+			if (!r->alias) rm->free(r); // the shared payload is freed by its owner
+			r->alias = NULL;
+		}
+		push_free_slot(rm, r);
 	}
 	rm->count = 0;
+	free(rm->contents);
+	rm->contents = NULL;
+	if (rm->keys) memset(rm->keys, 0, sizeof(uint64_t) * rm->capacity);
+	index_rebuild(rm);
+	mutex_unlock(&rm->lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Instrumentation
+
+void resource_next_frame(void)
+{
+	atomic_fetch_add_explicit(&res_frame, 1, memory_order_relaxed);
+}
+
+unsigned resource_frame(void)
+{
+	return atomic_load_explicit(&res_frame, memory_order_relaxed);
+}
+
+void res_manager_stats(ResManager* rm, ResManagerStats* out)
+{
+	memcpy(out->name, rm->name, sizeof(out->name));
+	mutex_lock(&rm->lock);
+	out->count    = rm->count;
+	out->capacity = rm->capacity;
+	out->dedupedBytes = 0;
+	for (int i = 0; i < rm->count; ++i) {
+		const Resource* r = resmgr_at(rm, rm->alive[i]);
+		if (r->alias && resource_ready(r))
+			out->dedupedBytes += (size_t)r->alias->cpuBytes + r->alias->gpuBytes;
+	}
+	mutex_unlock(&rm->lock);
+	out->loads     = atomic_load_explicit(&rm->loads,     memory_order_relaxed);
+	out->failures  = atomic_load_explicit(&rm->failures,  memory_order_relaxed);
+	out->hits      = atomic_load_explicit(&rm->hits,      memory_order_relaxed);
+	out->misses    = atomic_load_explicit(&rm->misses,    memory_order_relaxed);
+	out->evictions = atomic_load_explicit(&rm->evictions, memory_order_relaxed);
+	out->dedupes   = atomic_load_explicit(&rm->dedupes,   memory_order_relaxed);
+	out->cpuBytes  = atomic_load_explicit(&rm->cpuBytes,  memory_order_relaxed);
+	out->gpuBytes  = atomic_load_explicit(&rm->gpuBytes,  memory_order_relaxed);
+	out->budget    = rm->budget;
+	for (int i = 0; i < RES_LOAD_BUCKETS; ++i)
+		out->loadHistogram[i] = atomic_load_explicit(&rm->loadHistogram[i], memory_order_relaxed);
+}
+
+static int stats_compare(const void* a, const void* b)
+{
+	const ResStats* sa = a;
+	const ResStats* sb = b;
+	int64_t bytesA = (int64_t)sa->cpuBytes + sa->gpuBytes;
+	int64_t bytesB = (int64_t)sb->cpuBytes + sb->gpuBytes;
+	return bytesA > bytesB ? -1 : bytesA < bytesB;
 }
 
-////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
+int res_manager_resource_stats(ResManager* rm, ResStats* out, int maxStats)
+{
+	mutex_lock(&rm->lock);
+	int n = 0;
+	for (int i = 0; i < rm->count && n < maxStats; ++i) {
+		const Resource* r = resmgr_at(rm, rm->alive[i]);
+		ResStats* s  = &out[n++];
+		s->path      = r->path;
+		s->state     = resource_state(r);
+		s->refcount  = atomic_load_explicit(&((Resource*)r)->refcount, memory_order_relaxed);
+		s->cpuBytes  = s->state == RES_READY ? r->cpuBytes : 0;
+		s->gpuBytes  = s->state == RES_READY ? r->gpuBytes : 0;
+		s->lastFrame = atomic_load_explicit(&((Resource*)r)->lastFrame, memory_order_relaxed);
+		s->loadTime  = s->state == RES_PENDING ? 0.0f : r->loadTime;
+		s->aliasOf   = s->state == RES_READY && r->alias ? r->alias->path : NULL;
+	}
+	mutex_unlock(&rm->lock);
+	qsort(out, n, sizeof(ResStats), stats_compare);
+	return n;
+}
+
+static const char* state_name(ResState state)
+{
+	switch (state) {
+		case RES_PENDING: return "pending";
+		case RES_READY:   return "ready";
+		case RES_FAILED:  return "failed";
+	}
+	return "invalid";
+}
+
+// writes a JSON string literal, paths only need quotes and backslashes escaped
+static void json_string(FILE* out, const char* str)
+{
+	fputc('"', out);
+	for (const char* p = str ? str : ""; *p; ++p) {
+		if (*p == '"' || *p == '\\') fputc('\\', out);
+		if ((unsigned char)*p >= 0x20) fputc(*p, out);
+	}
+	fputc('"', out);
+}
+
+void res_manager_dump(ResManager* rm, FILE* out, bool json)
+{
+	ResManagerStats ms;
+	res_manager_stats(rm, &ms);
+	const int maxStats = ms.count + 16; // items may be added while we're not holding the lock
+	ResStats* rs = malloc(sizeof(ResStats) * maxStats);
+	const int n  = rs ? res_manager_resource_stats(rm, rs, maxStats) : 0;
+	const unsigned frame = resource_frame();
+
+	if (json) {
+		fprintf(out, "{\"name\":");
+		json_string(out, ms.name);
+		fprintf(out, ",\"frame\":%u,\"count\":%d,\"capacity\":%d,\"loads\":%d,\"failures\":%d"
+			",\"hits\":%d,\"misses\":%d,\"evictions\":%d,\"dedupes\":%d,\"dedupedBytes\":%zu"
+			",\"cpuBytes\":%zu,\"gpuBytes\":%zu,\"budget\":%zu,\"loadHistogramMs\":[", frame, 
+			ms.count, ms.capacity, ms.loads, ms.failures, ms.hits, ms.misses, ms.evictions, 
+			ms.dedupes, ms.dedupedBytes, ms.cpuBytes, ms.gpuBytes, ms.budget);
+		for (int i = 0; i < RES_LOAD_BUCKETS; ++i)
+			fprintf(out, i ? ",%d" : "%d", ms.loadHistogram[i]);
+		fprintf(out, "],\"resources\":[");
+		for (int i = 0; i < n; ++i) {
+			fprintf(out, i ? ",{\"path\":" : "{\"path\":");
+			json_string(out, rs[i].path);
+			fprintf(out, ",\"state\":\"%s\",\"refcount\":%d,\"cpuBytes\":%d,\"gpuBytes\":%d"
+				",\"lastFrame\":%u,\"loadMs\":%.3f", state_name(rs[i].state), rs[i].refcount, 
+				rs[i].cpuBytes, rs[i].gpuBytes, rs[i].lastFrame, rs[i].loadTime * 1000.0f);
+			if (rs[i].aliasOf) {
+				fprintf(out, ",\"aliasOf\":");
+				json_string(out, rs[i].aliasOf);
+			}
+			fputc('}', out);
+		}
+		fprintf(out, "]}\n");
+	}
+	else {
+		fprintf(out, "%s: %d/%d items, %d loads, %d failed, %d hits, %d misses, %d evictions\n", 
+			ms.name, ms.count, ms.capacity, ms.loads, ms.failures, ms.hits, ms.misses, ms.evictions);
+		fprintf(out, "  resident: cpu %zuKB gpu %zuKB, budget %zuKB, %d dedupes saving %zuKB\n", 
+			ms.cpuBytes / 1024, ms.gpuBytes / 1024, ms.budget / 1024, ms.dedupes, ms.dedupedBytes / 1024);
+		fprintf(out, "  load time histogram:");
+		for (int i = 0; i < RES_LOAD_BUCKETS; ++i)
+			if (ms.loadHistogram[i])
+				fprintf(out, i == RES_LOAD_BUCKETS-1 ? " >=%dms:%d" : " <%dms:%d", 
+					i == RES_LOAD_BUCKETS-1 ? 1 << (i-1) : 1 << i, ms.loadHistogram[i]);
+		fprintf(out, "\n  %-8s %4s %10s %10s %8s %9s  %s\n", 
+			"state", "refs", "cpuKB", "gpuKB", "idle", "loadMs", "path");
+		for (int i = 0; i < n; ++i)
+			fprintf(out, "  %-8s %4d %10d %10d %8u %9.2f  %s%s%s\n", state_name(rs[i].state), 
+				rs[i].refcount, rs[i].cpuBytes / 1024, rs[i].gpuBytes / 1024, 
+				frame - rs[i].lastFrame, rs[i].loadTime * 1000.0f, rs[i].path ? rs[i].path : "",
+				rs[i].aliasOf ? " -> " : "", rs[i].aliasOf ? rs[i].aliasOf : "");
+	}
+	free(rs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -6,6 +6,8 @@
 #include <string.h>
 #include <malloc.h>   // alloca
 #include <stdarg.h>   // va_begin
+#include "vfs.h"      // vfs_open
+#include "delete_queue.h" // dq_delete_program
 
 #ifndef GL_INVALID_FRAMEBUFFER_OPERATION
 #define GL_INVALID_FRAMEBUFFER_OPERATION 0x0506
@@ -84,22 +86,14 @@ static GLuint compileShader(const char* shMem, int size, const char* idstr, GLen
 }
 static GLuint compileShaderFile(const char* shFile, time_t* modified, GLenum type)
 {
-	FILE* f = fopen(shFile, "rb");
-	if (!f) {
+	vfs_file f;
+	if (!vfs_open(&f, shFile)) {
 		fprintf(stderr, "shader_load(): failed to load file '%s'\n", shFile);
 		return 0;
 	}
-
-	struct stat s; fstat(fileno(f), &s);
-	*modified   = s.st_mtime;
-	size_t size = s.st_size;
-
-	char* shMem = (char*)(size <= 65536 ? alloca(size) : malloc(size));
-	fread(shMem, size, 1, f);
-	fclose(f);
-
-	GLuint shader = compileShader(shMem, size, shFile, type);
-	if (size > 65536) free(shMem);
+	*modified = f.modified;
+	GLuint shader = compileShader(f.data, f.size, shFile, type);
+	vfs_close(&f);
 	return shader;
 }
 
@@ -119,7 +113,7 @@ static Shader* shader_init_unmanaged(Shader* s, const char* shaderName)
 
 static void shader_free_unmanaged(Shader* s)
 {
-	if (s->program) glDeleteProgram(s->program);
+	dq_delete_program(s->program);
 }
 
 static bool shader_load_unmanaged(Shader* s, const char* shaderName)
@@ -167,14 +161,11 @@ bool shader_reload(Shader* s)
 	return status;
 }
 
-static time_t time_modified(const char* file) {
-	struct stat st;
-	return stat(file, &st) == 0 ? st.st_mtime : 0;
-}
 bool shader_hotload(Shader* s)
 {
-	if (time_modified(s->vs_path) != s->vs_mod) return shader_reload(s);
-	if (time_modified(s->fs_path) != s->fs_mod) return shader_reload(s);
+	// packed shaders report the pack's time, so only loose files ever stat
+	if (vfs_modified(s->vs_path) != s->vs_mod) return shader_reload(s);
+	if (vfs_modified(s->fs_path) != s->fs_mod) return shader_reload(s);
 	return false;
 }
 
@@ -275,11 +266,11 @@ void shader_unbind_attributes(const Shader* s)
 ////////////////////////////////////////////////////////////////////////////////
 
 // initializes a resource manager for ShaderManager Shader objects
-ShaderManager* shader_manager_create(int maxCount) {
+ShaderManager* shader_manager_create(int slabSize) {
 	static int id = 0;
-	char name[32]; snprintf(name, 32, "shader_manager_$%d_[%d]", id++, maxCount);
-	return (ShaderManager*)res_manager_create(name, maxCount, sizeof(Shader), 
-		(ResMgr_LoadFunc)shader_load_unmanaged, (ResMgr_FreeFunc)shader_free_unmanaged);
+	char name[32]; snprintf(name, 32, "shader_manager_$%d_[%d]", id++, slabSize);
+	return (ShaderManager*)res_manager_create(name, slabSize, sizeof(Shader), 
+		NULL, (ResMgr_LoadFunc)shader_load_unmanaged, (ResMgr_FreeFunc)shader_free_unmanaged);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
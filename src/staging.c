@@ -0,0 +1,102 @@
+#include "staging.h"
+#include <GL/glew.h>
+#include <string.h> // memcpy
+#include "util.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+static struct
+{
+	GLuint buffer;  // staging ring, 0 until the first upload
+	char*  mapped;  // persistent write mapping of buffer
+	GLsync fences[STAGING_NUM_CHUNKS]; // GPU copies still reading each chunk, or NULL
+	int    next;    // next chunk to fill
+	bool   failed;  // no ring available, chunks go through glBufferSubData
+	staging_stats stats;
+} ring;
+
+static bool ring_init(void)
+{
+	if (!GLEW_ARB_buffer_storage)
+		return false;
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &ring.buffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+	glBufferStorage(GL_COPY_READ_BUFFER, STAGING_RING_SIZE, NULL, flags);
+	ring.mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, STAGING_RING_SIZE, flags);
+	if (!ring.mapped) {
+		LOG("staging_upload(): failed to map the staging ring, using glBufferSubData\n");
+		glDeleteBuffers(1, &ring.buffer);
+		ring.buffer = 0;
+		return false;
+	}
+	ring.stats.mapped = true;
+	return true;
+}
+
+// waits until the GPU copy reading the chunk has finished
+static void wait_chunk(int chunk)
+{
+	GLsync fence = ring.fences[chunk];
+	if (!fence) return;
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		++ring.stats.stalls;
+		do status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+		while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	ring.fences[chunk] = NULL;
+}
+
+void staging_upload(unsigned buffer, int offset, const void* data, int size)
+{
+	if (!ring.buffer && !ring.failed)
+		ring.failed = !ring_init();
+
+	const char* src = (const char*)data;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (ring.failed) { // still chunked, so the driver never stages the whole upload at once
+		for (int done = 0; done < size; done += STAGING_CHUNK_SIZE) {
+			const int n = size - done < STAGING_CHUNK_SIZE ? size - done : STAGING_CHUNK_SIZE;
+			glBufferSubData(GL_COPY_WRITE_BUFFER, offset + done, n, src + done);
+			++ring.stats.chunks;
+		}
+	} else {
+		glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+		for (int done = 0; done < size; done += STAGING_CHUNK_SIZE) {
+			const int n = size - done < STAGING_CHUNK_SIZE ? size - done : STAGING_CHUNK_SIZE;
+			const int chunk = ring.next;
+			ring.next = (chunk + 1) % STAGING_NUM_CHUNKS;
+			wait_chunk(chunk);
+			// reading a mapped file here overlaps its disk I/O with the copies queued before
+			memcpy(ring.mapped + chunk * STAGING_CHUNK_SIZE, src + done, n);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			                    chunk * STAGING_CHUNK_SIZE, offset + done, n);
+			ring.fences[chunk] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			++ring.stats.chunks;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	ring.stats.bytes += size;
+}
+
+void staging_stats_get(staging_stats* out)
+{
+	*out = ring.stats;
+}
+
+void staging_shutdown(void)
+{
+	if (!ring.buffer) return;
+	for (int i = 0; i < STAGING_NUM_CHUNKS; ++i)
+		wait_chunk(i);
+	glBindBuffer(GL_COPY_READ_BUFFER, ring.buffer);
+	glUnmapBuffer(GL_COPY_READ_BUFFER);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glDeleteBuffers(1, &ring.buffer);
+	memset(&ring, 0, sizeof(ring));
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,95 @@
+#include "taskpool.h"
+#include <stdlib.h>
+#include "util.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void taskpool_worker(taskpool* p)
+{
+	mutex_lock(&p->lock);
+	for (;;) {
+		if (p->head < p->queue.size) {
+			task t = vector_at(&p->queue, task, p->head);
+			if (++p->head == p->queue.size) // queue drained, reuse the buffer
+				p->head = 0, vector_clear(&p->queue);
+			++p->active;
+			mutex_unlock(&p->lock);
+			t.func(t.arg);
+			mutex_lock(&p->lock);
+			if (--p->active == 0 && p->head == p->queue.size)
+				condvar_broadcast(&p->idle);
+		}
+		else if (p->quit) break;
+		else condvar_wait(&p->wake, &p->lock);
+	}
+	mutex_unlock(&p->lock);
+}
+
+taskpool* taskpool_create(int numThreads)
+{
+	if (numThreads < 1) numThreads = 1;
+	taskpool* p = malloc(sizeof(*p));
+	p->threads  = malloc(sizeof(thread) * numThreads);
+	mutex_init(&p->lock);
+	condvar_init(&p->wake);
+	condvar_init(&p->idle);
+	vector_create(&p->queue, sizeof(task));
+	p->head       = 0;
+	p->active     = 0;
+	p->quit       = false;
+	p->numThreads = 0;
+	for (int i = 0; i < numThreads; ++i) {
+		if (!thread_start(&p->threads[i], (ThreadFunc)&taskpool_worker, p)) {
+			LOG("taskpool_create(): failed to start worker %d/%d\n", i+1, numThreads);
+			break;
+		}
+		++p->numThreads;
+	}
+	return p;
+}
+
+void taskpool_destroy(taskpool* p)
+{
+	mutex_lock(&p->lock);
+	p->quit = true;
+	condvar_broadcast(&p->wake);
+	mutex_unlock(&p->lock);
+
+	for (int i = 0; i < p->numThreads; ++i)
+		thread_join(&p->threads[i]);
+
+	// no workers could be started, so run leftovers on the calling thread
+	for (; p->head < p->queue.size; ++p->head) {
+		task* t = &vector_at(&p->queue, task, p->head);
+		t->func(t->arg);
+	}
+	vector_destroy(&p->queue);
+	condvar_destroy(&p->idle);
+	condvar_destroy(&p->wake);
+	mutex_destroy(&p->lock);
+	free(p->threads);
+	free(p);
+}
+
+void taskpool_run(taskpool* p, TaskFunc func, void* arg)
+{
+	if (!p->numThreads) { // degrade to synchronous execution
+		func(arg);
+		return;
+	}
+	task t = { func, arg };
+	mutex_lock(&p->lock);
+	vector_append(&p->queue, &t);
+	condvar_signal(&p->wake);
+	mutex_unlock(&p->lock);
+}
+
+void taskpool_wait(taskpool* p)
+{
+	mutex_lock(&p->lock);
+	while (p->head < p->queue.size || p->active)
+		condvar_wait(&p->idle, &p->lock);
+	mutex_unlock(&p->lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,112 @@
+#include "thread.h"
+#include <stdlib.h> // malloc
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h> // SRWLOCK, CONDITION_VARIABLE, CreateThread
+#else
+	#include <unistd.h>  // sysconf
+#endif
+
+// thread entry point trampoline, since OS thread signatures differ from ThreadFunc
+typedef struct thread_start_args
+{
+	ThreadFunc func;
+	void* arg;
+} thread_start_args;
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+
+	void mutex_init(mutex* m)    { InitializeSRWLock((PSRWLOCK)&m->handle); }
+	void mutex_destroy(mutex* m) { (void)m; /* SRW locks have no destructor */ }
+	void mutex_lock(mutex* m)    { AcquireSRWLockExclusive((PSRWLOCK)&m->handle); }
+	void mutex_unlock(mutex* m)  { ReleaseSRWLockExclusive((PSRWLOCK)&m->handle); }
+
+	void condvar_init(condvar* c)      { InitializeConditionVariable((PCONDITION_VARIABLE)&c->handle); }
+	void condvar_destroy(condvar* c)   { (void)c; /* condition variables have no destructor */ }
+	void condvar_signal(condvar* c)    { WakeConditionVariable((PCONDITION_VARIABLE)&c->handle); }
+	void condvar_broadcast(condvar* c) { WakeAllConditionVariable((PCONDITION_VARIABLE)&c->handle); }
+	void condvar_wait(condvar* c, mutex* m)
+	{
+		SleepConditionVariableSRW((PCONDITION_VARIABLE)&c->handle, (PSRWLOCK)&m->handle, INFINITE, 0);
+	}
+
+	static DWORD WINAPI thread_main(void* ptr)
+	{
+		thread_start_args args = *(thread_start_args*)ptr;
+		free(ptr);
+		args.func(args.arg);
+		return 0;
+	}
+	bool thread_start(thread* t, ThreadFunc func, void* arg)
+	{
+		thread_start_args* args = malloc(sizeof(*args));
+		if (!args) return false;
+		args->func = func;
+		args->arg  = arg;
+		if ((t->handle = CreateThread(NULL, 0, &thread_main, args, 0, NULL)))
+			return true;
+		free(args);
+		return false;
+	}
+	void thread_join(thread* t)
+	{
+		WaitForSingleObject(t->handle, INFINITE);
+		CloseHandle(t->handle);
+		t->handle = NULL;
+	}
+	int thread_cpu_count(void)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+	}
+
+#else
+
+	void mutex_init(mutex* m)    { pthread_mutex_init(&m->handle, NULL); }
+	void mutex_destroy(mutex* m) { pthread_mutex_destroy(&m->handle); }
+	void mutex_lock(mutex* m)    { pthread_mutex_lock(&m->handle); }
+	void mutex_unlock(mutex* m)  { pthread_mutex_unlock(&m->handle); }
+
+	void condvar_init(condvar* c)      { pthread_cond_init(&c->handle, NULL); }
+	void condvar_destroy(condvar* c)   { pthread_cond_destroy(&c->handle); }
+	void condvar_signal(condvar* c)    { pthread_cond_signal(&c->handle); }
+	void condvar_broadcast(condvar* c) { pthread_cond_broadcast(&c->handle); }
+	void condvar_wait(condvar* c, mutex* m)
+	{
+		pthread_cond_wait(&c->handle, &m->handle);
+	}
+
+	static void* thread_main(void* ptr)
+	{
+		thread_start_args args = *(thread_start_args*)ptr;
+		free(ptr);
+		args.func(args.arg);
+		return NULL;
+	}
+	bool thread_start(thread* t, ThreadFunc func, void* arg)
+	{
+		thread_start_args* args = malloc(sizeof(*args));
+		if (!args) return false;
+		args->func = func;
+		args->arg  = arg;
+		if (pthread_create(&t->handle, NULL, &thread_main, args) == 0)
+			return true;
+		free(args);
+		return false;
+	}
+	void thread_join(thread* t)
+	{
+		pthread_join(t->handle, NULL);
+	}
+	int thread_cpu_count(void)
+	{
+		const long n = sysconf(_SC_NPROCESSORS_ONLN);
+		return n > 0 ? (int)n : 1;
+	}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
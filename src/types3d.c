@@ -1,6 +1,11 @@
 #include "types3d.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <stddef.h> // size_t
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+	#include <emmintrin.h> // SSE2 bounds reductions
+	#define BOUNDS_SSE 1
+#endif
 
 #define retvec2(x,y)     vec2 _r = {x,y};     return _r
 #define retvec3(x,y,z)   vec3 _r = {x,y,z};   return _r
@@ -292,3 +297,198 @@ mat4* mat4_from_scale(mat4* m, vec3 sc)
 	m->m30 = 0.0f, m->m31 = 0.0f, m->m32 = 0.0f, m->m33 = 1.0f;
 	return m;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef union f32bits { float f; unsigned u; } f32bits;
+
+unsigned short half_from_float(float f)
+{
+	f32bits v = { f };
+	const unsigned sign = (v.u >> 16) & 0x8000;
+	v.u &= 0x7fffffff;
+	if (v.u >= 0x47800000) // too big for a half: inf, or nan if it was nan
+		return (unsigned short)(sign | (v.u > 0x7f800000 ? 0x7e00 : 0x7c00));
+	if (v.u < 0x38800000) { // denormal half: let the FPU align and round the mantissa
+		v.f += 0.5f;
+		return (unsigned short)(sign | (v.u - 0x3f000000));
+	}
+	const unsigned mantOdd = (v.u >> 13) & 1;
+	v.u += 0xc8000fff + mantOdd; // rebias the exponent and round to nearest even
+	return (unsigned short)(sign | (v.u >> 13));
+}
+
+float half_to_float(unsigned short h)
+{
+	f32bits v;
+	v.u = (h & 0x7fffu) << 13;
+	const unsigned exp = v.u & (0x7c00u << 13);
+	v.u += (127 - 15) << 23; // rebias the exponent
+	if (exp == 0x7c00u << 13) // inf or nan
+		v.u += (128 - 16) << 23;
+	else if (exp == 0) { // zero or denormal, renormalize
+		v.u += 1 << 23;
+		v.f -= 6.10351562e-05f; // 2^-14
+	}
+	v.u |= (h & 0x8000u) << 16;
+	return v.f;
+}
+
+static float sign_not_zero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+vec2 oct_encode(vec3 n)
+{
+	const float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (l1 == 0.0f) { retvec2(0.0f, 0.0f); }
+	float x = n.x / l1, y = n.y / l1;
+	if (n.z < 0.0f) { // fold the lower hemisphere over the diagonals
+		const float fx = (1.0f - fabsf(y)) * sign_not_zero(x);
+		const float fy = (1.0f - fabsf(x)) * sign_not_zero(y);
+		x = fx, y = fy;
+	}
+	retvec2(x, y);
+}
+
+vec3 oct_decode(vec2 e)
+{
+	vec3 n = { e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y) };
+	if (n.z < 0.0f) {
+		const float x = n.x;
+		n.x = (1.0f - fabsf(n.y)) * sign_not_zero(x);
+		n.y = (1.0f - fabsf(x))   * sign_not_zero(n.y);
+	}
+	return vec3_norm(n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define POINT(T, points, stride, i) ((const T*)((const char*)(points) + (size_t)(i) * (stride)))
+
+static vec3 vec3_mid(vec3 a, vec3 b) { retvec3((a.x+b.x)*0.5f, (a.y+b.y)*0.5f, (a.z+b.z)*0.5f); }
+
+#if BOUNDS_SSE
+// @return Largest squared length among the xyz lanes, lane w must be 0
+static __m128 max_len_sq(__m128 maxSq, __m128 d)
+{
+	__m128 sq = _mm_mul_ps(d, d);
+	sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2,3,0,1)));
+	sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1,0,3,2)));
+	return _mm_max_ps(maxSq, sq);
+}
+#endif
+
+bounds3d bounds_from_points(const float* points, int count, int stride)
+{
+	bounds3d b = { 0 };
+	if (count <= 0) return b;
+	const float* last = POINT(float, points, stride, count - 1);
+#if BOUNDS_SSE
+	// 16-byte loads read one float past every point, so the last point is loaded as xyz0
+	const __m128 lastP = _mm_setr_ps(last[0], last[1], last[2], 0.0f);
+	__m128 lo = lastP, hi = lastP;
+	for (int i = 0; i < count - 1; ++i) {
+		const __m128 p = _mm_loadu_ps(POINT(float, points, stride, i));
+		lo = _mm_min_ps(lo, p);
+		hi = _mm_max_ps(hi, p);
+	}
+	float l[4], h[4];
+	_mm_storeu_ps(l, lo);
+	_mm_storeu_ps(h, hi);
+	b.min = (vec3){ l[0], l[1], l[2] };
+	b.max = (vec3){ h[0], h[1], h[2] };
+	b.center = vec3_mid(b.min, b.max);
+
+	const __m128 c    = _mm_setr_ps(b.center.x, b.center.y, b.center.z, 0.0f);
+	const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	__m128 maxSq = max_len_sq(_mm_setzero_ps(), _mm_sub_ps(lastP, c));
+	for (int i = 0; i < count - 1; ++i) {
+		const __m128 p = _mm_loadu_ps(POINT(float, points, stride, i));
+		maxSq = max_len_sq(maxSq, _mm_and_ps(_mm_sub_ps(p, c), mask));
+	}
+	b.radius = sqrtf(_mm_cvtss_f32(maxSq));
+#else
+	b.min = b.max = (vec3){ last[0], last[1], last[2] };
+	for (int i = 0; i < count - 1; ++i) {
+		const float* p = POINT(float, points, stride, i);
+		b.min.x = fminf(b.min.x, p[0]); b.max.x = fmaxf(b.max.x, p[0]);
+		b.min.y = fminf(b.min.y, p[1]); b.max.y = fmaxf(b.max.y, p[1]);
+		b.min.z = fminf(b.min.z, p[2]); b.max.z = fmaxf(b.max.z, p[2]);
+	}
+	b.center = vec3_mid(b.min, b.max);
+	float maxSq = 0.0f;
+	for (int i = 0; i < count; ++i) {
+		const float* p = POINT(float, points, stride, i);
+		const vec3 d = { p[0] - b.center.x, p[1] - b.center.y, p[2] - b.center.z };
+		maxSq = fmaxf(maxSq, vec3_dot(d, d));
+	}
+	b.radius = sqrtf(maxSq);
+#endif
+	return b;
+}
+
+bounds3d bounds_from_qpoints(const unsigned short* points, int count, int stride, vec3 min, vec3 max)
+{
+	bounds3d b = { min, max, vec3_mid(min, max), 0.0f };
+	if (count <= 0) return b;
+	const vec3 scale  = vec3_divf(vec3_sub(max, min), 65535.0f);
+	const vec3 offset = vec3_sub(min, b.center); // dequantized point relative to the center
+	const unsigned short* last = POINT(unsigned short, points, stride, count - 1);
+#if BOUNDS_SSE
+	// 8-byte loads read one u16 past every point, scale.w = 0 drops it; the last point is loaded as xyz0
+	const __m128  s    = _mm_setr_ps(scale.x, scale.y, scale.z, 0.0f);
+	const __m128  o    = _mm_setr_ps(offset.x, offset.y, offset.z, 0.0f);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lastQ = _mm_setr_epi32(last[0], last[1], last[2], 0);
+	__m128 maxSq = max_len_sq(_mm_setzero_ps(), _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lastQ), s), o));
+	for (int i = 0; i < count - 1; ++i) {
+		const __m128i q = _mm_unpacklo_epi16(
+			_mm_loadl_epi64((const __m128i*)POINT(unsigned short, points, stride, i)), zero);
+		maxSq = max_len_sq(maxSq, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(q), s), o));
+	}
+	b.radius = sqrtf(_mm_cvtss_f32(maxSq));
+#else
+	(void)last;
+	float maxSq = 0.0f;
+	for (int i = 0; i < count; ++i) {
+		const unsigned short* q = POINT(unsigned short, points, stride, i);
+		const vec3 d = { q[0] * scale.x + offset.x, q[1] * scale.y + offset.y, q[2] * scale.z + offset.z };
+		maxSq = fmaxf(maxSq, vec3_dot(d, d));
+	}
+	b.radius = sqrtf(maxSq);
+#endif
+	return b;
+}
+
+bounds3d bounds_transform(const bounds3d* b, const mat4* m)
+{
+	const vec3 c = vec3_mid(b->min, b->max);
+	const vec3 e = vec3_mulf(vec3_sub(b->max, b->min), 0.5f);
+	const vec3 cw = {
+		m->m00*c.x + m->m10*c.y + m->m20*c.z + m->m30,
+		m->m01*c.x + m->m11*c.y + m->m21*c.z + m->m31,
+		m->m02*c.x + m->m12*c.y + m->m22*c.z + m->m32,
+	};
+	const vec3 ew = {
+		fabsf(m->m00)*e.x + fabsf(m->m10)*e.y + fabsf(m->m20)*e.z,
+		fabsf(m->m01)*e.x + fabsf(m->m11)*e.y + fabsf(m->m21)*e.z,
+		fabsf(m->m02)*e.x + fabsf(m->m12)*e.y + fabsf(m->m22)*e.z,
+	};
+	// largest stretch of the 3x3 part: the longest axis for rotate * scale, but the longest
+	// output row for scale * rotate like actor_affine_matrix(), take whichever is larger
+	float maxSq = 0.0f;
+	for (int i = 0; i < 3; ++i) {
+		const float axis = m->m[i*4]*m->m[i*4] + m->m[i*4+1]*m->m[i*4+1] + m->m[i*4+2]*m->m[i*4+2];
+		const float row  = m->m[i]*m->m[i]     + m->m[4+i]*m->m[4+i]     + m->m[8+i]*m->m[8+i];
+		maxSq = fmaxf(maxSq, fmaxf(axis, row));
+	}
+	bounds3d r;
+	r.min    = vec3_sub(cw, ew);
+	r.max    = vec3_add(cw, ew);
+	r.center = (vec3){
+		m->m00*b->center.x + m->m10*b->center.y + m->m20*b->center.z + m->m30,
+		m->m01*b->center.x + m->m11*b->center.y + m->m21*b->center.z + m->m31,
+		m->m02*b->center.x + m->m12*b->center.y + m->m22*b->center.z + m->m32,
+	};
+	r.radius = b->radius * sqrtf(maxSq);
+	return r;
+}
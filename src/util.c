@@ -7,8 +7,10 @@
 	#include <sys/time.h>
 	#include <unistd.h> // usleep, getcwd
 #endif
-#include <stdlib.h>   // _fullpath
+#include <stdlib.h>   // malloc
 #include <string.h>   // memcmp
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <sys/stat.h> // fstat
 #include <GL/glfw3.h> // glfwGetTime
 
@@ -40,13 +42,160 @@
 		return hash;
 	}
 
+	// working directory with '/' separators, queried only once
+	static const char* cached_cwd(int* outLen)
+	{
+		static char cwd[512];
+		static int  cwdlen;
+		static atomic_int state; // 0: not queried, 1: querying, 2: ready
+		int expected = 0;
+		if (atomic_compare_exchange_strong(&state, &expected, 1)) {
+			if (!getcwd(cwd, sizeof(cwd))) cwd[0] = '\0';
+			for (char* p = cwd; *p; ++p) if (*p == '\\') *p = '/';
+			cwdlen = (int)strlen(cwd);
+			while (cwdlen > 1 && cwd[cwdlen-1] == '/') cwd[--cwdlen] = '\0';
+			atomic_store(&state, 2);
+		}
+		else while (atomic_load(&state) != 2)
+			sleep_ms(0);
+		*outLen = cwdlen;
+		return cwd;
+	}
+
+	static bool is_absolute(const char* path)
+	{
+		return path[0] == '/' || path[0] == '\\' || (path[0] && path[1] == ':');
+	}
+
+	// appends path components to out[len], resolving '.' and '..' lexically
+	// @param root Length of the absolute root prefix in out, '..' at the root is ignored
+	// @return New length of out, or -1 if '..' escapes a relative path (root == 0)
+	static int append_components(char* out, int len, int root, const char* path)
+	{
+		for (const char* p = path; *p; ) {
+			const char* end = p;
+			while (*end && *end != '/' && *end != '\\') ++end;
+			const int n = (int)(end - p);
+			if (n == 2 && p[0] == '.' && p[1] == '.') {
+				if (!root && !len) return -1;
+				while (len > root && out[len-1] != '/') --len; // pop the last component
+				if (len > root) --len; // and its separator
+			}
+			else if (n && !(n == 1 && p[0] == '.')) {
+				if (len + n + 2 > 512) return -1;
+				if (len > 0 && out[len-1] != '/') out[len++] = '/';
+				memcpy(out + len, p, n);
+				len += n;
+			}
+			p = *end ? end + 1 : end;
+		}
+		return len;
+	}
+
+	#define XXH_P1 11400714785074694791ull
+	#define XXH_P2 14029467366897019727ull
+	#define XXH_P3 1609587929392839161ull
+	#define XXH_P4 9650029242287828579ull
+	#define XXH_P5 2870177450012600261ull
+
+	static inline unsigned long long rotl64(unsigned long long x, int r) 
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+	static inline unsigned long long read64(const unsigned char* p)
+	{
+		unsigned long long v; memcpy(&v, p, 8); return v; // unaligned little-endian load
+	}
+	static inline unsigned int read32(const unsigned char* p)
+	{
+		unsigned int v; memcpy(&v, p, 4); return v;
+	}
+	static inline unsigned long long xxh_round(unsigned long long acc, unsigned long long input)
+	{
+		return rotl64(acc + input * XXH_P2, 31) * XXH_P1;
+	}
+	static inline unsigned long long xxh_merge(unsigned long long acc, unsigned long long val)
+	{
+		return (acc ^ xxh_round(0, val)) * XXH_P1 + XXH_P4;
+	}
+
+	unsigned long long xxhash64(const void* data, size_t length, unsigned long long seed)
+	{
+		const unsigned char* p   = (const unsigned char*)data;
+		const unsigned char* end = p + length;
+		unsigned long long h;
+		if (length >= 32) {
+			unsigned long long v1 = seed + XXH_P1 + XXH_P2;
+			unsigned long long v2 = seed + XXH_P2;
+			unsigned long long v3 = seed;
+			unsigned long long v4 = seed - XXH_P1;
+			for (const unsigned char* limit = end - 32; p <= limit; p += 32) {
+				v1 = xxh_round(v1, read64(p));
+				v2 = xxh_round(v2, read64(p + 8));
+				v3 = xxh_round(v3, read64(p + 16));
+				v4 = xxh_round(v4, read64(p + 24));
+			}
+			h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+			h = xxh_merge(h, v1);
+			h = xxh_merge(h, v2);
+			h = xxh_merge(h, v3);
+			h = xxh_merge(h, v4);
+		}
+		else h = seed + XXH_P5;
+
+		h += (unsigned long long)length;
+		for (; p + 8 <= end; p += 8)
+			h = rotl64(h ^ xxh_round(0, read64(p)), 27) * XXH_P1 + XXH_P4;
+		if (p + 4 <= end) {
+			h = rotl64(h ^ (read32(p) * XXH_P1), 23) * XXH_P2 + XXH_P3;
+			p += 4;
+		}
+		for (; p < end; ++p)
+			h = rotl64(h ^ (*p * XXH_P5), 11) * XXH_P1;
+
+		h ^= h >> 33; h *= XXH_P2;
+		h ^= h >> 29; h *= XXH_P3;
+		h ^= h >> 32;
+		return h;
+	}
+
 	char* normalize_path(char* dst, const char* relativePath)
 	{
-		char cwd[512]; getcwd(cwd, 512);
-		char buf[512]; _fullpath(buf, relativePath, 512);
-		int clen = strlen(cwd);
-		char* src = memcmp(buf, cwd, clen) == 0 ? buf + clen + 1 : buf;
-		return strcpy(dst, src);
+		char buf[512];
+		int len = 0;
+		if (!is_absolute(relativePath)) { // common case, no need for the cwd at all
+			len = append_components(buf, 0, 0, relativePath);
+			if (len >= 0) {
+				buf[len] = '\0';
+				return strcpy(dst, buf);
+			}
+		}
+
+		// absolute path or '..' escapes the working directory: resolve against cwd
+		int clen;
+		const char* cwd = cached_cwd(&clen);
+		int root = 0;
+		if (is_absolute(relativePath)) {
+			if (relativePath[1] == ':') { // keep the drive letter "C:/"
+				buf[0] = relativePath[0], buf[1] = ':', buf[2] = '/';
+				root = 3;
+				relativePath += 2;
+			}
+			else buf[0] = '/', root = 1;
+			len = root;
+		}
+		else { // the OS already gives us a canonical cwd
+			memcpy(buf, cwd, clen);
+			len  = clen;
+			root = (cwd[0] && cwd[1] == ':') ? 3 : 1;
+		}
+		len = append_components(buf, len, root, relativePath);
+		if (len < 0) len = root; // path is too long
+		buf[len] = '\0';
+
+		if (clen && len > clen && memcmp(buf, cwd, clen) == 0 && buf[clen] == '/')
+			return strcpy(dst, buf + clen + 1); // inside the working dir, make it relative
+		return strcpy(dst, buf);
 	}
 
 	char* normalized_datapath(char* dst, const char* relativePath)
@@ -66,6 +215,11 @@
 		return ptr;
 	}
 	
+	double timer_now(void)
+	{
+		return glfwGetTime();
+	}
+
 	double timer_elapsed_vsync(double desiredFPS)
 	{
 		static double start = 0.0;
@@ -3,7 +3,31 @@
 #include <assert.h>  // assert
 #include <stdlib.h>  // malloc
 #include <stdarg.h>  // va_list
+#include <stdint.h>  // intptr_t
+#include <string.h>  // memcmp
 #include "util.h"
+#include "delete_queue.h" // dq_delete_buffer
+#include "staging.h"      // staging_upload
+
+// GL component type, size and normalization of each VertexType
+static const struct vt_info {
+	GLenum        type;
+	unsigned char bytes;      // size of a single component
+	unsigned char normalized; // fixed point mapped to [0,1] or [-1,1]
+	unsigned char integer;    // bound with glVertexAttribIPointer
+} vt_infos[VT_MaxTypes] = {
+	[VT_FLOAT]   = { GL_FLOAT,          4, 0, 0 },
+	[VT_HALF]    = { GL_HALF_FLOAT,     2, 0, 0 },
+	[VT_UNORM16] = { GL_UNSIGNED_SHORT, 2, 1, 0 },
+	[VT_SNORM16] = { GL_SHORT,          2, 1, 0 },
+	[VT_UNORM8]  = { GL_UNSIGNED_BYTE,  1, 1, 0 },
+	[VT_SNORM8]  = { GL_BYTE,           1, 1, 0 },
+	[VT_UINT8]   = { GL_UNSIGNED_BYTE,  1, 0, 1 },
+	[VT_UINT16]  = { GL_UNSIGNED_SHORT, 2, 0, 1 },
+	[VT_INT16]   = { GL_SHORT,          2, 0, 1 },
+	[VT_UINT32]  = { GL_UNSIGNED_INT,   4, 0, 1 },
+	[VT_INT32]   = { GL_INT,            4, 0, 1 },
+};
 
 // validate correctness of vertex descr layout
 #if DEBUG
@@ -12,11 +36,13 @@ static void vd_validate(vertex_descr* vd)
 	int offset = 0;
 	for (int i = 0; offset < vd->sizeOf && i < 4; ++i) {
 		ShaderAttr a = (ShaderAttr)vd->items[i].attr; // attrib location
-		const int s  = (const int) vd->items[i].size; // attrib size in floats
+		const int s  = (const int) vd->items[i].size; // attrib size in components
+		const int t  = (const int) vd->items[i].type; // VertexType of components
 		assert(0 <= a && a < a_MaxAttributes && "Invalid attr: check vertex_descr!");
 		assert(1 <= s && s <= 4 && "Invalid attr size: check vertex_descr!");
-		assert(s <= (vd->sizeOf-offset)/(int)sizeof(float) && "Invalid layout: vertex_descr sizeOf doesn't match total attr sizes!");
-		offset += s * sizeof(float); // offset is in bytes
+		assert(0 <= t && t < VT_MaxTypes && "Invalid attr type: check vertex_descr!");
+		assert(s*vt_infos[t].bytes <= vd->sizeOf-offset && "Invalid layout: vertex_descr sizeOf doesn't match total attr sizes!");
+		offset += s * vt_infos[t].bytes; // offset is in bytes
 	}
 	assert(offset == vd->sizeOf && "Invalid layout: end offset does not match vertex_descr sizeOf!");
 }
@@ -24,7 +50,7 @@ static void vd_validate(vertex_descr* vd)
 
 vertex_descr vd_create(int sizeOf, ShaderAttr attr0, int size0, ...)
 {
-	vertex_descr vd = { sizeOf, attr0, size0};
+	vertex_descr vd = { sizeOf, {{attr0, size0}} };
 	va_list ap;	va_start(ap, size0);
 	
 	int offset = size0*sizeof(float);
@@ -37,6 +63,15 @@ vertex_descr vd_create(int sizeOf, ShaderAttr attr0, int size0, ...)
 	return vd;
 }
 
+// VAO currently bound, pool draws leave their VAO bound and skip rebinding it
+static GLuint boundArray;
+
+static void bind_array(GLuint arrayObj)
+{
+	if (boundArray != arrayObj)
+		glBindVertexArray(boundArray = arrayObj);
+}
+
 // By using a bound opengl VAO we record all the enabled attribute locations
 // with their respective array offsets during calls to
 // glEnableVertexAttribArray/glVertexAttribPointer 
@@ -44,13 +79,27 @@ static void vao_set_attributes(vertex_descr* vd)
 {
 	for (int i = 0, off = 0; off < vd->sizeOf; ++i) {
 		ShaderAttr a = (ShaderAttr)vd->items[i].attr; // attrib location
-		const int s  = (const int) vd->items[i].size; // attrib size in floats
-		glVertexAttribPointer(a, s, GL_FLOAT, 0, vd->sizeOf, (void*)off);
+		const int s  = (const int) vd->items[i].size; // attrib size in components
+		const struct vt_info* t = &vt_infos[vd->items[i].type];
+		if (t->integer) glVertexAttribIPointer(a, s, t->type, vd->sizeOf, (void*)(intptr_t)off);
+		else            glVertexAttribPointer(a, s, t->type, t->normalized, vd->sizeOf, (void*)(intptr_t)off);
 		glEnableVertexAttribArray(a);
-		off += s * sizeof(float); // offset is in bytes
+		off += s * t->bytes; // offset is in bytes
 	}
 }
 
+// allocates a static buffer bound to target and streams data into it in chunks,
+// instead of a single glBufferData that stages the whole copy inside the driver
+static GLuint new_static_buffer(GLenum target, const void* data, int size)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	glBufferData(target, size, NULL, GL_STATIC_DRAW);
+	staging_upload(buffer, 0, data, size);
+	return buffer;
+}
+
 vertex_array* va_new_array(const void* vertices, int numVerts, vertex_descr vd)
 {
 	indebug(vd_validate(&vd));
@@ -58,67 +107,293 @@ vertex_array* va_new_array(const void* vertices, int numVerts, vertex_descr vd)
 	v->indexBuf    = 0;
 	v->vertexCount = numVerts;
 	v->indexCount  = 0;
+	v->indexType   = 0;
 	v->descr       = vd;
 
 	glGenVertexArrays(1, &v->arrayObj);
-	glBindVertexArray(v->arrayObj);     // bind VAO to start recording
+	bind_array(v->arrayObj);     // bind VAO to start recording
 	{
 		// create & fill vertex buffer
-		glGenBuffers(1, &v->vertexBuf);
-		glBindBuffer(GL_ARRAY_BUFFER, v->vertexBuf);
-		glBufferData(GL_ARRAY_BUFFER, numVerts*vd.sizeOf, vertices, GL_STATIC_DRAW);
+		v->vertexBuf = new_static_buffer(GL_ARRAY_BUFFER, vertices, numVerts*vd.sizeOf);
 		// set VAO vertex attributes
 		vao_set_attributes(&vd);
 	}
-	glBindVertexArray(0);
+	bind_array(0);
 	return v;
 }
 
-vertex_array* va_new_indexed_array(const void* vptr, int vtxCnt, 
-                                   const index_t* iptr, int idxCnt, vertex_descr vd)
+static vertex_array* new_indexed_array(const void* vptr, int vtxCnt, const void* iptr, int idxCnt, 
+                                       GLenum indexType, int indexSize, vertex_descr vd)
 {
 	indebug(vd_validate(&vd));
 	vertex_array* v = malloc(sizeof(*v));
 	v->vertexCount = vtxCnt;
 	v->indexCount  = idxCnt;
+	v->indexType   = indexType;
 	v->descr       = vd;
 
 	glGenVertexArrays(1, &v->arrayObj);
-	glBindVertexArray(v->arrayObj);     // bind VAO to start recording
+	bind_array(v->arrayObj);     // bind VAO to start recording
 	{
 		// create and fill index buffer
-		glGenBuffers(1, &v->indexBuf);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, v->indexBuf);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, idxCnt*sizeof(*iptr), iptr, GL_STATIC_DRAW);
+		v->indexBuf = new_static_buffer(GL_ELEMENT_ARRAY_BUFFER, iptr, idxCnt*indexSize);
 		// create & fill vertex buffer
-		glGenBuffers(1, &v->vertexBuf);
-		glBindBuffer(GL_ARRAY_BUFFER, v->vertexBuf);
-		glBufferData(GL_ARRAY_BUFFER, vtxCnt*vd.sizeOf, vptr, GL_STATIC_DRAW);
+		v->vertexBuf = new_static_buffer(GL_ARRAY_BUFFER, vptr, vtxCnt*vd.sizeOf);
 		// set VAO vertex attributes
 		vao_set_attributes(&vd);
 	}
-	glBindVertexArray(0);
+	bind_array(0);
+	return v;
+}
+
+// 16-bit copy of the indices if every vertex fits, otherwise NULL
+static unsigned short* narrow_indices(const index_t* indices, int numIndices, int numVerts)
+{
+	if (numVerts > 65536) return NULL;
+	unsigned short* narrow = malloc(sizeof(unsigned short) * (numIndices + 1));
+	if (!narrow) return NULL;
+	for (int i = 0; i < numIndices; ++i)
+		narrow[i] = (unsigned short)indices[i];
+	return narrow;
+}
+
+vertex_array* va_new_indexed_array(const void* vptr, int vtxCnt, 
+                                   const index_t* iptr, int idxCnt, vertex_descr vd)
+{
+	unsigned short* narrow = narrow_indices(iptr, idxCnt, vtxCnt);
+	if (!narrow)
+		return new_indexed_array(vptr, vtxCnt, iptr, idxCnt, GL_UNSIGNED_INT, sizeof(index_t), vd);
+	vertex_array* v = new_indexed_array(vptr, vtxCnt, narrow, idxCnt, GL_UNSIGNED_SHORT, sizeof(unsigned short), vd);
+	free(narrow); // the upload has already copied it
 	return v;
 }
 
+int va_index_size(unsigned indexType)
+{
+	return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
 void va_destroy(vertex_array* va)
 {
-	if (va->vertexBuf) glDeleteBuffers(1, &va->vertexBuf),     va->vertexBuf = 0;
-	if (va->indexBuf)  glDeleteBuffers(1, &va->indexBuf),      va->indexBuf  = 0;
-	if (va->arrayObj)  glDeleteVertexArrays(1, &va->arrayObj), va->arrayObj  = 0;
+	// the GL objects are deleted in batches at the end of the frame
+	dq_delete_buffer(va->vertexBuf);      va->vertexBuf = 0;
+	dq_delete_buffer(va->indexBuf);       va->indexBuf  = 0;
+	dq_delete_vertex_array(va->arrayObj); va->arrayObj  = 0;
 	free(va);
 }
 
 void va_draw(vertex_array* va)
 {
-	glBindVertexArray(va->arrayObj);
+	bind_array(va->arrayObj);
 	if (va->indexBuf)
 	{
-		glDrawElements(GL_TRIANGLES, va->indexCount, GL_UNSIGNED_INT, 0);
+		glDrawElements(GL_TRIANGLES, va->indexCount, va->indexType, 0);
 	}
 	else
 	{
 		glDrawArrays(GL_TRIANGLES, 0, va->vertexCount);
 	}
-	glBindVertexArray(0);
+	bind_array(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define GP_MAX_POOLS    8
+#define GP_MIN_VERTS    (64 * 1024)  // initial vertex capacity
+#define GP_MIN_INDICES  (256 * 1024) // initial index capacity in bytes
+
+static geometry_pool* pools[GP_MAX_POOLS];
+
+// best fit, so large free ranges stay available for large meshes
+// @return Offset of the allocated range, -1 if no free range fits
+static int block_alloc(vector* blocks, int size)
+{
+	gp_block* b = vector_data(blocks, gp_block);
+	int best = -1;
+	for (int i = 0; i < blocks->size; ++i)
+		if (b[i].size >= size && (best < 0 || b[i].size < b[best].size))
+			best = i;
+	if (best < 0)
+		return -1;
+	const int offset = b[best].offset;
+	b[best].offset += size;
+	b[best].size   -= size;
+	if (b[best].size == 0)
+		vector_erase(blocks, best);
+	return offset;
+}
+
+static void block_free(vector* blocks, int offset, int size)
+{
+	gp_block* b = vector_data(blocks, gp_block);
+	int i = 0;
+	while (i < blocks->size && b[i].offset < offset)
+		++i;
+	const bool mergePrev = i > 0 && b[i - 1].offset + b[i - 1].size == offset;
+	const bool mergeNext = i < blocks->size && offset + size == b[i].offset;
+	if (mergePrev && mergeNext) {
+		b[i - 1].size += size + b[i].size;
+		vector_erase(blocks, i);
+	}
+	else if (mergePrev) b[i - 1].size += size;
+	else if (mergeNext) b[i].offset = offset, b[i].size += size;
+	else {
+		const gp_block block = { offset, size };
+		vector_insert(blocks, i, &block);
+	}
+}
+
+// replaces *buffer with a larger copy, the old buffer is deleted at the end of the frame
+static void grow_buffer(GLuint* buffer, int oldBytes, int newBytes)
+{
+	GLuint grown;
+	glGenBuffers(1, &grown);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+	if (oldBytes) {
+		glBindBuffer(GL_COPY_READ_BUFFER, *buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	dq_delete_buffer(*buffer);
+	*buffer = grown;
+}
+
+// grows the vertex or index buffer to fit at least size more units, rebinding the VAO
+static void grow_pool(geometry_pool* gp, bool indices, int size)
+{
+	vertex_array* va = &gp->va;
+	unsigned* capacity = indices ? &va->indexCount : &va->vertexCount;
+	const int oldCap = *capacity;
+	int newCap = oldCap ? oldCap * 2 : indices ? GP_MIN_INDICES : GP_MIN_VERTS;
+	while (newCap < oldCap + size)
+		newCap *= 2;
+	const int unit = indices ? 1 : va->descr.sizeOf;
+	grow_buffer(indices ? &va->indexBuf : &va->vertexBuf, oldCap * unit, newCap * unit);
+	block_free(indices ? &gp->freeIndices : &gp->freeVerts, oldCap, newCap - oldCap);
+	*capacity = newCap;
+
+	bind_array(va->arrayObj);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, va->indexBuf);
+	glBindBuffer(GL_ARRAY_BUFFER, va->vertexBuf);
+	vao_set_attributes(&va->descr);
+}
+
+geometry_pool* gp_shared(vertex_descr vd)
+{
+	indebug(vd_validate(&vd));
+	int i = 0;
+	for (; i < GP_MAX_POOLS && pools[i]; ++i)
+		if (!memcmp(&pools[i]->va.descr, &vd, sizeof(vd)))
+			return pools[i];
+	if (i == GP_MAX_POOLS) {
+		LOG("gp_shared(): more than %d vertex layouts\n", GP_MAX_POOLS);
+		return NULL;
+	}
+	geometry_pool* gp = calloc(1, sizeof(*gp));
+	if (!gp) return NULL;
+	gp->va.indexType = GL_UNSIGNED_INT; // per mesh, see gp_range
+	gp->va.descr     = vd;
+	vector_create(&gp->freeVerts,   sizeof(gp_block));
+	vector_create(&gp->freeIndices, sizeof(gp_block));
+	mutex_init(&gp->lock);
+	glGenVertexArrays(1, &gp->va.arrayObj);
+	return pools[i] = gp;
+}
+
+bool gp_alloc(geometry_pool* gp, gp_range* out, const void* vertices, int numVerts,
+              const void* indices, int numIndices, int indexSize)
+{
+	unsigned short* narrow = indexSize == 4 ? narrow_indices(indices, numIndices, numVerts) : NULL;
+	if (narrow) indices = narrow, indexSize = 2;
+	const int indexBytes = (numIndices * indexSize + 3) & ~3; // keeps every range 4-byte aligned
+	mutex_lock(&gp->lock);
+	int baseVertex  = block_alloc(&gp->freeVerts, numVerts);
+	if (baseVertex < 0) {
+		grow_pool(gp, false, numVerts);
+		baseVertex = block_alloc(&gp->freeVerts, numVerts);
+	}
+	int indexOffset = block_alloc(&gp->freeIndices, indexBytes);
+	if (indexOffset < 0) {
+		grow_pool(gp, true, indexBytes);
+		indexOffset = block_alloc(&gp->freeIndices, indexBytes);
+	}
+	if (baseVertex < 0 || indexOffset < 0) {
+		LOG("gp_alloc(): pool out of space for %d vertices and %d indices\n", numVerts, numIndices);
+		if (baseVertex >= 0)  block_free(&gp->freeVerts, baseVertex, numVerts);
+		if (indexOffset >= 0) block_free(&gp->freeIndices, indexOffset, indexBytes);
+		mutex_unlock(&gp->lock);
+		free(narrow);
+		return false;
+	}
+	gp->usedVerts   += numVerts;
+	gp->usedIndices += indexBytes;
+	mutex_unlock(&gp->lock);
+
+	staging_upload(gp->va.vertexBuf, baseVertex * gp->va.descr.sizeOf, vertices, numVerts * gp->va.descr.sizeOf);
+	staging_upload(gp->va.indexBuf, indexOffset, indices, numIndices * indexSize);
+	free(narrow);
+	out->baseVertex = baseVertex;
+	out->numVerts   = numVerts;
+	out->firstIndex = indexOffset / indexSize;
+	out->numIndices = numIndices;
+	out->indexType  = indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	return true;
+}
+
+void gp_free(geometry_pool* gp, const gp_range* r)
+{
+	const int indexSize  = va_index_size(r->indexType);
+	const int indexBytes = (r->numIndices * indexSize + 3) & ~3;
+	mutex_lock(&gp->lock);
+	block_free(&gp->freeVerts,   r->baseVertex, r->numVerts);
+	block_free(&gp->freeIndices, r->firstIndex * indexSize, indexBytes);
+	gp->usedVerts   -= r->numVerts;
+	gp->usedIndices -= indexBytes;
+	mutex_unlock(&gp->lock);
+}
+
+void gp_draw_range(geometry_pool* gp, const gp_range* r, int first, int count)
+{
+	const size_t indexSize = va_index_size(r->indexType);
+	bind_array(gp->va.arrayObj);
+	glDrawElementsBaseVertex(GL_TRIANGLES, count, r->indexType,
+		(const void*)((r->firstIndex + first) * indexSize), r->baseVertex);
+}
+
+void gp_draw_multi(geometry_pool* gp, const gp_range* r, const int* first, const int* count, int n)
+{
+	const size_t indexSize = va_index_size(r->indexType);
+	const void* offsets[256];
+	GLint baseVertices[256];
+	bind_array(gp->va.arrayObj);
+	for (int i = 0; i < n; i += 256)
+	{
+		const int batch = n - i < 256 ? n - i : 256;
+		for (int j = 0; j < batch; ++j) {
+			offsets[j] = (const void*)((r->firstIndex + first[i + j]) * indexSize);
+			baseVertices[j] = r->baseVertex;
+		}
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, &count[i], r->indexType, offsets, batch, baseVertices);
+	}
+}
+
+void gp_shutdown(void)
+{
+	for (int i = 0; i < GP_MAX_POOLS && pools[i]; ++i) {
+		geometry_pool* gp = pools[i];
+		if (gp->usedVerts)
+			LOG("gp_shutdown(): %d vertices still allocated\n", gp->usedVerts);
+		if (boundArray == gp->va.arrayObj)
+			bind_array(0);
+		dq_delete_buffer(gp->va.vertexBuf);
+		dq_delete_buffer(gp->va.indexBuf);
+		dq_delete_vertex_array(gp->va.arrayObj);
+		vector_destroy(&gp->freeVerts);
+		vector_destroy(&gp->freeIndices);
+		mutex_destroy(&gp->lock);
+		free(gp);
+		pools[i] = NULL;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "vfs.h"
+#include "util.h"
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h> // CreateFileMapping, MapViewOfFile
+#else
+	#include <sys/mman.h> // mmap
+	#include <fcntl.h>    // open
+	#include <unistd.h>   // close
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h> // stat
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct vfs_pack
+{
+	const char*           base;    // start of the mapped pack
+	size_t                size;    // size of the mapped pack
+	const vfs_pack_entry* entries; // [numEntries] sorted table of contents
+	int                   numEntries;
+	time_t                modified; // last modified time of the pack file
+	#ifdef _WIN32
+		HANDLE file, mapping;
+	#endif
+} vfs_pack;
+
+static vfs_pack pack; // currently mounted pack, base is NULL if none
+
+static void unmap_pack(vfs_pack* p)
+{
+	#ifdef _WIN32
+		if (p->base) UnmapViewOfFile(p->base);
+		if (p->mapping) CloseHandle(p->mapping);
+		if (p->file && p->file != INVALID_HANDLE_VALUE) CloseHandle(p->file);
+	#else
+		if (p->base) munmap((void*)p->base, p->size);
+	#endif
+	memset(p, 0, sizeof(*p));
+}
+
+static bool map_pack(vfs_pack* p, const char* packPath)
+{
+	memset(p, 0, sizeof(*p));
+	#ifdef _WIN32
+		p->file = CreateFileA(packPath, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (p->file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		GetFileSizeEx(p->file, &size);
+		p->size    = (size_t)size.QuadPart;
+		p->mapping = CreateFileMappingA(p->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		p->base    = p->mapping ? MapViewOfFile(p->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	#else
+		int fd = open(packPath, O_RDONLY);
+		if (fd == -1)
+			return false;
+		struct stat fs;
+		fstat(fd, &fs);
+		p->size = (size_t)fs.st_size;
+		void* base = p->size ? mmap(NULL, p->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		p->base = base != MAP_FAILED ? base : NULL;
+		close(fd); // the mapping keeps the file alive
+	#endif
+	struct stat s;
+	p->modified = stat(packPath, &s) == 0 ? s.st_mtime : 0;
+	return p->base != NULL;
+}
+
+bool vfs_mount(const char* packPath)
+{
+	vfs_unmount();
+	vfs_pack p;
+	if (!map_pack(&p, packPath)) {
+		unmap_pack(&p);
+		return false;
+	}
+
+	const vfs_pack_header* h = (const vfs_pack_header*)p.base;
+	if (p.size < sizeof(*h) || memcmp(h->magic, VFS_PACK_MAGIC, 4) || h->version != VFS_PACK_VERSION ||
+	    h->tocOffset > p.size || h->numEntries > (p.size - h->tocOffset) / sizeof(vfs_pack_entry)) {
+		LOG("vfs_mount(): invalid pack '%s'\n", packPath);
+		unmap_pack(&p);
+		return false;
+	}
+	p.entries    = (const vfs_pack_entry*)(p.base + h->tocOffset);
+	p.numEntries = (int)h->numEntries;
+	for (int i = 0; i < p.numEntries; ++i) {
+		const vfs_pack_entry* e = &p.entries[i];
+		if (e->offset > p.size || e->size > p.size - e->offset ||
+		    e->nameOffset >= p.size || e->nameLen >= p.size - e->nameOffset) {
+			LOG("vfs_mount(): corrupt entry %d in pack '%s'\n", i, packPath);
+			unmap_pack(&p);
+			return false;
+		}
+	}
+	pack = p;
+	return true;
+}
+
+void vfs_unmount(void)
+{
+	unmap_pack(&pack);
+}
+
+bool vfs_mounted(void)
+{
+	return pack.base != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// binary search of the sorted table of contents
+static const vfs_pack_entry* find_entry(const char* path)
+{
+	const int len = (int)strlen(path);
+	const uint64_t hash = fnv64(path, len);
+	int lo = 0, hi = pack.numEntries - 1;
+	while (lo <= hi) {
+		const int mid = (lo + hi) >> 1;
+		const vfs_pack_entry* e = &pack.entries[mid];
+		int cmp = e->hash < hash ? -1 : e->hash > hash;
+		if (!cmp) cmp = strcmp(pack.base + e->nameOffset, path);
+		if (!cmp) return e;
+		if (cmp < 0) lo = mid + 1;
+		else         hi = mid - 1;
+	}
+	return NULL;
+}
+
+static bool read_loose(vfs_file* f, const char* path)
+{
+	FILE* fp = fopen(path, "rb");
+	if (!fp) return false;
+	struct stat s;
+	fstat(fileno(fp), &s);
+	f->size     = (int)s.st_size;
+	f->modified = s.st_mtime;
+	f->owned    = true;
+	void* data  = malloc(f->size ? f->size : 1);
+	if (data && fread(data, f->size, 1, fp) != 1 && f->size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(fp);
+	f->data = data;
+	return data != NULL;
+}
+
+static bool map_loose(vfs_file* f, const char* path)
+{
+	struct stat s;
+	if (stat(path, &s) != 0 || s.st_size <= 0 || s.st_size > 0x7fffffff)
+		return false; // empty files can't be mapped, read_loose handles them
+	#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE, NULL,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (mapping) CloseHandle(mapping); // the view keeps the mapping and file alive
+		CloseHandle(file);
+	#else
+		int fd = open(path, O_RDONLY);
+		if (fd == -1) return false;
+		void* data = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file alive
+		if (data == MAP_FAILED) return false;
+		madvise(data, (size_t)s.st_size, MADV_WILLNEED); // start paging it in right away
+	#endif
+	if (!data) return false;
+	f->data     = data;
+	f->size     = (int)s.st_size;
+	f->modified = s.st_mtime;
+	f->mapped   = true;
+	return true;
+}
+
+// zero-copy view of a packed file
+static bool open_packed(vfs_file* f, const char* path)
+{
+	const vfs_pack_entry* e = pack.base ? find_entry(path) : NULL;
+	if (!e) return false;
+	f->data     = pack.base + e->offset;
+	f->size     = (int)e->size;
+	f->modified = pack.modified;
+	return true;
+}
+
+bool vfs_open(vfs_file* f, const char* path)
+{
+	memset(f, 0, sizeof(*f));
+	return open_packed(f, path) || read_loose(f, path);
+}
+
+bool vfs_map(vfs_file* f, const char* path)
+{
+	memset(f, 0, sizeof(*f));
+	return open_packed(f, path) || map_loose(f, path) || read_loose(f, path);
+}
+
+void vfs_close(vfs_file* f)
+{
+	if (f->owned) free((void*)f->data);
+	if (f->mapped) {
+		#ifdef _WIN32
+			UnmapViewOfFile(f->data);
+		#else
+			munmap((void*)f->data, (size_t)f->size);
+		#endif
+	}
+	memset(f, 0, sizeof(*f));
+}
+
+bool vfs_hash(const char* path, uint64_t* hash, int* size)
+{
+	vfs_file f; // mapped, so hashing doesn't copy the file into a heap buffer ReadFunc reads again
+	if (!vfs_map(&f, path))
+		return false;
+	*hash = xxhash64(f.data, f.size, 0);
+	*size = f.size;
+	vfs_close(&f);
+	return true;
+}
+
+time_t vfs_modified(const char* path)
+{
+	if (pack.base && find_entry(path))
+		return pack.modified;
+	struct stat s;
+	return stat(path, &s) == 0 ? s.st_mtime : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,231 @@
+#include "watcher.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h> // ReadDirectoryChangesW
+#else
+	#include <sys/inotify.h>
+	#include <sys/stat.h>
+	#include <dirent.h> // opendir
+	#include <poll.h>
+	#include <unistd.h> // pipe, read
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+// queues a changed file, repeated changes to the same file are merged
+static void push_changed(file_watcher* w, const char* dir, const char* name)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	normalize_path(path, path);
+
+	mutex_lock(&w->lock);
+	char** it  = pvector_begin(&w->changed, char);
+	char** end = pvector_end(&w->changed, char);
+	for (; it != end; ++it)
+		if (strcmp(*it, path) == 0)
+			break;
+	if (it == end)
+		pvector_append(&w->changed, strdup(path));
+	mutex_unlock(&w->lock);
+}
+
+bool watcher_poll(file_watcher* w, char* path, int maxLen)
+{
+	char* changed = NULL;
+	mutex_lock(&w->lock);
+	if (w->changed.size) {
+		changed = pvector_at(&w->changed, char, 0);
+		pvector_erase(&w->changed, 0);
+	}
+	mutex_unlock(&w->lock);
+	if (!changed)
+		return false;
+	snprintf(path, maxLen, "%s", changed);
+	free(changed);
+	return true;
+}
+
+static void free_changed(file_watcher* w)
+{
+	for (int i = 0; i < w->changed.size; ++i)
+		free(pvector_at(&w->changed, char, i));
+	pvector_destroy(&w->changed);
+	mutex_destroy(&w->lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+
+	static void watch_thread(file_watcher* w)
+	{
+		DWORD buffer[4096]; // FILE_NOTIFY_INFORMATION must be DWORD aligned
+		OVERLAPPED ov = { 0 };
+		ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+		const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+		for (;;) {
+			ResetEvent(ov.hEvent);
+			if (!ReadDirectoryChangesW(w->handle, buffer, sizeof(buffer), TRUE, filter, NULL, &ov, NULL))
+				break;
+			HANDLE events[2] = { w->quit, ov.hEvent };
+			DWORD bytes = 0;
+			if (WaitForMultipleObjects(2, events, FALSE, INFINITE) == WAIT_OBJECT_0) {
+				CancelIo(w->handle);
+				GetOverlappedResult(w->handle, &ov, &bytes, TRUE);
+				break;
+			}
+			if (!GetOverlappedResult(w->handle, &ov, &bytes, FALSE) || !bytes)
+				continue; // overflow, nothing we can do about it
+
+			for (char* p = (char*)buffer; ; ) {
+				FILE_NOTIFY_INFORMATION* fni = (FILE_NOTIFY_INFORMATION*)p;
+				if (fni->Action == FILE_ACTION_MODIFIED || fni->Action == FILE_ACTION_ADDED ||
+				    fni->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+					char name[260];
+					int len = WideCharToMultiByte(CP_UTF8, 0, fni->FileName, 
+						fni->FileNameLength / sizeof(WCHAR), name, sizeof(name) - 1, NULL, NULL);
+					name[len] = '\0';
+					push_changed(w, w->dir, name);
+				}
+				if (!fni->NextEntryOffset) break;
+				p += fni->NextEntryOffset;
+			}
+		}
+		CloseHandle(ov.hEvent);
+	}
+
+	file_watcher* watcher_create(const char* dir)
+	{
+		HANDLE handle = CreateFileA(dir, FILE_LIST_DIRECTORY, 
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+		if (handle == INVALID_HANDLE_VALUE)
+			return NULL;
+
+		file_watcher* w = calloc(1, sizeof(file_watcher));
+		snprintf(w->dir, sizeof(w->dir), "%s", dir);
+		w->handle = handle;
+		w->quit   = CreateEventA(NULL, TRUE, FALSE, NULL);
+		mutex_init(&w->lock);
+		pvector_create(&w->changed);
+		if (!thread_start(&w->worker, (ThreadFunc)&watch_thread, w)) {
+			CloseHandle(w->quit);
+			CloseHandle(w->handle);
+			free_changed(w);
+			free(w);
+			return NULL;
+		}
+		return w;
+	}
+
+	void watcher_destroy(file_watcher* w)
+	{
+		SetEvent(w->quit);
+		thread_join(&w->worker);
+		CloseHandle(w->quit);
+		CloseHandle(w->handle);
+		free_changed(w);
+		free(w);
+	}
+
+#else
+
+	#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+	// watches dir and all its subdirectories
+	static void add_watch(file_watcher* w, const char* dir)
+	{
+		int wd = inotify_add_watch(w->fd, dir, WATCH_MASK);
+		if (wd < 0) return;
+		while (w->dirs.size <= wd)
+			pvector_append(&w->dirs, NULL);
+		free(pvector_at(&w->dirs, char, wd));
+		pvector_at(&w->dirs, char, wd) = strdup(dir);
+
+		DIR* d = opendir(dir);
+		if (!d) return;
+		struct dirent* de;
+		while ((de = readdir(d))) {
+			if (de->d_name[0] == '.') continue;
+			char child[512]; snprintf(child, sizeof(child), "%s/%s", dir, de->d_name);
+			struct stat s;
+			if (stat(child, &s) == 0 && S_ISDIR(s.st_mode))
+				add_watch(w, child);
+		}
+		closedir(d);
+	}
+
+	static void watch_thread(file_watcher* w)
+	{
+		char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+		struct pollfd fds[2] = { { w->fd, POLLIN, 0 }, { w->wake[0], POLLIN, 0 } };
+		while (poll(fds, 2, -1) >= 0 && !fds[1].revents) {
+			ssize_t len = read(w->fd, buffer, sizeof(buffer));
+			for (char* p = buffer; len > 0 && p < buffer + len; ) {
+				const struct inotify_event* e = (const struct inotify_event*)p;
+				p += sizeof(struct inotify_event) + e->len;
+				if (!e->len || e->wd < 0 || e->wd >= w->dirs.size) continue;
+				const char* dir = pvector_at(&w->dirs, char, e->wd);
+				if (!dir) continue;
+				if (e->mask & IN_ISDIR) {
+					if (e->mask & (IN_CREATE | IN_MOVED_TO)) {
+						char child[512]; snprintf(child, sizeof(child), "%s/%s", dir, e->name);
+						add_watch(w, child);
+					}
+				}
+				else if (e->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+					push_changed(w, dir, e->name);
+				}
+			}
+		}
+	}
+
+	file_watcher* watcher_create(const char* dir)
+	{
+		struct stat s;
+		if (stat(dir, &s) != 0 || !S_ISDIR(s.st_mode))
+			return NULL;
+
+		file_watcher* w = calloc(1, sizeof(file_watcher));
+		snprintf(w->dir, sizeof(w->dir), "%s", dir);
+		w->fd = inotify_init1(IN_CLOEXEC);
+		if (w->fd < 0 || pipe(w->wake) != 0) {
+			if (w->fd >= 0) close(w->fd);
+			free(w);
+			return NULL;
+		}
+		mutex_init(&w->lock);
+		pvector_create(&w->changed);
+		pvector_create(&w->dirs);
+		add_watch(w, dir);
+		if (!thread_start(&w->worker, (ThreadFunc)&watch_thread, w)) {
+			w->worker.handle = 0;
+			watcher_destroy(w);
+			return NULL;
+		}
+		return w;
+	}
+
+	void watcher_destroy(file_watcher* w)
+	{
+		if (w->worker.handle) {
+			write(w->wake[1], "q", 1);
+			thread_join(&w->worker);
+		}
+		close(w->wake[0]);
+		close(w->wake[1]);
+		close(w->fd);
+		for (int i = 0; i < w->dirs.size; ++i)
+			free(pvector_at(&w->dirs, char, i));
+		pvector_destroy(&w->dirs);
+		free_changed(w);
+		free(w);
+	}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
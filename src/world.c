@@ -2,6 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include "util.h"
+#include "vfs.h"
+#include "watcher.h"
+#include "delete_queue.h"
+#include "staging.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -12,6 +16,18 @@ void world_create(World* world)
 	world->camera = &world->defaultCamera;
 	actor_init(&world->defaultCamera.a, "defaultCamera");
 	pvector_create(world->actors.vec);
+
+	dq_init();
+	world->loader     = taskpool_create(2);
+	world->loadBudget = 0.004; // 4ms of the 16ms frame
+	if (!vfs_mount("data.pak")) // optional, loose files under data/ are used without it
+		world->watcher = watcher_create("data"); // development: hot reload loose files
+	world->meshBudget    = 128 * 1024 * 1024;
+	world->textureBudget = 256 * 1024 * 1024;
+	world->manifestPath    = "preload.manifest";
+	world->manifestSeconds = 10.0;
+	pvector_create(&world->manifest);
+	pvector_create(&world->preloaded);
 }
 
 void world_destroy(World* world)
@@ -24,9 +40,22 @@ void world_destroy(World* world)
 	actor_clear(&world->defaultCamera.a);
 	pvector_destroy(world->actors.vec);
 
+	for (int i = 0; i < world->preloaded.size; ++i)
+		resource_free(pvector_at(&world->preloaded, Resource, i));
+	pvector_destroy(&world->preloaded);
+	for (int i = 0; i < world->manifest.size; ++i)
+		free(pvector_at(&world->manifest, char, i));
+	pvector_destroy(&world->manifest);
+
 	if (world->meshMgr)    ires_manager_destroy(world->meshMgr);
 	if (world->textureMgr) ires_manager_destroy(world->textureMgr);
 	if (world->shaderMgr)  ires_manager_destroy(world->shaderMgr);
+	if (world->loader)     taskpool_destroy(world->loader);
+	if (world->watcher)    watcher_destroy(world->watcher);
+	gp_shutdown();      // after the managers freed their meshes
+	staging_shutdown();
+	dq_shutdown(); // the managers queued their GL objects
+	vfs_unmount();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -47,15 +76,29 @@ void world_main_loop(World* world, GLFWwindow* window)
 	world->deltaTime = 0.0;
 	world->window = window;
 
-	// main loop has begun
+	// main loop has begun, with everything the last run loaded at startup already resident
+	world_prefetch_manifest(world);
+	if (world->manifestPath && world->manifestSeconds > 0.0)
+		world->recordUntil = timer_now() + world->manifestSeconds;
 	if (world->begin_play) 
 		world->begin_play(world);
+	for (int i = 0; i < world->preloaded.size; ++i) // begin_play holds its own references now
+		resource_free(pvector_at(&world->preloaded, Resource, i));
+	pvector_clear(&world->preloaded);
 
 	while (!glfwWindowShouldClose(window))
 	{
 		double deltaTime = world->deltaTime = timer_elapsed_vsync(60.0);  // VSYNC framerate to 60fps
+		resource_next_frame();
 		update_screen_size(world, window);
 		{
+			//////// Finalize async loads ////////
+			world_pump_loads(world, world->loadBudget);
+			world_clean_unused(world);
+			world_reload_changed(world);
+			if (world->recordUntil && timer_now() >= world->recordUntil)
+				world_save_manifest(world);
+
 			//////// Update Actor tick ////////
 			int count      = world->actors.size;
 			Actor** actors = world->actors.data;
@@ -70,11 +113,14 @@ void world_main_loop(World* world, GLFWwindow* window)
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			world->frame_tick(world, world->deltaTime);
 			glfwSwapBuffers(window);
+			dq_flush(); // batched deletes of everything freed this frame
 		}
 		glfwPollEvents();
 	}
 
 	// main loop has finished
+	if (world->recordUntil) // closed before the recording finished
+		world_save_manifest(world);
 	if (world->end_play)
 		world->end_play(world);
 }
@@ -98,26 +144,192 @@ Actor* world_find_actor(World* world, const char* name)
 	return NULL;
 }
 
+static ShaderManager* world_shader_mgr(World* world)
+{
+	if (!world->shaderMgr) {
+		world->shaderMgr = shader_manager_create(8);
+		world->shaderMgr->rm.pool = world->loader;
+	}
+	return world->shaderMgr;
+}
+static MeshManager* world_mesh_mgr(World* world)
+{
+	if (!world->meshMgr) {
+		world->meshMgr = mesh_manager_create(16);
+		world->meshMgr->rm.pool   = world->loader;
+		world->meshMgr->rm.budget = world->meshBudget;
+		world->meshMgr->rm.dedupe = true;
+		world->meshMgr->rm.gpuOnly = true; // meshes are only drawn, keep just their headers
+	}
+	return world->meshMgr;
+}
+static TexManager* world_texture_mgr(World* world)
+{
+	if (!world->textureMgr) {
+		world->textureMgr = tex_manager_create(16);
+		world->textureMgr->rm.pool   = world->loader;
+		world->textureMgr->rm.budget = world->textureBudget;
+		world->textureMgr->rm.dedupe = true;
+	}
+	return world->textureMgr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//// Preload manifest: one "kind path" line per resource loaded during the first
+//// manifestSeconds of play. The next launch prefetches all of them before begin_play.
+
+enum { MANIFEST_SHADER, MANIFEST_MESH, MANIFEST_TEXTURE };
+static const char* manifest_kinds[] = { "shader", "mesh", "texture" };
+
+static void record_load(World* world, int kind, const char* path)
+{
+	if (!world->recordUntil) return;
+	char line[300];
+	snprintf(line, sizeof(line), "%s %s", manifest_kinds[kind], path);
+	for (int i = 0; i < world->manifest.size; ++i)
+		if (strcmp(pvector_at(&world->manifest, char, i), line) == 0)
+			return; // the manifest is small, a linear search is fine
+	pvector_append(&world->manifest, strdup(line));
+}
+
+int world_prefetch_manifest(World* world)
+{
+	FILE* f = world->manifestPath ? fopen(world->manifestPath, "r") : NULL;
+	if (!f) return 0; // first run, nothing recorded yet
+
+	// queue everything first, so the loader threads read all files in parallel
+	const double start = timer_now();
+	char kind[16], path[260];
+	while (fscanf(f, " %15s %259[^\n]", kind, path) == 2) {
+		Resource* r = NULL;
+		if      (!strcmp(kind, "shader"))  r = (Resource*)iresource_load_async(world_shader_mgr(world),  path);
+		else if (!strcmp(kind, "mesh"))    r = (Resource*)iresource_load_async(world_mesh_mgr(world),    path);
+		else if (!strcmp(kind, "texture")) r = (Resource*)iresource_load_async(world_texture_mgr(world), path);
+		else LOG("world_prefetch_manifest(): unknown resource kind '%s' in '%s'\n", kind, world->manifestPath);
+		if (r) pvector_append(&world->preloaded, r);
+	}
+	fclose(f);
+
+	// then finalize them on the GL thread as their reads finish
+	int ready = 0;
+	for (int i = 0; i < world->preloaded.size; ++i) {
+		Resource* r = pvector_at(&world->preloaded, Resource, i);
+		while (resource_state(r) == RES_PENDING) {
+			world_pump_loads(world, 0.1);
+			if (resource_state(r) == RES_PENDING) sleep_ms(1);
+		}
+		ready += resource_ready(r);
+	}
+	LOG("world_prefetch_manifest(): prefetched %d/%d resources in %.1fms\n", 
+		ready, world->preloaded.size, (timer_now() - start) * 1000.0);
+	return ready;
+}
+
+bool world_save_manifest(World* world)
+{
+	world->recordUntil = 0.0;
+	FILE* f = world->manifestPath ? fopen(world->manifestPath, "w") : NULL;
+	for (int i = 0; i < world->manifest.size; ++i) {
+		char* line = pvector_at(&world->manifest, char, i);
+		if (f) fprintf(f, "%s\n", line);
+		free(line);
+	}
+	pvector_clear(&world->manifest);
+	if (f) fclose(f);
+	return f != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 Shader* world_load_shader(World* world, const char* modelPath)
 {
-	if (!world->shaderMgr)
-		world->shaderMgr = shader_manager_create(32);
-	return (Shader*)iresource_load(world->shaderMgr, modelPath);
+	record_load(world, MANIFEST_SHADER, modelPath);
+	return (Shader*)iresource_load(world_shader_mgr(world), modelPath);
 }
 StaticMesh* world_load_mesh(World* world, const char* modelPath)
 {
-	if (!world->meshMgr)
-		world->meshMgr = mesh_manager_create(64);
-	return (StaticMesh*)iresource_load(world->meshMgr, modelPath);
+	record_load(world, MANIFEST_MESH, modelPath);
+	return (StaticMesh*)iresource_load(world_mesh_mgr(world), modelPath);
 }
 Texture* world_load_texture(World* world, const char* modelPath)
 {
-	if (!world->textureMgr)
-		world->textureMgr = tex_manager_create(64);
-	return (Texture*)iresource_load(world->textureMgr, modelPath);
+	record_load(world, MANIFEST_TEXTURE, modelPath);
+	return (Texture*)iresource_load(world_texture_mgr(world), modelPath);
 }
 Material world_load_material(World* world, const char* shaderPath, const char* texturePath)
 {
 	return material_create(world_load_shader(world, shaderPath), 
 		                   world_load_texture(world, texturePath));
-}
\ No newline at end of file
+}
+
+StaticMesh* world_load_mesh_async(World* world, const char* modelPath)
+{
+	record_load(world, MANIFEST_MESH, modelPath);
+	return (StaticMesh*)iresource_load_async(world_mesh_mgr(world), modelPath);
+}
+Texture* world_load_texture_async(World* world, const char* texturePath)
+{
+	record_load(world, MANIFEST_TEXTURE, texturePath);
+	return (Texture*)iresource_load_async(world_texture_mgr(world), texturePath);
+}
+Material world_load_material_async(World* world, const char* shaderPath, const char* texturePath)
+{
+	return material_create(world_load_shader(world, shaderPath), 
+		                   world_load_texture_async(world, texturePath));
+}
+
+int world_reload_changed(World* world)
+{
+	if (!world->watcher) return 0;
+	int reloaded = 0;
+	char path[260];
+	while (watcher_poll(world->watcher, path, sizeof(path))) {
+		if (world->meshMgr)    reloaded += res_manager_reload_path(&world->meshMgr->rm, path);
+		if (world->textureMgr) reloaded += res_manager_reload_path(&world->textureMgr->rm, path);
+		if (world->shaderMgr) { // shaders are loaded by name, without the .vert/.frag extension
+			char* ext = strrchr(path, '.');
+			if (ext && (strcmp(ext, ".vert") == 0 || strcmp(ext, ".frag") == 0)) {
+				*ext = '\0';
+				reloaded += res_manager_reload_path(&world->shaderMgr->rm, path);
+			}
+		}
+	}
+	return reloaded;
+}
+
+void world_dump_stats(World* world, FILE* out, bool json)
+{
+	if (world->shaderMgr)  res_manager_dump(&world->shaderMgr->rm,  out, json);
+	if (world->meshMgr)    res_manager_dump(&world->meshMgr->rm,    out, json);
+	if (world->textureMgr) res_manager_dump(&world->textureMgr->rm, out, json);
+
+	staging_stats ss;
+	staging_stats_get(&ss);
+	if (json)
+		fprintf(out, "{\"name\":\"staging\",\"mapped\":%s,\"bytes\":%lld,\"chunks\":%d,\"stalls\":%d}\n",
+			ss.mapped ? "true" : "false", ss.bytes, ss.chunks, ss.stalls);
+	else
+		fprintf(out, "staging: %lldKB uploaded in %d chunks, %d stalls, %s\n", ss.bytes / 1024,
+			ss.chunks, ss.stalls, ss.mapped ? "persistently mapped ring" : "glBufferSubData");
+}
+
+void world_clean_unused(World* world)
+{
+	if (world->meshMgr)    res_manager_clean_unused(&world->meshMgr->rm);
+	if (world->textureMgr) res_manager_clean_unused(&world->textureMgr->rm);
+}
+
+void world_pump_loads(World* world, double timeBudget)
+{
+	const double deadline = timer_now() + timeBudget;
+	ResManager* managers[3] = {
+		world->shaderMgr  ? &world->shaderMgr->rm  : NULL, // shaders first, they're tiny
+		world->meshMgr    ? &world->meshMgr->rm    : NULL,
+		world->textureMgr ? &world->textureMgr->rm : NULL,
+	};
+	for (int i = 0; i < 3; ++i) {
+		double remaining = deadline - timer_now();
+		if (remaining <= 0.0) break;
+		if (managers[i]) res_manager_pump(managers[i], remaining);
+	}
+}
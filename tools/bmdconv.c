@@ -0,0 +1,57 @@
+/**
+ * bmdconv - converts BMD v1 and v2 models into the current BMD format
+ * usage: bmdconv in.bmd [out.bmd]     converts in place if out.bmd is omitted
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include "mesh.h"
+#include "util.h"
+#include "vfs.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		printf("usage: bmdconv <in.bmd> [out.bmd]\n");
+		return EXIT_FAILURE;
+	}
+	const char* inPath  = argv[1];
+	const char* outPath = argc > 2 ? argv[2] : argv[1];
+
+	vfs_file in;
+	if (!vfs_open(&in, inPath)) {
+		LOG("bmdconv: failed to read '%s'\n", inPath);
+		return EXIT_FAILURE;
+	}
+	const BMDModel* model = in.data;
+	if (bmd_validate(model, in.size) && bmd_version(model) == BMD_VERSION) {
+		printf("bmdconv: '%s' is already BMD v%d\n", inPath, BMD_VERSION);
+		vfs_close(&in);
+		return EXIT_SUCCESS;
+	}
+
+	int size;
+	const int version = bmd_validate(model, in.size) ? bmd_version(model) : 0;
+	BMDModel* converted = bmd_convert(model, in.size, &size);
+	const int inSize = in.size;
+	vfs_close(&in);
+	if (!converted) {
+		LOG("bmdconv: '%s' is not a valid BMD model\n", inPath);
+		return EXIT_FAILURE;
+	}
+
+	FILE* out = fopen(outPath, "wb");
+	if (!out || fwrite(converted, size, 1, out) != 1) {
+		LOG("bmdconv: failed to write '%s'\n", outPath);
+		if (out) fclose(out);
+		free(converted);
+		return EXIT_FAILURE;
+	}
+	fclose(out);
+	printf("bmdconv: %s v%d -> v%d %d verts %d indices (%d-bit): %dKB -> %dKB\n", outPath, version,
+		BMD_VERSION, converted->num_verts, converted->num_indices, converted->index_size * 8,
+		inSize / 1024, size / 1024);
+	free(converted);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/**
+ * bmdimport - imports OBJ and glTF models into the current BMD format
+ * usage: bmdimport [-threads N] [-weld D] [-bench N] in.obj|in.gltf|in.glb [out.bmd]
+ *        -threads N  worker threads, one per CPU core by default
+ *        -weld D     also welds positions closer than D, only identical vertices by default
+ *        -bench N    imports N times and reports the fastest run, ex: to compare thread counts
+ *        out.bmd defaults to the input path with a .bmd extension, run bmdopt on it afterwards
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "importer.h"
+#include "util.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	import_options opt = { 0, 0.0f };
+	int runs = 1;
+	for (;;) {
+		if (argc > 2 && strcmp(argv[1], "-threads") == 0) {
+			opt.numThreads = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else if (argc > 2 && strcmp(argv[1], "-weld") == 0) {
+			opt.weld = (float)atof(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else if (argc > 2 && strcmp(argv[1], "-bench") == 0) {
+			runs = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else break;
+	}
+	if (argc < 2 || opt.numThreads < 0 || opt.weld < 0.0f || runs < 1) {
+		printf("usage: bmdimport [-threads N] [-weld D] [-bench N] <in.obj|in.gltf|in.glb> [out.bmd]\n");
+		return EXIT_FAILURE;
+	}
+	const char* inPath = argv[1];
+	char outPath[512];
+	if (argc > 2) snprintf(outPath, sizeof(outPath), "%s", argv[2]);
+	else {
+		const char* ext = strrchr(inPath, '.');
+		const int len = ext ? (int)(ext - inPath) : (int)strlen(inPath);
+		snprintf(outPath, sizeof(outPath), "%.*s.bmd", len, inPath);
+	}
+
+	int size = 0;
+	BMDModel* model = NULL;
+	import_stats best = { 0 };
+	for (int i = 0; i < runs; ++i) {
+		import_stats stats;
+		free(model);
+		if (!(model = import_model(inPath, &opt, &size, &stats))) {
+			LOG("bmdimport: failed to import '%s'\n", inPath);
+			return EXIT_FAILURE;
+		}
+		const double total = stats.parseTime + stats.weldTime + stats.buildTime;
+		if (i == 0 || total < best.parseTime + best.weldTime + best.buildTime)
+			best = stats;
+	}
+
+	FILE* out = fopen(outPath, "wb");
+	if (!out || fwrite(model, size, 1, out) != 1) {
+		LOG("bmdimport: failed to write '%s'\n", outPath);
+		if (out) fclose(out);
+		free(model);
+		return EXIT_FAILURE;
+	}
+	fclose(out);
+	printf("bmdimport: %s v%d %d triangles, %d corners welded into %d verts (%d degenerate): %dKB\n",
+		outPath, BMD_VERSION, model->num_indices / 3, best.numCorners, best.numVerts,
+		best.numDegenerate, size / 1024);
+	const double total = best.parseTime + best.weldTime + best.buildTime;
+	printf("  %d threads, fastest of %d: parse %.1fms weld %.1fms build %.1fms total %.1fms (%.1fM triangles/s)\n",
+		best.numThreads, runs, best.parseTime * 1000,
+		best.weldTime * 1000, best.buildTime * 1000, total * 1000,
+		total > 0 ? best.numCorners / 3 / total * 1e-6 : 0.0);
+	free(model);
+	return EXIT_SUCCESS;
+}
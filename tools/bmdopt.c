@@ -0,0 +1,89 @@
+/**
+ * bmdopt - reorders BMD triangles and vertices for the vertex cache, overdraw and
+ *          vertex fetch, reporting the vertex cache statistics before and after
+ * usage: bmdopt [-lods N] [-meshlets] in.bmd [out.bmd]   optimizes in place if out.bmd is omitted
+ *        -lods N    also generates a chain of N LODs (including LOD0), converting older models first
+ *        -meshlets  also splits every LOD into meshlets for CPU culling, converting older models first
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "mesh.h"
+#include "util.h"
+#include "vfs.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	int numLods = 0;
+	bool meshlets = false;
+	for (;;) {
+		if (argc > 2 && strcmp(argv[1], "-lods") == 0) {
+			numLods = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else if (argc > 1 && strcmp(argv[1], "-meshlets") == 0) {
+			meshlets = true;
+			argc -= 1, argv += 1;
+		}
+		else break;
+	}
+	if (argc < 2 || numLods < 0 || numLods > BMD_MAX_LODS) {
+		printf("usage: bmdopt [-lods 1-%d] [-meshlets] <in.bmd> [out.bmd]\n", BMD_MAX_LODS);
+		return EXIT_FAILURE;
+	}
+	const char* inPath  = argv[1];
+	const char* outPath = argc > 2 ? argv[2] : argv[1];
+
+	vfs_file in;
+	if (!vfs_open(&in, inPath)) {
+		LOG("bmdopt: failed to read '%s'\n", inPath);
+		return EXIT_FAILURE;
+	}
+	int size = in.size;
+	BMDModel* model = malloc(size ? size : 1); // vfs data is read-only, optimize a copy
+	if (model) memcpy(model, in.data, size);
+	vfs_close(&in);
+
+	if (model && (numLods || meshlets) && bmd_validate(model, size) && bmd_version(model) != BMD_VERSION) {
+		BMDModel* current = bmd_convert(model, size, &size); // LODs and meshlets need the current header
+		free(model);
+		model = current;
+	}
+	if (model && numLods) {
+		BMDModel* lods = bmd_generate_lods(model, size, numLods, 0.5f, &size);
+		free(model);
+		model = lods;
+	}
+	if (model && meshlets) { // optimized below, inside every meshlet
+		BMDModel* clustered = bmd_build_meshlets(model, size, &size);
+		free(model);
+		model = clustered;
+	}
+
+	meshopt_stats before, after;
+	if (!model || !bmd_optimize(model, size, &before, &after)) {
+		LOG("bmdopt: '%s' is not a valid BMD model\n", inPath);
+		free(model);
+		return EXIT_FAILURE;
+	}
+
+	FILE* out = fopen(outPath, "wb");
+	if (!out || fwrite(model, size, 1, out) != 1) {
+		LOG("bmdopt: failed to write '%s'\n", outPath);
+		if (out) fclose(out);
+		free(model);
+		return EXIT_FAILURE;
+	}
+	fclose(out);
+	printf("bmdopt: %s %d verts %d indices: ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", outPath,
+		model->num_verts, model->num_indices, before.acmr, after.acmr, before.atvr, after.atvr);
+	BMDLod lods[BMD_MAX_LODS];
+	const int n = numLods || meshlets ? bmd_lods(model, lods) : 0;
+	for (int i = 0; i < n; ++i)
+		printf("  LOD%d  %7d triangles  error %.4f  %d meshlets\n", i,
+			lods[i].num_indices / 3, lods[i].error, lods[i].num_meshlets);
+	free(model);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/**
+ * gl4pack - packs loose asset files into a single memory mappable pack
+ * usage: gl4pack data.pak data [more dirs or files...]
+ * File paths are stored normalized, exactly as the engine loads them: "data/statue_mage.bmd"
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "util.h"
+#include "vfs.h"
+#include "vector.h"
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h> // FindFirstFile
+#else
+	#include <dirent.h>   // opendir
+	#include <sys/stat.h> // stat
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct pack_file
+{
+	uint64_t hash;
+	char*    path; // normalized path
+} pack_file;
+
+static void add_file(vector* files, const char* path)
+{
+	char norm[512];
+	normalize_path(norm, path);
+	pack_file f = { fnv64(norm, strlen(norm)), strdup(norm) };
+	vector_append(files, &f);
+}
+
+static void add_path(vector* files, const char* path)
+{
+	#ifdef _WIN32
+		char pattern[512]; snprintf(pattern, sizeof(pattern), "%s/*", path);
+		WIN32_FIND_DATAA fd;
+		HANDLE h = FindFirstFileA(pattern, &fd);
+		if (h == INVALID_HANDLE_VALUE) { add_file(files, path); return; }
+		do {
+			if (fd.cFileName[0] == '.') continue;
+			char child[512]; snprintf(child, sizeof(child), "%s/%s", path, fd.cFileName);
+			if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) add_path(files, child);
+			else add_file(files, child);
+		} while (FindNextFileA(h, &fd));
+		FindClose(h);
+	#else
+		DIR* dir = opendir(path);
+		if (!dir) { add_file(files, path); return; }
+		struct dirent* de;
+		while ((de = readdir(dir))) {
+			if (de->d_name[0] == '.') continue;
+			char child[512]; snprintf(child, sizeof(child), "%s/%s", path, de->d_name);
+			struct stat s;
+			if (stat(child, &s) != 0) continue;
+			if (S_ISDIR(s.st_mode)) add_path(files, child);
+			else add_file(files, child);
+		}
+		closedir(dir);
+	#endif
+}
+
+static int compare_files(const void* a, const void* b)
+{
+	const pack_file* fa = a;
+	const pack_file* fb = b;
+	if (fa->hash != fb->hash) return fa->hash < fb->hash ? -1 : 1;
+	return strcmp(fa->path, fb->path);
+}
+
+static void pad_to(FILE* out, long* pos, int align)
+{
+	static const char zeros[VFS_PACK_ALIGN];
+	int pad = (int)((align - (*pos % align)) % align);
+	fwrite(zeros, 1, pad, out);
+	*pos += pad;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		printf("usage: gl4pack <out.pak> <dir|file> [dir|file...]\n");
+		return EXIT_FAILURE;
+	}
+
+	vector files;
+	vector_create(&files, sizeof(pack_file));
+	for (int i = 2; i < argc; ++i)
+		add_path(&files, argv[i]);
+	qsort(vector_data(&files, pack_file), files.size, sizeof(pack_file), compare_files);
+
+	FILE* out = fopen(argv[1], "wb");
+	if (!out) {
+		LOG("gl4pack: failed to create '%s'\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	vfs_pack_header header = { VFS_PACK_MAGIC, VFS_PACK_VERSION, files.size, 0 };
+	fwrite(&header, sizeof(header), 1, out);
+	long pos = sizeof(header);
+
+	vfs_pack_entry* toc = calloc(files.size ? files.size : 1, sizeof(vfs_pack_entry));
+	pack_file* f = vector_data(&files, pack_file);
+	for (int i = 0; i < files.size; ++i) {
+		vfs_file in;
+		if (!vfs_open(&in, f[i].path)) {
+			LOG("gl4pack: failed to read '%s'\n", f[i].path);
+			fclose(out);
+			return EXIT_FAILURE;
+		}
+		pad_to(out, &pos, VFS_PACK_ALIGN); // keeps vertex data SIMD aligned
+		toc[i].hash   = f[i].hash;
+		toc[i].offset = (uint32_t)pos;
+		toc[i].size   = (uint32_t)in.size;
+		fwrite(in.data, 1, in.size, out);
+		pos += in.size;
+		vfs_close(&in);
+		printf("  %8dKB  %s\n", toc[i].size / 1024, f[i].path);
+	}
+
+	pad_to(out, &pos, 8);
+	header.tocOffset = (uint32_t)pos;
+	long names = pos + files.size * sizeof(vfs_pack_entry);
+	for (int i = 0; i < files.size; ++i) {
+		toc[i].nameOffset = (uint32_t)names;
+		toc[i].nameLen    = (uint32_t)strlen(f[i].path);
+		names += toc[i].nameLen + 1;
+	}
+	fwrite(toc, sizeof(vfs_pack_entry), files.size, out);
+	for (int i = 0; i < files.size; ++i)
+		fwrite(f[i].path, 1, toc[i].nameLen + 1, out);
+
+	fseek(out, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, out);
+	fclose(out);
+	printf("gl4pack: packed %d files into '%s' (%ldKB)\n", files.size, argv[1], names / 1024);
+
+	for (int i = 0; i < files.size; ++i)
+		free(f[i].path);
+	free(toc);
+	vector_destroy(&files);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/**
+ * mipbench - compares the throughput of the CPU mipmap generators in mipmap.h
+ * usage: mipbench [-runs N] [-size N] [image]
+ *        -runs N  generates every chain N times and reports the fastest run, 5 by default
+ *        -size N  size of the generated noise image when no image is given, 2048 by default
+ *        image    any image SOIL can load, converted to RGBA
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <SOIL/SOIL.h>
+#include "mipmap.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+// generates the chain level by level with one implementation
+static void generate(unsigned char* chain, const unsigned char* rgba, int w, int h, int levels,
+                     mip_filter filter, bool simd)
+{
+	const unsigned char* src = rgba;
+	for (int i = 1; i < levels; ++i) {
+		mip_downsample(chain, src, mip_size(w, i - 1), mip_size(h, i - 1), filter, simd);
+		src = chain;
+		chain += mip_size(w, i) * mip_size(h, i) * 4;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int runs = 5, size = 2048;
+	for (;;) {
+		if (argc > 2 && strcmp(argv[1], "-runs") == 0) {
+			runs = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else if (argc > 2 && strcmp(argv[1], "-size") == 0) {
+			size = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else break;
+	}
+	if (runs < 1 || size < 1 || size > 16384) {
+		printf("usage: mipbench [-runs N] [-size N] [image]\n");
+		return EXIT_FAILURE;
+	}
+
+	int w = size, h = size;
+	unsigned char* rgba;
+	if (argc > 1) {
+		int channels;
+		if (!(rgba = SOIL_load_image(argv[1], &w, &h, &channels, SOIL_LOAD_RGBA))) {
+			printf("mipbench: failed to load '%s'\n", argv[1]);
+			return EXIT_FAILURE;
+		}
+	} else {
+		rgba = malloc(w * h * 4);
+		unsigned seed = 1;
+		for (int i = 0; i < w * h * 4; ++i)
+			rgba[i] = (unsigned char)((seed = seed * 1103515245u + 12345u) >> 24);
+	}
+
+	const int levels = mip_levels(w, h);
+	const int bytes  = mip_chain_bytes(w, h, levels);
+	unsigned char* reference = malloc(bytes);
+	unsigned char* chain     = malloc(bytes);
+	printf("mipbench: %dx%d, %d levels, fastest of %d runs\n", w, h, levels, runs);
+
+	static const struct { const char* name; mip_filter filter; bool simd; } impls[] = {
+		{ "box    scalar", MIP_BOX,    false },
+		{ "box    sse2  ", MIP_BOX,    true  },
+		{ "kaiser scalar", MIP_KAISER, false },
+		{ "kaiser sse2  ", MIP_KAISER, true  },
+	};
+	for (int i = 0; i < (int)(sizeof(impls) / sizeof(impls[0])); ++i) {
+		double best = 0.0;
+		for (int r = 0; r < runs; ++r) {
+			const clock_t start = clock();
+			generate(chain, rgba, w, h, levels, impls[i].filter, impls[i].simd);
+			const double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+			if (r == 0 || elapsed < best) best = elapsed;
+		}
+		// the scalar run of each filter is the reference of its SIMD run
+		if (!impls[i].simd) memcpy(reference, chain, bytes);
+		int maxDiff = 0;
+		for (int j = 0; j < bytes; ++j) {
+			const int d = abs(chain[j] - reference[j]);
+			if (d > maxDiff) maxDiff = d;
+		}
+		printf("  %s %8.2fms %8.1f MB/s  max diff to scalar %d\n", impls[i].name, best * 1000,
+			best > 0 ? w * h * 4 / best / (1024 * 1024) : 0.0, maxDiff);
+	}
+	free(chain);
+	free(reference);
+	if (argc > 1) SOIL_free_image_data(rgba);
+	else free(rgba);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,256 @@
+/**
+ * resbench - benchmarks ResManager lookups with synthetic resources, no files or GL needed
+ * usage: resbench [-count N] [-threads N] [-runs N] [lookup] [contention] [churn]
+ *        -count N   synthetic resources loaded by the lookup benchmark, 10000 by default
+ *        -threads N threads of the contention benchmark, one per CPU core (at least 2) by default
+ *        -runs N    repeats every benchmark N times and reports the fastest run, 3 by default
+ *        lookup     loads N resources, then looks all of them up again as cache hits
+ *        contention N threads load and free the same 4 paths, then 64 paths of their own
+ *        churn      1M load+free cycles over 4096 paths, cleaning every 16 cycles, 512 items pinned
+ *        runs every benchmark when none is named
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h> // QueryPerformanceCounter
+#else
+	#include <time.h>    // clock_gettime
+#endif
+#include "resource.h"
+#include "thread.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+typedef struct BenchItem { Resource res; int payload; } BenchItem;
+
+static bool bench_load(BenchItem* item, const char* fullPath)
+{
+	item->payload = 1;
+	item->res.cpuBytes = sizeof(BenchItem);
+	return true;
+}
+static void bench_free(BenchItem* item)
+{
+	item->payload = 0;
+}
+
+static ResManager* bench_manager(const char* name)
+{
+	return res_manager_create(name, 256, sizeof(BenchItem), NULL,
+		(ResMgr_LoadFunc)bench_load, (ResMgr_FreeFunc)bench_free);
+}
+
+// timer that works without a GL context, timer_now() needs GLFW
+static double seconds(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, now;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (double)now.QuadPart / freq.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+static void bench_path(char* path, int size, int i)
+{
+	snprintf(path, size, "bench/res%d.bin", i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// cold loads of count paths (misses), then every path again while referenced (lock-free hits)
+static void bench_lookup(int count, int runs)
+{
+	double bestMiss = 0.0, bestHit = 0.0;
+	Resource** items = malloc(sizeof(Resource*) * count);
+	char path[64];
+	for (int run = 0; run < runs; ++run) {
+		ResManager* rm = bench_manager("bench_lookup");
+		double start = seconds();
+		for (int i = 0; i < count; ++i) {
+			bench_path(path, sizeof(path), i);
+			items[i] = resource_load(rm, path);
+		}
+		const double miss = seconds() - start;
+
+		start = seconds();
+		for (int i = 0; i < count; ++i) {
+			bench_path(path, sizeof(path), i);
+			resource_free(resource_load(rm, path));
+		}
+		const double hit = seconds() - start;
+		for (int i = 0; i < count; ++i)
+			resource_free(items[i]);
+		res_manager_destroy(rm);
+		if (run == 0 || miss < bestMiss) bestMiss = miss;
+		if (run == 0 || hit  < bestHit)  bestHit  = hit;
+	}
+	free(items);
+	printf("lookup: %d resources, fastest of %d runs\n", count, runs);
+	printf("  miss %8.1fms %8.1fns/load\n", bestMiss * 1000, bestMiss * 1e9 / count);
+	printf("  hit  %8.1fms %8.1fns/load+free\n", bestHit * 1000, bestHit * 1e9 / count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define CONTENTION_OPS   200000 // load+free pairs per thread
+#define CONTENTION_PATHS 64     // paths per thread when they don't share paths
+#define CONTENTION_SAME  4      // paths shared by all threads
+
+typedef struct ContentionThread
+{
+	ResManager* rm;
+	char (*paths)[32]; // paths this thread cycles through
+	int numPaths;
+	bool failed;       // a load returned NULL
+} ContentionThread;
+
+static void contention_worker(ContentionThread* t)
+{
+	for (int i = 0; i < CONTENTION_OPS; ++i) {
+		Resource* r = resource_load(t->rm, t->paths[i % t->numPaths]);
+		if (!r) { t->failed = true; return; }
+		resource_free(r);
+	}
+}
+
+// every path is loaded and kept referenced up front, so the threads only hit the lock-free path
+static double contention_run(int numThreads, bool same)
+{
+	ResManager* rm = bench_manager("bench_contention");
+	const int numPaths = same ? CONTENTION_SAME : CONTENTION_PATHS * numThreads;
+	char (*paths)[32] = malloc(sizeof(*paths) * numPaths);
+	Resource** held = malloc(sizeof(Resource*) * numPaths);
+	ContentionThread* ts = calloc(numThreads, sizeof(ContentionThread));
+	thread* threads = calloc(numThreads, sizeof(thread));
+	for (int i = 0; i < numPaths; ++i) {
+		bench_path(paths[i], sizeof(paths[i]), i);
+		held[i] = resource_load(rm, paths[i]);
+	}
+	for (int i = 0; i < numThreads; ++i) {
+		ts[i].rm       = rm;
+		ts[i].paths    = same ? paths : paths + i * CONTENTION_PATHS;
+		ts[i].numPaths = same ? CONTENTION_SAME : CONTENTION_PATHS;
+	}
+
+	const double start = seconds();
+	int started = 0;
+	while (started < numThreads && thread_start(&threads[started], 
+	       (ThreadFunc)&contention_worker, &ts[started]))
+		++started;
+	for (int i = 0; i < started; ++i)
+		thread_join(&threads[i]);
+	const double elapsed = seconds() - start;
+
+	bool failed = started < numThreads;
+	for (int i = 0; i < numThreads; ++i) failed |= ts[i].failed;
+	if (failed) printf("  contention: a thread failed to start or load!\n");
+	for (int i = 0; i < numPaths; ++i)
+		resource_free(held[i]);
+	res_manager_destroy(rm);
+	free(threads), free(ts), free(held), free(paths);
+	return elapsed;
+}
+
+static void bench_contention(int numThreads, int runs)
+{
+	printf("contention: %d threads x %d load+free, fastest of %d runs\n", numThreads, CONTENTION_OPS, runs);
+	for (int same = 1; same >= 0; --same) {
+		double best = 0.0;
+		for (int run = 0; run < runs; ++run) {
+			const double elapsed = contention_run(numThreads, same);
+			if (run == 0 || elapsed < best) best = elapsed;
+		}
+		const double ops = (double)numThreads * CONTENTION_OPS;
+		printf("  %-9s %8.1fms %8.2fM load+free/s\n", same ? "same" : "different",
+			best * 1000, ops / best * 1e-6);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define CHURN_CYCLES 1000000 // load+free cycles
+#define CHURN_PATHS  4096    // paths the cycles go through
+#define CHURN_CLEAN  16      // cycles between res_manager_clean_unused() calls
+#define CHURN_PINNED 512     // items kept referenced for the whole run
+
+// freed slots are reused all the time, while pinned items keep the alive array from emptying
+static void bench_churn(int runs)
+{
+	char (*paths)[32] = malloc(sizeof(*paths) * CHURN_PATHS);
+	for (int i = 0; i < CHURN_PATHS; ++i)
+		snprintf(paths[i], sizeof(paths[i]), "bench/churn%d.bin", i);
+	double best = 0.0;
+	int count = 0, capacity = 0;
+	for (int run = 0; run < runs; ++run) {
+		ResManager* rm = bench_manager("bench_churn");
+		Resource* pinned[CHURN_PINNED];
+		char path[64];
+		for (int i = 0; i < CHURN_PINNED; ++i) {
+			bench_path(path, sizeof(path), i);
+			pinned[i] = resource_load(rm, path);
+		}
+		const double start = seconds();
+		for (int i = 0; i < CHURN_CYCLES; ++i) {
+			resource_free(resource_load(rm, paths[i % CHURN_PATHS]));
+			if (i % CHURN_CLEAN == CHURN_CLEAN - 1)
+				res_manager_clean_unused(rm); // no budget, frees every unused item
+		}
+		const double elapsed = seconds() - start;
+		count    = rm->count;
+		capacity = rm->capacity;
+		for (int i = 0; i < CHURN_PINNED; ++i)
+			resource_free(pinned[i]);
+		res_manager_destroy(rm);
+		if (run == 0 || elapsed < best) best = elapsed;
+	}
+	free(paths);
+	printf("churn: %d load+free cycles, fastest of %d runs\n", CHURN_CYCLES, runs);
+	printf("  %8.1fms %8.1fns/cycle, %d items in %d slots at the end\n",
+		best * 1000, best * 1e9 / CHURN_CYCLES, count, capacity);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+	int count = 10000, runs = 3;
+	int numThreads = thread_cpu_count() > 2 ? thread_cpu_count() : 2;
+	for (;;) {
+		if (argc > 2 && strcmp(argv[1], "-count") == 0) {
+			count = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else if (argc > 2 && strcmp(argv[1], "-threads") == 0) {
+			numThreads = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else if (argc > 2 && strcmp(argv[1], "-runs") == 0) {
+			runs = atoi(argv[2]);
+			argc -= 2, argv += 2;
+		}
+		else break;
+	}
+	bool lookup = argc < 2, contention = argc < 2, churn = argc < 2, unknown = false;
+	for (int i = 1; i < argc; ++i) {
+		if      (strcmp(argv[i], "lookup") == 0)     lookup = true;
+		else if (strcmp(argv[i], "contention") == 0) contention = true;
+		else if (strcmp(argv[i], "churn") == 0)      churn = true;
+		else unknown = true;
+	}
+	if (unknown || count < 1 || count > RES_MAX_SLOTS || numThreads < 1 || 
+	    numThreads * CONTENTION_PATHS > RES_MAX_SLOTS || runs < 1) {
+		printf("usage: resbench [-count N] [-threads N] [-runs N] [lookup] [contention] [churn]\n");
+		return EXIT_FAILURE;
+	}
+	if (lookup)     bench_lookup(count, runs);
+	if (contention) bench_contention(numThreads, runs);
+	if (churn)      bench_churn(runs);
+	return EXIT_SUCCESS;
+}